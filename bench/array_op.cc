@@ -0,0 +1,89 @@
+// Copyright 2016-2019 Doug Moen
+// Licensed under the Apache License, version 2.0
+// See accompanying file LICENSE or https://www.apache.org/licenses/LICENSE-2.0
+
+#include "bench.h"
+#include <libcurv/context.h>
+#include <libcurv/list.h>
+#include <libcurv/math.h>
+#include <libcurv/program.h>
+#include <libcurv/source.h>
+#include <libcurv/system.h>
+#include <iostream>
+#include <string>
+
+using namespace curv;
+
+namespace {
+
+// A list of `n` vec3 values, like the vertex list of a mesh.
+Value
+vec3_list(unsigned n, double offset)
+{
+    Shared<List> list = List::make(n);
+    for (unsigned i = 0; i < n; ++i)
+        (*list)[i] = {List::make({Value{i+offset}, Value{i+offset+1},
+                                  Value{i+offset+2}})};
+    return {list};
+}
+
+// A list of `n` numbers, like a column of a data set. It is packed.
+Value
+num_list(unsigned n, double offset)
+{
+    List_Builder lb;
+    lb.reserve(n);
+    for (unsigned i = 0; i < n; ++i)
+        lb.push_back(Value{i+offset});
+    return lb.get_value();
+}
+
+} // namespace
+
+BENCHMARK(array_op)
+{
+    System_Impl sys(std::cerr);
+    auto source = make<String_Source>("", "0");
+    Program prog{std::move(source), sys};
+    prog.compile();
+    At_Phrase cx(*prog.phrase_, sys, nullptr);
+
+    for (unsigned n : {1000, 100000}) {
+        Value a = vec3_list(n, 0.0);
+        Value b = vec3_list(n, 0.5);
+        Value two{2.0};
+        long reps = 20'000'000 / n;
+        std::string label = std::to_string(n) + " vec3";
+        bench::measure((label + " + vec3 list").c_str(), reps, [&]() -> void {
+            Value r = add(a, b, cx);
+            bench::keep(r);
+        });
+        bench::measure((label + " * scalar").c_str(), reps, [&]() -> void {
+            Value r = multiply(a, two, cx);
+            bench::keep(r);
+        });
+        // The temporary result of `a + b` is reused by the multiply.
+        bench::measure((label + " (a + b) * scalar").c_str(), reps,
+            [&]() -> void {
+                Value r = multiply(add(a, b, cx), two, cx);
+                bench::keep(r);
+            });
+    }
+
+    for (unsigned n : {1000, 100000}) {
+        Value a = num_list(n, 0.0);
+        Value b = num_list(n, 0.5);
+        Value two{2.0};
+        long reps = 100'000'000 / n;
+        std::string label = std::to_string(n) + " num";
+        bench::measure((label + " + num list").c_str(), reps, [&]() -> void {
+            Value r = add(a, b, cx);
+            bench::keep(r);
+        });
+        bench::measure((label + " (a + b) * scalar").c_str(), reps,
+            [&]() -> void {
+                Value r = multiply(add(a, b, cx), two, cx);
+                bench::keep(r);
+            });
+    }
+}
@@ -0,0 +1,62 @@
+// Copyright 2016-2019 Doug Moen
+// Licensed under the Apache License, version 2.0
+// See accompanying file LICENSE or https://www.apache.org/licenses/LICENSE-2.0
+
+#ifndef BENCH_BENCH_H
+#define BENCH_BENCH_H
+
+// A minimal microbenchmark framework for libcurv.
+// Each source file in bench/ defines some benchmarks using BENCHMARK(name).
+// Build with `make bench`, then run `release/bench [name...]`.
+
+#include <chrono>
+#include <iostream>
+
+namespace bench {
+
+struct Benchmark
+{
+    const char* name_;
+    void (*func_)();
+    Benchmark* next_;
+    static Benchmark* list_;
+
+    Benchmark(const char* name, void (*func)())
+    :
+        name_(name), func_(func), next_(list_)
+    {
+        list_ = this;
+    }
+};
+
+#define BENCHMARK(name) \
+    static void bench_##name(); \
+    static bench::Benchmark bench_reg_##name(#name, bench_##name); \
+    static void bench_##name()
+
+// Prevent the compiler from optimizing away the computation of `x`.
+template <class T>
+inline void keep(const T& x)
+{
+    asm volatile("" : : "g"(&x) : "memory");
+}
+
+// Call `f` `n` times, and print the average time per call in nanoseconds.
+// Returns the time per call.
+template <class F>
+double measure(const char* label, long n, F f)
+{
+    for (long i = 0; i < n / 10; ++i) // warm up
+        f();
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < n; ++i)
+        f();
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::nano> t = end - start;
+    double ns = t.count() / n;
+    std::cout << "  " << label << ": " << ns << " ns\n";
+    return ns;
+}
+
+} // namespace bench
+#endif // header guard
@@ -0,0 +1,49 @@
+// Copyright 2016-2019 Doug Moen
+// Licensed under the Apache License, version 2.0
+// See accompanying file LICENSE or https://www.apache.org/licenses/LICENSE-2.0
+
+#include "bench.h"
+#include <libcurv/list.h>
+#include <libcurv/program.h>
+#include <libcurv/source.h>
+#include <libcurv/string.h>
+#include <libcurv/system.h>
+#include <iostream>
+
+using namespace curv;
+
+BENCHMARK(builder)
+{
+    // Build a large string, like the output of `repr` on a mesh.
+    bench::measure("100000 lines to String_Builder", 20, [&]() -> void {
+        String_Builder sb;
+        for (int i = 0; i < 100000; ++i)
+            sb << "v " << i << ' ' << i + 1 << ' ' << i + 2 << '\n';
+        Shared<String> s = sb.get_string();
+        bench::keep(s);
+    });
+
+    // Build a large list, like a list comprehension.
+    bench::measure("100000 values to List_Builder", 100, [&]() -> void {
+        List_Builder lb;
+        for (int i = 0; i < 100000; ++i)
+            lb.push_back(Value{double(i)});
+        Shared<List> list = lb.get_list();
+        bench::keep(list);
+    });
+
+    // The same, starting from Curv source.
+    System_Impl sys(std::cerr);
+    auto eval = [&](const char* label, const char* expr) -> void {
+        bench::measure(label, 20, [&]() -> void {
+            Program prog{make<String_Source>("", expr), sys};
+            prog.compile();
+            Value result = prog.eval();
+            bench::keep(result);
+        });
+    };
+    eval("repr of 10000 element list",
+        "repr [for (i in 0..<10000) [\"a\", \"b\"]]");
+    eval("strcat of 10000 strings",
+        "strcat [for (i in 0..<10000) \"item,\"]");
+}
@@ -0,0 +1,72 @@
+// Copyright 2016-2019 Doug Moen
+// Licensed under the Apache License, version 2.0
+// See accompanying file LICENSE or https://www.apache.org/licenses/LICENSE-2.0
+
+#include "bench.h"
+#include <libcurv/program.h>
+#include <libcurv/source.h>
+#include <libcurv/system.h>
+#include <iostream>
+
+using namespace curv;
+
+namespace {
+
+// Evaluate a Curv expression that makes `ncalls` function calls
+// (or other operations named by `what`), and print the number per second.
+void
+calls(System& sys, const char* label, const char* expr, double ncalls,
+    const char* what = "calls")
+{
+    double ns = bench::measure(label, 20, [&]() -> void {
+        Program prog{make<String_Source>("", expr), sys};
+        prog.compile();
+        Value result = prog.eval();
+        bench::keep(result);
+    });
+    std::cout << "    " << ncalls / ns * 1e3 << " million " << what
+        << "/sec\n";
+}
+
+} // namespace
+
+BENCHMARK(eval)
+{
+    System_Impl sys(std::cerr);
+
+    // 2*fib(23)-1 == 57313 calls of a recursive function.
+    calls(sys, "fib 22",
+        "let fib n = if (n < 2) n else fib(n-1) + fib(n-2) in fib 22",
+        57313);
+
+    // 100000 calls of a non-recursive function with a local variable,
+    // like a distance function called once per sample point.
+    calls(sys, "100000 calls",
+        "let f [x,y] = do local d = x*x + y*y; in sqrt d;"
+        "in sum [for (i in 0..<100000) f[i,1]]",
+        100000);
+
+    // 200000 references to fields of a module value, like `shape.dist`.
+    calls(sys, "200000 field refs",
+        "let m = {a = 1; b = 2} in sum [for (i in 0..<100000) m.a + m.b]",
+        200000, "field refs");
+
+    // 100000 generic operations on lists of 16 numbers, which are packed:
+    // a matrix product, indexing with a list, strcat, mag and max.
+    // These read the packed lists in place, without boxing them.
+    calls(sys, "100000 generic list ops",
+        "let M = [for (i in 0..<16) [for (j in 0..<16) i+j]];"
+        "    v = [for (j in 0..<16) j+1];"
+        "in sum [for (i in 0..<20000)"
+        "    sum(dot(M, v)) + sum(v[[0, 15]]) + count(strcat v)"
+        "    + mag v + max v]",
+        100000, "ops");
+
+    // The same kind of workload on longer lists: matrix * vector products,
+    // where the vector is packed, and the matrix is a short list of rows.
+    calls(sys, "20000 generic ops on 256 element lists",
+        "let v = [for (j in 0..<256) j];"
+        "    M = [v, v+1, v+2];"
+        "in sum [for (i in 0..<10000) sum(dot(M, v)) + sum(v[0..<4])]",
+        20000, "ops");
+}
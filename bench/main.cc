@@ -0,0 +1,40 @@
+// Copyright 2016-2019 Doug Moen
+// Licensed under the Apache License, version 2.0
+// See accompanying file LICENSE or https://www.apache.org/licenses/LICENSE-2.0
+
+#include "bench.h"
+#include <cstring>
+#include <vector>
+
+bench::Benchmark* bench::Benchmark::list_ = nullptr;
+
+// Usage: bench [name...]
+// Run the named benchmarks, or all benchmarks if no names are given.
+int main(int argc, char** argv)
+{
+    std::vector<bench::Benchmark*> all;
+    for (auto b = bench::Benchmark::list_; b != nullptr; b = b->next_)
+        all.insert(all.begin(), b);
+    int status = 0;
+    if (argc == 1) {
+        for (auto b : all) {
+            std::cout << b->name_ << "\n";
+            b->func_();
+        }
+    }
+    for (int i = 1; i < argc; ++i) {
+        bool found = false;
+        for (auto b : all) {
+            if (strcmp(b->name_, argv[i]) == 0) {
+                std::cout << b->name_ << "\n";
+                b->func_();
+                found = true;
+            }
+        }
+        if (!found) {
+            std::cerr << argv[i] << ": no such benchmark\n";
+            status = 1;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,90 @@
+// Copyright 2016-2019 Doug Moen
+// Licensed under the Apache License, version 2.0
+// See accompanying file LICENSE or https://www.apache.org/licenses/LICENSE-2.0
+
+#include "bench.h"
+#include <libcurv/symbol.h>
+#include <libcurv/value.h>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace curv;
+
+namespace {
+
+// The symbol ordering used by Symbol_Map before symbols were interned.
+struct Strcmp_Less
+{
+    bool operator()(Symbol_Ref a, Symbol_Ref b) const
+    {
+        return strcmp(a.c_str(), b.c_str()) < 0;
+    }
+};
+
+// Field names like those found in shape records, plus names with a long
+// common prefix.
+std::vector<Symbol_Ref>
+field_names(unsigned n)
+{
+    static const char* const names[] = {
+        "bbox", "colour", "dist", "is_2d", "is_3d", "render", "centre", "size"
+    };
+    std::vector<Symbol_Ref> result;
+    for (unsigned i = 0; i < n; ++i) {
+        if (i < sizeof(names)/sizeof(names[0]))
+            result.push_back(make_symbol(names[i]));
+        else {
+            char buf[32];
+            snprintf(buf, sizeof(buf), "field_%03u", i);
+            result.push_back(make_symbol(buf));
+        }
+    }
+    return result;
+}
+
+template <class Map>
+void
+lookup(const char* kind, unsigned nfields)
+{
+    auto names = field_names(nfields);
+    Map map;
+    for (unsigned i = 0; i < nfields; ++i)
+        map[names[i]] = Value{double(i)};
+    unsigned i = 0;
+    std::string label =
+        std::string(kind) + ", " + std::to_string(nfields) + " fields";
+    bench::measure(label.c_str(), 10'000'000, [&]() -> void {
+        auto f = map.find(names[i]);
+        bench::keep(f);
+        if (++i == nfields) i = 0;
+    });
+}
+
+} // namespace
+
+BENCHMARK(symbol)
+{
+    for (unsigned n : {4, 16, 64}) {
+        lookup<std::map<Symbol_Ref, Value, Strcmp_Less>>("strcmp field lookup", n);
+        lookup<Symbol_Map<Value>>("Symbol_Map field lookup", n);
+    }
+
+    auto names = field_names(16);
+    unsigned i = 0;
+    bench::measure("strcmp symbol equality", 10'000'000, [&]() -> void {
+        bool eq = strcmp(names[i].c_str(), names[15-i].c_str()) == 0;
+        bench::keep(eq);
+        if (++i == 16) i = 0;
+    });
+    bench::measure("interned symbol equality", 10'000'000, [&]() -> void {
+        bool eq = names[i] == names[15-i];
+        bench::keep(eq);
+        if (++i == 16) i = 0;
+    });
+    bench::measure("make_symbol", 1'000'000, [&]() -> void {
+        Symbol_Ref sym = make_symbol("colour");
+        bench::keep(sym);
+    });
+}
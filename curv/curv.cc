@@ -7,8 +7,10 @@ extern "C" {
 #include <getopt.h>
 #include <string.h>
 }
+#include <chrono>
 #include <iostream>
 #include <fstream>
+#include <cstdlib>
 
 #include "config.h"
 #include "export.h"
@@ -21,6 +23,7 @@ extern "C" {
 #include <libcurv/die.h>
 #include <libcurv/exception.h>
 #include <libcurv/gpu_program.h>
+#include <libcurv/module.h>
 #include <libcurv/output_file.h>
 #include <libcurv/progdir.h>
 #include <libcurv/program.h>
@@ -90,6 +93,8 @@ const char help_infix[] =
 "   -x : Interpret filename argument as expression.\n"
 "general options:\n"
 "   -v : Verbose & debug output.\n"
+"   --jobs N : Evaluate large list comprehensions using N threads.\n"
+"   --startup-stats : Report the time taken to load the standard library.\n"
 "   -O name=value : Set parameter controlling the specified output format.\n"
 "      If '-o fmt' is specified, use 'curv --help -o fmt' for help.\n"
 "      If '-o fmt' is not specified, the following parameters are available:\n"
@@ -119,12 +124,18 @@ main(int argc, char** argv)
     const char* editor = nullptr;
     bool help = false;
     bool version = false;
+    unsigned jobs = 1;
+    bool startup_stats = false;
 
     constexpr int HELP = 1000;
     constexpr int VERSION = 1001;
+    constexpr int JOBS = 1002;
+    constexpr int STARTUP_STATS = 1003;
     static struct option longopts[] = {
         {"help",    no_argument, nullptr, HELP },
         {"version", no_argument, nullptr, VERSION },
+        {"jobs",    required_argument, nullptr, JOBS },
+        {"startup-stats", no_argument, nullptr, STARTUP_STATS },
         {nullptr,   0,           nullptr, 0 }
     };
 
@@ -138,6 +149,21 @@ main(int argc, char** argv)
         case VERSION:
             version = true;
             break;
+        case JOBS:
+          {
+            char* end;
+            long n = strtol(optarg, &end, 10);
+            if (*optarg == '\0' || *end != '\0' || n < 1 || n > 1024) {
+                std::cerr << "--jobs: expecting a number from 1 to 1024\n"
+                          << "Use " << argv0 << " --help for help.\n";
+                return EXIT_FAILURE;
+            }
+            jobs = unsigned(n);
+            break;
+          }
+        case STARTUP_STATS:
+            startup_stats = true;
+            break;
         case 'o':
           {
             const char* oarg = optarg;
@@ -266,7 +292,17 @@ main(int argc, char** argv)
     // Create system, a precondition for parsing -O parameters.
     // This can fail, so we do as much argument validation as possible
     // before this point.
+    auto start_time = std::chrono::steady_clock::now();
     curv::System& sys(make_system(usestdlib, libs, std::cerr));
+    sys.jobs_ = jobs;
+    if (startup_stats) {
+        std::chrono::duration<double, std::milli> t =
+            std::chrono::steady_clock::now() - start_time;
+        auto& stats = sys.library_stats_;
+        std::cerr << "startup: " << t.count() << "ms; library index: "
+            << stats.index_hits_ << " cached, "
+            << stats.index_misses_ << " rebuilt\n";
+    }
     atexit(curv::geom::remove_all_tempfiles);
 
     try {
@@ -303,6 +339,19 @@ main(int argc, char** argv)
         curv::Program prog{std::move(source), sys};
         prog.compile();
         auto value = prog.eval();
+        if (verbose) {
+            auto& cache = sys.import_cache_;
+            if (cache.hits_ + cache.misses_ > 0) {
+                std::cerr << "import cache: " << cache.hits_ << " hits, "
+                    << cache.misses_ << " misses\n";
+            }
+        }
+        if (startup_stats) {
+            auto& stats = sys.library_stats_;
+            std::cerr << "library: loaded " << stats.groups_loaded_ << " of "
+                << stats.groups_ << " definition groups in "
+                << stats.load_seconds_ * 1000.0 << "ms\n";
+        }
 
         if (exporter != exporters.end()) {
             curv::Output_File ofile{sys};
@@ -323,6 +372,14 @@ main(int argc, char** argv)
                 std::cout << value << "\n";
             }
         }
+        if (verbose) {
+            // Field lookups happen during export, so report these last.
+            auto stats = curv::Field_Cache::stats();
+            if (stats.hits_ + stats.misses_ > 0) {
+                std::cerr << "field caches: " << stats.hits_ << " hits, "
+                    << stats.misses_ << " misses\n";
+            }
+        }
     } catch (std::exception& e) {
         sys.error(e);
         return EXIT_FAILURE;
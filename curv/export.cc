@@ -283,7 +283,9 @@ void describe_png_opts(std::ostream& out)
     "-v : verbose output logged to stderr\n"
     "-O xsize=<image width in pixels>\n"
     "-O ysize=<image height in pixels>\n"
-    "-O fstart=<animation frame start time, in seconds> (default 0)\n";
+    "-O fstart=<animation frame start time, in seconds> (default 0)\n"
+    "-O renderer=#gpu|#cpu : #gpu uses OpenGL, and falls back to #cpu\n"
+    "    if OpenGL is not available (default #gpu).\n";
     describe_render_opts(out);
     out <<
     "-O animate=<duration of animation> (exports an image sequence)\n";
@@ -311,6 +313,14 @@ void export_png(Value value,
             ix.fstart_ = p.to_double();
         } else if (p.name_ == "animate") {
             animate = p.to_double();
+        } else if (p.name_ == "renderer") {
+            auto val = p.to_symbol();
+            if (val == "gpu")
+                ix.renderer_ = geom::Image_Export::Renderer::gpu;
+            else if (val == "cpu")
+                ix.renderer_ = geom::Image_Export::Renderer::cpu;
+            else
+                throw Exception(p, "'renderer' must be #gpu or #cpu");
         } else {
             p.unknown_parameter();
         }
@@ -388,10 +398,20 @@ void describe_no_opts(std::ostream&) {}
 
 std::map<std::string, Exporter> exporters = {
     {"curv", {export_curv, "Curv expression", describe_no_opts}},
-    {"stl", {export_stl, "STL mesh file (3D shape only)", describe_mesh_opts}},
-    {"obj", {export_obj, "OBJ mesh file (3D shape only)", describe_mesh_opts}},
+    {"stl", {export_stl, "STL mesh file (3D shape only)",
+             describe_tiled_mesh_opts}},
+    {"obj", {export_obj, "OBJ mesh file (3D shape only)",
+             describe_tiled_mesh_opts}},
     {"x3d", {export_x3d, "X3D colour mesh file (3D shape only)",
              describe_colour_mesh_opts}},
+    {"stlb", {export_stlb, "binary STL mesh file (3D shape only)",
+              describe_tiled_mesh_opts}},
+    {"ply", {export_ply, "binary PLY mesh file (3D shape only)",
+             describe_vertex_colour_mesh_opts}},
+    {"glb", {export_glb, "binary glTF mesh file (3D shape only)",
+             describe_vertex_colour_mesh_opts}},
+    {"vdb", {export_vdb, "OpenVDB level set file (3D shape only)",
+             describe_vdb_opts}},
     {"gpu", {export_gpu, "compiled GPU program, in Curv format (shape only)",
         describe_render_opts}},
     {"json", {export_json, "JSON expression", describe_no_opts}},
@@ -115,6 +115,26 @@ extern void export_x3d(curv::Value,
     const Export_Params& params,
     curv::Output_File&);
 
+extern void export_stlb(curv::Value,
+    curv::Program&,
+    const Export_Params& params,
+    curv::Output_File&);
+
+extern void export_ply(curv::Value,
+    curv::Program&,
+    const Export_Params& params,
+    curv::Output_File&);
+
+extern void export_glb(curv::Value,
+    curv::Program&,
+    const Export_Params& params,
+    curv::Output_File&);
+
+extern void export_vdb(curv::Value,
+    curv::Program&,
+    const Export_Params& params,
+    curv::Output_File&);
+
 extern void export_json(curv::Value value,
     curv::Program&,
     const Export_Params& params,
@@ -134,7 +154,10 @@ extern void export_png(curv::Value value,
     curv::Output_File&);
 
 void describe_mesh_opts(std::ostream&);
+void describe_tiled_mesh_opts(std::ostream&);
 void describe_colour_mesh_opts(std::ostream&);
+void describe_vertex_colour_mesh_opts(std::ostream&);
+void describe_vdb_opts(std::ostream&);
 
 void parse_viewer_config(
     const Export_Params& params,
@@ -2,16 +2,25 @@
 // Licensed under the Apache License, version 2.0
 // See accompanying file LICENSE or https://www.apache.org/licenses/LICENSE-2.0
 
+#include <algorithm>
 #include <iostream>
 #include <cmath>
 #include <cstdlib>
 #include <chrono>
+#include <thread>
+#include <vector>
 #include <openvdb/openvdb.h>
+#include <openvdb/io/File.h>
+#include <openvdb/tools/SignedFloodFill.h>
 #include <openvdb/tools/VolumeToMesh.h>
-#include <glm/geometric.hpp>
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
 
 #include "export.h"
+#include "mesh_writer.h"
 #include <libcurv/geom/compiled_shape.h>
+#include <libcurv/geom/vm_shape.h>
 #include <libcurv/shape.h>
 #include <libcurv/exception.h>
 #include <libcurv/context.h>
@@ -24,21 +33,26 @@ using openvdb::Vec3i;
 enum Mesh_Format {
     stl_format,
     obj_format,
-    x3d_format
+    x3d_format,
+    stlb_format,
+    ply_format,
+    glb_format,
+    vdb_format
 };
 
 void export_mesh(Mesh_Format, curv::Value value,
     curv::Program&,
     const Export_Params& params,
-    std::ostream& out);
+    curv::Output_File& ofile);
+void report_mesh(long long ntri, long long nquad, std::uintmax_t nbytes,
+    double write_time);
 
 void export_stl(curv::Value value,
     curv::Program& prog,
     const Export_Params& params,
     curv::Output_File& ofile)
 {
-    ofile.open();
-    export_mesh(stl_format, value, prog, params, ofile.ostream());
+    export_mesh(stl_format, value, prog, params, ofile);
 }
 
 void export_obj(curv::Value value,
@@ -46,8 +60,7 @@ void export_obj(curv::Value value,
     const Export_Params& params,
     curv::Output_File& ofile)
 {
-    ofile.open();
-    export_mesh(obj_format, value, prog, params, ofile.ostream());
+    export_mesh(obj_format, value, prog, params, ofile);
 }
 
 void export_x3d(curv::Value value,
@@ -55,57 +68,612 @@ void export_x3d(curv::Value value,
     const Export_Params& params,
     curv::Output_File& ofile)
 {
-    ofile.open();
-    export_mesh(x3d_format, value, prog, params, ofile.ostream());
+    export_mesh(x3d_format, value, prog, params, ofile);
 }
 
-void put_triangle(std::ostream& out, glm::vec3 v0, glm::vec3 v1, glm::vec3 v2)
+void export_stlb(curv::Value value,
+    curv::Program& prog,
+    const Export_Params& params,
+    curv::Output_File& ofile)
 {
-    glm::vec3 n = glm::normalize(glm::cross(v1 - v0, v2 - v0));
-    out << "facet normal " << n.x << " " << n.y << " " << n.z << "\n"
-        << " outer loop\n"
-        << "  vertex " << v0.x << " " << v0.y << " " << v0.z << "\n"
-        << "  vertex " << v1.x << " " << v1.y << " " << v1.z << "\n"
-        << "  vertex " << v2.x << " " << v2.y << " " << v2.z << "\n"
-        << " endloop\n"
-        << "endfacet\n";
+    export_mesh(stlb_format, value, prog, params, ofile);
 }
 
-curv::Vec3 linear_RGB_to_sRGB(curv::Vec3 c)
+void export_ply(curv::Value value,
+    curv::Program& prog,
+    const Export_Params& params,
+    curv::Output_File& ofile)
+{
+    export_mesh(ply_format, value, prog, params, ofile);
+}
+
+void export_glb(curv::Value value,
+    curv::Program& prog,
+    const Export_Params& params,
+    curv::Output_File& ofile)
 {
-    constexpr double k = 0.4545;
-    return curv::Vec3{pow(c.x, k), pow(c.y, k), pow(c.z, k)};
+    export_mesh(glb_format, value, prog, params, ofile);
 }
 
-void put_face_colour(std::ostream& out, curv::Shape& shape,
-    Vec3s v0, Vec3s v1, Vec3s v2)
+void export_vdb(curv::Value value,
+    curv::Program& prog,
+    const Export_Params& params,
+    curv::Output_File& ofile)
 {
-    Vec3s centroid = (v0 + v1 + v2) / 3.0;
-    curv::Vec3 c = shape.colour(centroid.x(), centroid.y(), centroid.z(), 0.0);
-    c = linear_RGB_to_sRGB(c);
-    out << " " << c.x << " " << c.y << " " << c.z;
+    export_mesh(vdb_format, value, prog, params, ofile);
 }
 
-void put_vertex_colour(std::ostream& out, curv::Shape& shape, Vec3s v)
+// Sample the linear RGB colour of a shape at `n` points, where `point(i)`
+// is the i'th point. Returns 3 floats per point. Points are sampled in
+// batches using colour_batch, so a Compiled_Shape evaluates a whole batch
+// in native code. If `parallel` is true then shape.colour must be thread safe,
+// and the batches are sampled in parallel.
+template <class F>
+std::vector<float> sample_colours(curv::Shape& shape, bool parallel,
+    size_t n, F point)
 {
-    curv::Vec3 c = shape.colour(v.x(), v.y(), v.z(), 0.0);
-    c = linear_RGB_to_sRGB(c);
-    out << " " << c.x << " " << c.y << " " << c.z;
+    constexpr size_t batch_size = 512;
+    std::vector<float> colours(3 * n);
+    auto sample_batch = [&](size_t b) -> void
+    {
+        float xs[batch_size], ys[batch_size], zs[batch_size], ts[batch_size];
+        float rs[batch_size], gs[batch_size], bs[batch_size];
+        size_t first = b * batch_size;
+        unsigned count = unsigned(std::min(batch_size, n - first));
+        for (unsigned i = 0; i < count; ++i) {
+            Vec3s p = point(first + i);
+            xs[i] = p.x();
+            ys[i] = p.y();
+            zs[i] = p.z();
+            ts[i] = 0.0;
+        }
+        const float* in[4] = {xs, ys, zs, ts};
+        float* out[3] = {rs, gs, bs};
+        shape.colour_batch(count, in, out);
+        for (unsigned i = 0; i < count; ++i) {
+            float* c = &colours[3 * (first + i)];
+            c[0] = rs[i];
+            c[1] = gs[i];
+            c[2] = bs[i];
+        }
+    };
+    size_t nbatches = (n + batch_size - 1) / batch_size;
+    if (parallel) {
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, nbatches),
+            [&](const tbb::blocked_range<size_t>& r) -> void
+            {
+                for (size_t b = r.begin(); b < r.end(); ++b)
+                    sample_batch(b);
+            });
+    } else {
+        for (size_t b = 0; b < nbatches; ++b)
+            sample_batch(b);
+    }
+    return colours;
 }
 
-inline glm::vec3 V3(Vec3s v)
+// The colour of each triangle in the mesh, sampled at the centroid,
+// in the order the triangles are written. Quads are split into two triangles.
+std::vector<float> face_colours(curv::Shape& shape, bool parallel,
+    openvdb::tools::VolumeToMesh& mesher)
 {
-    return glm::vec3{v.x(), v.y(), v.z()};
+    std::vector<Vec3s> centroids;
+    auto& points = mesher.pointList();
+    auto put = [&](unsigned a, unsigned b, unsigned c) -> void {
+        centroids.push_back((points[a] + points[b] + points[c]) / 3.0f);
+    };
+    for (unsigned int i=0; i<mesher.polygonPoolListSize(); ++i) {
+        openvdb::tools::PolygonPool& pool = mesher.polygonPoolList()[i];
+        for (unsigned int j=0; j<pool.numTriangles(); ++j) {
+            auto& t = pool.triangle(j);
+            put(t[0], t[2], t[1]);
+        }
+        for (unsigned int j=0; j<pool.numQuads(); ++j) {
+            auto& q = pool.quad(j);
+            put(q[0], q[2], q[1]);
+            put(q[0], q[3], q[2]);
+        }
+    }
+    return sample_colours(shape, parallel, centroids.size(),
+        [&](size_t i) -> Vec3s { return centroids[i]; });
 }
 
-void describe_mesh_opts(std::ostream& out)
+// The colour of each point in the mesh.
+std::vector<float> vertex_colours(curv::Shape& shape, bool parallel,
+    openvdb::tools::VolumeToMesh& mesher)
+{
+    auto& points = mesher.pointList();
+    return sample_colours(shape, parallel, mesher.pointListSize(),
+        [&](size_t i) -> Vec3s { return points[i]; });
+}
+
+// Sample the distance field of a 3D shape into a sparse level set grid.
+//
+// The voxel range is divided into an octree of cells. With `narrowband_`,
+// a cell is skipped if it can't intersect the narrow band around the surface,
+// so the number of samples scales with surface area instead of volume.
+// This relies on `dist` being a Lipschitz-1 bound on the Euclidean distance,
+// which is already required for sphere tracing. Skipped interior cells are
+// given negative inactive values by signed flood fill.
+//
+// If `parallel_` is true then shape_.dist must be thread safe. Top level
+// cells are sampled in parallel, each thread filling a private grid,
+// then the private grids are merged.
+struct Voxel_Sampler
+{
+    // 2.0 is the background (or default) distance value for this
+    // sparse array of voxels. Each voxel is a `float`.
+    static constexpr float background = 2.0;
+    // Active voxels are populated at least this many voxels away from the
+    // surface, both inside and outside, to provide a margin for error.
+    static constexpr int band_width = 2;
+    // Size of a top level cell, in voxels. This is the unit of parallelism.
+    static constexpr int top_size = 32;
+    // Cells this size or smaller are sampled densely.
+    static constexpr int leaf_size =
+        openvdb::FloatGrid::TreeType::LeafNodeType::DIM;
+
+    curv::Shape& shape_;
+    bool parallel_;
+    bool narrowband_;
+    double voxelsize_;
+    openvdb::CoordBBox range_;
+
+    // A compiled shape computes in single precision, and is sampled in
+    // batches. The interpreter is sampled one voxel at a time, so that
+    // the points are computed in double precision.
+    bool batch_ = dynamic_cast<curv::Shape_Program*>(&shape_) == nullptr;
+
+    // statistics
+    long long nsamples_ = 0;
+    int nthreads_ = 1;
+    double busy_time_ = 0.0;
+
+    openvdb::FloatGrid::Ptr sample();
+
+    template <class Accessor>
+    void sample_cell(Accessor&, openvdb::Coord lo, int size,
+        long long& nsamples);
+};
+constexpr float Voxel_Sampler::background;
+
+openvdb::FloatGrid::Ptr
+Voxel_Sampler::sample()
+{
+    openvdb::FloatGrid::Ptr grid = openvdb::FloatGrid::create(background);
+
+    // Attach a scaling transform that sets the voxel size in world space.
+    grid->setTransform(
+        openvdb::math::Transform::createLinearTransform(voxelsize_));
+
+    // Identify the grid as a signed distance field.
+    grid->setGridClass(openvdb::GRID_LEVEL_SET);
+
+    // Enumerate the top level cells, aligned to a multiple of top_size.
+    std::vector<openvdb::Coord> cells;
+    const openvdb::Coord& rmin = range_.min();
+    const openvdb::Coord& rmax = range_.max();
+    for (int x = rmin.x() & ~(top_size-1); x <= rmax.x(); x += top_size)
+        for (int y = rmin.y() & ~(top_size-1); y <= rmax.y(); y += top_size)
+            for (int z = rmin.z() & ~(top_size-1); z <= rmax.z(); z += top_size)
+                cells.push_back(openvdb::Coord{x,y,z});
+
+    if (parallel_) {
+        struct Local
+        {
+            openvdb::FloatGrid::Ptr grid =
+                openvdb::FloatGrid::create(background);
+            long long nsamples = 0;
+            double busy_time = 0.0;
+        };
+        tbb::enumerable_thread_specific<Local> locals;
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, cells.size()),
+            [&](const tbb::blocked_range<size_t>& r) -> void
+            {
+                auto start_time = std::chrono::steady_clock::now();
+                Local& local = locals.local();
+                auto acc = local.grid->getAccessor();
+                for (size_t i = r.begin(); i < r.end(); ++i)
+                    sample_cell(acc, cells[i], top_size, local.nsamples);
+                std::chrono::duration<double> busy_time =
+                    std::chrono::steady_clock::now() - start_time;
+                local.busy_time += busy_time.count();
+            });
+        // Each voxel was written by exactly one thread, so MERGE_ACTIVE_STATES
+        // never has to choose between two active values.
+        nthreads_ = 0;
+        for (auto& local : locals) {
+            grid->tree().merge(local.grid->tree());
+            nsamples_ += local.nsamples;
+            busy_time_ += local.busy_time;
+            ++nthreads_;
+        }
+    } else {
+        auto acc = grid->getAccessor();
+        for (auto& cell : cells)
+            sample_cell(acc, cell, top_size, nsamples_);
+    }
+
+    if (narrowband_)
+        openvdb::tools::signedFloodFill(grid->tree());
+    return grid;
+}
+
+// I assume each distance value is in the centre of a voxel.
+template <class Accessor>
+void
+Voxel_Sampler::sample_cell(
+    Accessor& acc, openvdb::Coord lo, int size, long long& nsamples)
+{
+    openvdb::CoordBBox cell(lo, lo.offsetBy(size - 1));
+    cell.intersect(range_);
+    if (cell.empty())
+        return;
+    const openvdb::Coord& cmin = cell.min();
+    const openvdb::Coord& cmax = cell.max();
+
+    if (narrowband_) {
+        // |dist| at the centre of the cell, minus the half-diagonal,
+        // is a lower bound on |dist| anywhere in the cell.
+        Vec3d centre = 0.5 * (cmin.asVec3d() + cmax.asVec3d()) * voxelsize_;
+        double d = shape_.dist(centre.x(), centre.y(), centre.z(), 0.0);
+        ++nsamples;
+        double halfdiag = 0.5 * (cmax - cmin).asVec3d().length() * voxelsize_;
+        if (std::abs(d) > halfdiag + band_width * voxelsize_)
+            return;
+    }
+
+    if (size <= leaf_size && !batch_) {
+        for (int x = cmin.x(); x <= cmax.x(); ++x) {
+            for (int y = cmin.y(); y <= cmax.y(); ++y) {
+                for (int z = cmin.z(); z <= cmax.z(); ++z) {
+                    acc.setValue(openvdb::Coord{x,y,z},
+                        shape_.dist(x*voxelsize_, y*voxelsize_, z*voxelsize_,
+                            0.0));
+                    ++nsamples;
+                }
+            }
+        }
+        return;
+    }
+    if (size <= leaf_size) {
+        // Sample the brick as a single batch, in structure-of-arrays layout.
+        constexpr int maxbatch = leaf_size * leaf_size * leaf_size;
+        float xs[maxbatch], ys[maxbatch], zs[maxbatch], ts[maxbatch];
+        float ds[maxbatch];
+        unsigned n = 0;
+        for (int x = cmin.x(); x <= cmax.x(); ++x) {
+            for (int y = cmin.y(); y <= cmax.y(); ++y) {
+                for (int z = cmin.z(); z <= cmax.z(); ++z) {
+                    xs[n] = x*voxelsize_;
+                    ys[n] = y*voxelsize_;
+                    zs[n] = z*voxelsize_;
+                    ts[n] = 0.0;
+                    ++n;
+                }
+            }
+        }
+        const float* in[4] = {xs, ys, zs, ts};
+        float* out[1] = {ds};
+        shape_.dist_batch(n, in, out);
+        n = 0;
+        for (int x = cmin.x(); x <= cmax.x(); ++x) {
+            for (int y = cmin.y(); y <= cmax.y(); ++y) {
+                for (int z = cmin.z(); z <= cmax.z(); ++z) {
+                    acc.setValue(openvdb::Coord{x,y,z}, ds[n++]);
+                }
+            }
+        }
+        nsamples += n;
+        return;
+    }
+
+    int half = size / 2;
+    for (int i = 0; i < 8; ++i) {
+        sample_cell(acc,
+            lo.offsetBy((i&1) * half, (i>>1&1) * half, (i>>2&1) * half),
+            half, nsamples);
+    }
+}
+
+// Tiled mesh export, for meshes that are too large to fit in memory.
+//
+// The voxel range is divided into cubic tiles. Each tile is sampled with a
+// margin of extra voxels around it, and meshed. The tile keeps only the
+// polygons that it owns: those whose minimum vertex (taking the minimum of
+// each coordinate) lies in a voxel cell inside the tile. Neighbouring tiles
+// sample the same voxels near their common boundary, so they compute
+// identical polygons and points there, and each polygon is owned by exactly
+// one tile. So the seams are closed, and the output doesn't depend on the
+// order in which tiles are processed. Adaptive meshing merges polygons
+// across cells, so it isn't supported.
+//
+// If `parallel_` is true, then a batch of tiles (one per hardware thread)
+// is processed in parallel, then the batch is written in order. Memory use
+// is bounded by the size of a batch of tiles, not the size of the mesh.
+struct Mesh_Tiler
+{
+    // The polygons owned by a tile use voxels up to 3 cells outside the tile.
+    static constexpr int margin = 4;
+
+    curv::Shape& shape_;
+    bool parallel_;
+    bool narrowband_;
+    double voxelsize_;
+    openvdb::CoordBBox range_;
+    int tile_size_;
+
+    // statistics
+    long long nsamples_ = 0;
+    long long ntri_ = 0;
+    long long nquad_ = 0;
+    int ntiles_ = 0;
+
+    void run(Tile_Writer&);
+    Tile_Mesh mesh_tile(const openvdb::CoordBBox& tile, long long& nsamples);
+
+    // The voxel cell containing a mesh point.
+    openvdb::Coord cell(const Vec3s& p) const
+    {
+        return openvdb::Coord(
+            int(std::floor(p.x() / voxelsize_)),
+            int(std::floor(p.y() / voxelsize_)),
+            int(std::floor(p.z() / voxelsize_)));
+    }
+};
+constexpr int Mesh_Tiler::margin;
+
+void
+Mesh_Tiler::run(Tile_Writer& writer)
+{
+    // Enumerate the tiles in z, y, x order.
+    std::vector<openvdb::CoordBBox> tiles;
+    const openvdb::Coord& rmin = range_.min();
+    const openvdb::Coord& rmax = range_.max();
+    for (int z = rmin.z(); z <= rmax.z(); z += tile_size_)
+        for (int y = rmin.y(); y <= rmax.y(); y += tile_size_)
+            for (int x = rmin.x(); x <= rmax.x(); x += tile_size_) {
+                openvdb::CoordBBox tile(openvdb::Coord{x,y,z},
+                    openvdb::Coord{x,y,z}.offsetBy(tile_size_ - 1));
+                tile.intersect(range_);
+                tiles.push_back(tile);
+            }
+    ntiles_ = int(tiles.size());
+
+    size_t batch_size =
+        parallel_ ? std::max(1u, std::thread::hardware_concurrency()) : 1;
+    std::vector<Tile_Mesh> meshes(batch_size);
+    std::vector<long long> nsamples(batch_size);
+    for (size_t b = 0; b < tiles.size(); b += batch_size) {
+        size_t e = std::min(tiles.size(), b + batch_size);
+        if (parallel_) {
+            tbb::parallel_for(tbb::blocked_range<size_t>(b, e),
+                [&](const tbb::blocked_range<size_t>& r) -> void
+                {
+                    for (size_t i = r.begin(); i < r.end(); ++i)
+                        meshes[i-b] = mesh_tile(tiles[i], nsamples[i-b]);
+                });
+        } else {
+            for (size_t i = b; i < e; ++i)
+                meshes[i-b] = mesh_tile(tiles[i], nsamples[i-b]);
+        }
+        for (size_t i = b; i < e; ++i) {
+            Tile_Mesh& m = meshes[i-b];
+            writer.write(m);
+            nsamples_ += nsamples[i-b];
+            ntri_ += m.triangles_.size();
+            nquad_ += m.quads_.size();
+            m = Tile_Mesh{};
+            // The polygons owned by later tiles have no vertex below the
+            // next layer of tiles.
+            if (i+1 < tiles.size()
+                && tiles[i+1].min().z() != tiles[i].min().z())
+            {
+                writer.forget_seam_below(
+                    float((tiles[i+1].min().z() - 1) * voxelsize_));
+            }
+        }
+    }
+}
+
+Tile_Mesh
+Mesh_Tiler::mesh_tile(const openvdb::CoordBBox& tile, long long& nsamples)
+{
+    openvdb::CoordBBox srange = tile;
+    srange.expand(margin);
+    srange.intersect(range_);
+    Voxel_Sampler sampler{shape_, parallel_, narrowband_, voxelsize_, srange};
+    openvdb::FloatGrid::Ptr grid = sampler.sample();
+    nsamples = sampler.nsamples_;
+    openvdb::tools::VolumeToMesh mesher(0.0, 0.0);
+    mesher(*grid);
+    grid.reset();
+
+    // Points within 2 cells of the tile boundary may be shared with
+    // polygons owned by a neighbouring tile.
+    openvdb::CoordBBox inner = tile;
+    inner.expand(-2);
+    auto& points = mesher.pointList();
+    Tile_Mesh m;
+    std::vector<unsigned> index(mesher.pointListSize(), ~0u);
+    auto add = [&](unsigned p) -> unsigned
+    {
+        if (index[p] == ~0u) {
+            index[p] = unsigned(m.points_.size());
+            m.points_.push_back(points[p]);
+            m.seam_.push_back(!inner.isInside(cell(points[p])));
+        }
+        return index[p];
+    };
+    auto owned = [&](const auto& poly, int n) -> bool
+    {
+        openvdb::Coord c = cell(points[poly[0]]);
+        for (int k = 1; k < n; ++k)
+            c = openvdb::Coord::minComponent(c, cell(points[poly[k]]));
+        return tile.isInside(c);
+    };
+    for (size_t i = 0; i < mesher.polygonPoolListSize(); ++i) {
+        openvdb::tools::PolygonPool& pool = mesher.polygonPoolList()[i];
+        for (size_t j = 0; j < pool.numTriangles(); ++j) {
+            auto& t = pool.triangle(j);
+            if (owned(t, 3))
+                m.triangles_.emplace_back(add(t[0]), add(t[1]), add(t[2]));
+        }
+        for (size_t j = 0; j < pool.numQuads(); ++j) {
+            auto& q = pool.quad(j);
+            if (owned(q, 4)) {
+                m.quads_.emplace_back(
+                    add(q[0]), add(q[1]), add(q[2]), add(q[3]));
+            }
+        }
+    }
+    return m;
+}
+
+void export_tiled_mesh(Mesh_Format format, curv::Shape& shape, bool parallel,
+    bool narrowband, double voxelsize, const openvdb::CoordBBox& voxelrange,
+    int tile_size, std::ostream& out)
+{
+    std::unique_ptr<Tile_Writer> writer;
+    switch (format) {
+    case stl_format:
+        writer = make_stl_tile_writer(out);
+        break;
+    case stlb_format:
+        writer = make_stlb_tile_writer(out);
+        break;
+    case obj_format:
+        writer = make_obj_tile_writer(out);
+        break;
+    default:
+        curv::die("bad tiled mesh format");
+    }
+
+    auto start_time = std::chrono::steady_clock::now();
+    Mesh_Tiler tiler{shape, parallel, narrowband, voxelsize, voxelrange,
+        tile_size};
+    tiler.run(*writer);
+    std::uintmax_t nbytes = writer->finish();
+    std::chrono::duration<double> render_time =
+        std::chrono::steady_clock::now() - start_time;
+    std::cerr
+        << "Rendered and meshed " << tiler.ntiles_ << " tiles of "
+        << tile_size << "×" << tile_size << "×" << tile_size << " voxels ("
+        << tiler.nsamples_ << " samples) in " << render_time.count() << "s.\n";
+    if (format == obj_format)
+        report_mesh(tiler.ntri_, tiler.nquad_, nbytes, render_time.count());
+    else {
+        // quads are split into triangles
+        report_mesh(tiler.ntri_ + 2 * tiler.nquad_, 0, nbytes,
+            render_time.count());
+    }
+}
+
+// A grid with the same active voxels as `grid`, containing the linear RGB
+// colour of the shape at each voxel.
+openvdb::Vec3SGrid::Ptr
+colour_grid(const openvdb::FloatGrid& grid, curv::Shape& shape, bool parallel)
+{
+    openvdb::Vec3SGrid::Ptr cgrid =
+        openvdb::Vec3SGrid::create(Vec3s(0.0f, 0.0f, 0.0f));
+    cgrid->setTransform(grid.transform().copy());
+    cgrid->tree().topologyUnion(grid.tree());
+
+    std::vector<openvdb::Coord> voxels;
+    for (auto leaf = cgrid->tree().cbeginLeaf(); leaf; ++leaf) {
+        for (auto v = leaf->cbeginValueOn(); v; ++v)
+            voxels.push_back(v.getCoord());
+    }
+    std::vector<float> colours = sample_colours(shape, parallel, voxels.size(),
+        [&](size_t i) -> Vec3s
+        {
+            return Vec3s(grid.transform().indexToWorld(voxels[i]));
+        });
+    size_t i = 0;
+    for (auto leaf = cgrid->tree().beginLeaf(); leaf; ++leaf) {
+        for (auto v = leaf->beginValueOn(); v; ++v, ++i) {
+            v.setValue(
+                Vec3s(colours[3*i], colours[3*i + 1], colours[3*i + 2]));
+        }
+    }
+    return cgrid;
+}
+
+// Write the sampled signed distance field to a VDB file, plus an optional
+// colour grid. The compression is Blosc if the OpenVDB library supports it,
+// otherwise zip.
+void
+write_vdb(openvdb::FloatGrid::Ptr grid, bool colour, curv::Shape& shape,
+    bool parallel, curv::Output_File& ofile)
+{
+    grid->setName("distance");
+    grid->setCreator("Curv");
+    openvdb::GridPtrVec grids;
+    grids.push_back(grid);
+    if (colour) {
+        auto colour_start = std::chrono::steady_clock::now();
+        openvdb::Vec3SGrid::Ptr cgrid = colour_grid(*grid, shape, parallel);
+        cgrid->setName("colour");
+        cgrid->setCreator("Curv");
+        std::chrono::duration<double> colour_time =
+            std::chrono::steady_clock::now() - colour_start;
+        std::cerr << "Computed " << cgrid->activeVoxelCount()
+            << " colours in " << colour_time.count() << "s.\n";
+        grids.push_back(cgrid);
+    }
+
+    auto write_start = std::chrono::steady_clock::now();
+    const curv::Filesystem::path& path = ofile.path();
+    openvdb::io::File file(path.string());
+    file.setCompression(openvdb::io::COMPRESS_ACTIVE_MASK
+        | (openvdb::io::Archive::hasBloscCompression()
+           ? openvdb::io::COMPRESS_BLOSC : openvdb::io::COMPRESS_ZIP));
+    file.write(grids);
+    file.close();
+    std::chrono::duration<double> write_time =
+        std::chrono::steady_clock::now() - write_start;
+
+    std::uintmax_t nbytes = curv::Filesystem::file_size(path);
+    double mb = nbytes / 1e6;
+    std::cerr << grid->activeVoxelCount() << " active voxels"
+        << "; wrote " << mb << " MB in " << write_time.count()
+        << "s (" << mb / write_time.count() << " MB/s).\n";
+}
+
+void describe_voxel_opts(std::ostream& out)
 {
     out <<
     "-O jit : Fast evaluation using JIT compiler (uses C++ compiler).\n"
+    "-O jit_cache=false : Don't use the cache of JIT compiled shapes.\n"
+    "-O vm : Fast evaluation using the SubCurv VM (no C++ compiler needed).\n"
+    "    Faster than the interpreter, slower than the JIT. Single precision.\n"
     "-O vsize=<voxel size>\n"
+    "-O narrowband=true|false : Only sample voxels near the surface\n"
+    "    (default true). Disable if 'dist' is not a valid distance bound.\n"
+    ;
+}
+void describe_mesh_opts(std::ostream& out)
+{
+    describe_voxel_opts(out);
+    out <<
     "-O adaptive=<0...1> : Deprecated. Use meshlab to simplify mesh.\n"
     ;
 }
+void describe_vdb_opts(std::ostream& out)
+{
+    describe_voxel_opts(out);
+    out <<
+    "-O colour=true|false : Include a colour grid (default false)\n"
+    ;
+}
+void describe_tiled_mesh_opts(std::ostream& out)
+{
+    describe_mesh_opts(out);
+    out <<
+    "-O tile=<N> : Sample and mesh the shape in tiles of N×N×N voxels (N >= 16),\n"
+    "    to limit memory use. Tiles are written as they are finished.\n"
+    ;
+}
 void describe_colour_mesh_opts(std::ostream& out)
 {
     describe_mesh_opts(out);
@@ -113,31 +681,52 @@ void describe_colour_mesh_opts(std::ostream& out)
     "-O colouring=#face|#vertex (default #face)\n"
     ;
 }
+void describe_vertex_colour_mesh_opts(std::ostream& out)
+{
+    describe_mesh_opts(out);
+    out <<
+    "-O colour=true|false : Include vertex colours (default false)\n"
+    ;
+}
 
 void export_mesh(Mesh_Format format, curv::Value value,
     curv::Program& prog,
     const Export_Params& params,
-    std::ostream& out)
+    curv::Output_File& ofile)
 {
     curv::Shape_Program shape(prog);
     curv::At_Program cx(prog);
+    const char* what = format == vdb_format ? "VDB export" : "mesh export";
     if (!shape.recognize(value, nullptr) || !shape.is_3d_)
-        throw curv::Exception(cx, "mesh export: not a 3D shape");
+        throw curv::Exception(cx, curv::stringify(what, ": not a 3D shape"));
 
     bool jit = false;
+    bool jit_cache = true;
+    bool vm = false;
+    bool narrowband = true;
     double vsize = 0.0;
     double adaptive = 0.0;
     enum {face_colour, vertex_colour} colouring = face_colour;
+    bool colour = false;
+    int tile = 0;
     for (auto& i : params.map_) {
         Param p{params, i};
         if (p.name_ == "jit")
             jit = p.to_bool();
+        else if (p.name_ == "jit_cache")
+            jit_cache = p.to_bool();
+        else if (p.name_ == "vm")
+            vm = p.to_bool();
+        else if (p.name_ == "narrowband")
+            narrowband = p.to_bool();
         else if (p.name_ == "vsize") {
             vsize = p.to_double();
             if (vsize <= 0.0) {
                 throw curv::Exception(p, "'vsize' must be positive");
             }
-        } else if (p.name_ == "adaptive") {
+        } else if (format != Mesh_Format::vdb_format
+                   && p.name_ == "adaptive")
+        {
             adaptive = p.to_double(1.0);
             if (adaptive < 0.0 || adaptive > 1.0) {
                 throw curv::Exception(p, "'adaptive' must be in range 0...1");
@@ -151,21 +740,56 @@ void export_mesh(Mesh_Format format, curv::Value value,
             else {
                 throw curv::Exception(p, "'colouring' must be #face or #vertex");
             }
+        } else if ((format == Mesh_Format::ply_format
+                    || format == Mesh_Format::glb_format
+                    || format == Mesh_Format::vdb_format)
+                   && p.name_ == "colour")
+        {
+            colour = p.to_bool();
+        } else if ((format == Mesh_Format::stl_format
+                    || format == Mesh_Format::stlb_format
+                    || format == Mesh_Format::obj_format)
+                   && p.name_ == "tile")
+        {
+            tile = p.to_int(16, 1 << 20);
         } else
             p.unknown_parameter();
     }
+    if (tile > 0 && adaptive > 0.0) {
+        throw curv::Exception(cx,
+            "mesh export: 'adaptive' can't be used with 'tile'");
+    }
 
     std::unique_ptr<curv::geom::Compiled_Shape> cshape = nullptr;
     if (jit) {
         //std::chrono::time_point<std::chrono::steady_clock> cstart_time, cend_time;
         auto cstart_time = std::chrono::steady_clock::now();
-        cshape = std::make_unique<curv::geom::Compiled_Shape>(shape);
+        cshape = std::make_unique<curv::geom::Compiled_Shape>(
+            shape, jit_cache);
         auto cend_time = std::chrono::steady_clock::now();
         std::chrono::duration<double> compile_time = cend_time - cstart_time;
         std::cerr
             << "Compiled shape in " << compile_time.count() << "s\n";
         std::cerr.flush();
     }
+    std::unique_ptr<curv::geom::VM_Shape> vshape = nullptr;
+    if (!jit && vm) {
+        auto cstart_time = std::chrono::steady_clock::now();
+        try {
+            vshape = std::make_unique<curv::geom::VM_Shape>(shape);
+            auto cend_time = std::chrono::steady_clock::now();
+            std::chrono::duration<double> compile_time =
+                cend_time - cstart_time;
+            std::cerr
+                << "Compiled shape to VM code in "
+                << compile_time.count() << "s\n";
+        } catch (curv::Exception& e) {
+            // Not all shapes are supported by the VM: use the interpreter.
+            std::cerr << e.what() << "\n"
+                << "Using the interpreter instead.\n";
+        }
+        std::cerr.flush();
+    }
 
     Vec3d size(
         shape.bbox_.xmax - shape.bbox_.xmin,
@@ -174,7 +798,7 @@ void export_mesh(Mesh_Format format, curv::Value value,
     double volume = size.x() * size.y() * size.z();
     double infinity = 1.0/0.0;
     if (volume == infinity || volume == -infinity) {
-        throw curv::Exception(cx, "mesh export: shape is infinite");
+        throw curv::Exception(cx, curv::stringify(what, ": shape is infinite"));
     }
 
     double voxelsize;
@@ -209,203 +833,123 @@ void export_mesh(Mesh_Format format, curv::Value value,
 
     openvdb::initialize();
 
+    curv::Shape* sshape = &shape;
+    if (cshape != nullptr)
+        sshape = &*cshape;
+    else if (vshape != nullptr)
+        sshape = &*vshape;
+    bool parallel = sshape != &shape; // the interpreter is not thread safe
+    openvdb::CoordBBox voxelrange{
+        voxelrange_min.x(), voxelrange_min.y(), voxelrange_min.z(),
+        voxelrange_max.x(), voxelrange_max.y(), voxelrange_max.z()};
+
+    if (tile > 0) {
+        ofile.open();
+        export_tiled_mesh(format, *sshape, parallel, narrowband, voxelsize,
+            voxelrange, tile, ofile.ostream());
+        return;
+    }
+
     // Create a FloatGrid and populate it with a signed distance field.
     std::chrono::time_point<std::chrono::steady_clock> start_time, end_time;
     start_time = std::chrono::steady_clock::now();
 
-    // 2.0 is the background (or default) distance value for this
-    // sparse array of voxels. Each voxel is a `float`.
-    openvdb::FloatGrid::Ptr grid = openvdb::FloatGrid::create(2.0);
-
-    // Attach a scaling transform that sets the voxel size in world space.
-    grid->setTransform(
-        openvdb::math::Transform::createLinearTransform(voxelsize));
+    Voxel_Sampler sampler{*sshape, parallel, narrowband, voxelsize, voxelrange};
+    openvdb::FloatGrid::Ptr grid = sampler.sample();
 
-    // Identify the grid as a signed distance field.
-    grid->setGridClass(openvdb::GRID_LEVEL_SET);
-
-    // Populate the grid.
-    // I assume each distance value is in the centre of a voxel.
-    auto accessor = grid->getAccessor();
-    if (cshape != nullptr) {
-        // TODO: use multiple threads, since cshape->dist is thread safe.
-        for (int x = voxelrange_min.x(); x <= voxelrange_max.x(); ++x) {
-            for (int y = voxelrange_min.y(); y <= voxelrange_max.y(); ++y) {
-                for (int z = voxelrange_min.z(); z <= voxelrange_max.z(); ++z) {
-                    accessor.setValue(openvdb::Coord{x,y,z},
-                        cshape->dist(x*voxelsize, y*voxelsize, z*voxelsize, 0.0));
-                }
-            }
-        }
-    } else {
-        for (int x = voxelrange_min.x(); x <= voxelrange_max.x(); ++x) {
-            for (int y = voxelrange_min.y(); y <= voxelrange_max.y(); ++y) {
-                for (int z = voxelrange_min.z(); z <= voxelrange_max.z(); ++z) {
-                    accessor.setValue(openvdb::Coord{x,y,z},
-                        shape.dist(x*voxelsize, y*voxelsize, z*voxelsize, 0.0));
-                }
-            }
-        }
-    }
     end_time = std::chrono::steady_clock::now();
     std::chrono::duration<double> render_time = end_time - start_time;
-    int nvoxels =
-        (voxelrange_max.x() - voxelrange_min.x() + 1) *
-        (voxelrange_max.y() - voxelrange_min.y() + 1) *
-        (voxelrange_max.z() - voxelrange_min.z() + 1);
+    long long nvoxels = sampler.range_.volume();
+    std::cerr
+        << "Rendered " << nvoxels << " voxels";
+    if (sampler.nsamples_ != nvoxels)
+        std::cerr << " (" << sampler.nsamples_ << " samples)";
     std::cerr
-        << "Rendered " << nvoxels
-        << " voxels in " << render_time.count() << "s ("
-        << int(nvoxels/render_time.count()) << " voxels/s).\n";
+        << " in " << render_time.count() << "s ("
+        << (long long)(nvoxels/render_time.count()) << " voxels/s";
+    if (sampler.nthreads_ > 1) {
+        // The speedup is the total time spent sampling, summed across
+        // all threads, divided by the elapsed time.
+        std::cerr
+            << ", " << sampler.nthreads_ << " threads, "
+            << (sampler.busy_time_/render_time.count()) << "x speedup";
+    }
+    std::cerr << ").\n";
     std::cerr.flush();
 
+    if (format == vdb_format) {
+        write_vdb(grid, colour, *sshape, parallel, ofile);
+        return;
+    }
+
     // convert grid to a mesh
     openvdb::tools::VolumeToMesh mesher(0.0, adaptive);
     mesher(*grid);
 
+    // Sample the colours before writing, using the fastest available
+    // evaluator, in parallel if it is thread safe.
+    std::vector<float> colours;
+    if (format == x3d_format || colour) {
+        auto colour_start = std::chrono::steady_clock::now();
+        if (format == x3d_format && colouring == face_colour)
+            colours = face_colours(*sshape, parallel, mesher);
+        else
+            colours = vertex_colours(*sshape, parallel, mesher);
+        std::chrono::duration<double> colour_time =
+            std::chrono::steady_clock::now() - colour_start;
+        std::cerr << "Computed " << colours.size() / 3 << " colours in "
+            << colour_time.count() << "s.\n";
+        std::cerr.flush();
+    }
+
     // output a mesh file
-    int ntri = 0;
-    int nquad = 0;
+    long long ntri = 0;
+    long long nquad = 0;
+    for (unsigned int i=0; i<mesher.polygonPoolListSize(); ++i) {
+        openvdb::tools::PolygonPool& pool = mesher.polygonPoolList()[i];
+        ntri += pool.numTriangles();
+        nquad += pool.numQuads();
+    }
+    if (format != obj_format && format != ply_format) {
+        // quads are split into triangles
+        ntri += 2 * nquad;
+        nquad = 0;
+    }
+    ofile.open();
+    std::ostream& out = ofile.ostream();
+    std::uintmax_t nbytes = 0;
+    auto write_start = std::chrono::steady_clock::now();
     switch (format) {
     case stl_format:
-        out << "solid curv\n";
-        for (unsigned int i=0; i<mesher.polygonPoolListSize(); ++i) {
-            openvdb::tools::PolygonPool& pool = mesher.polygonPoolList()[i];
-            for (unsigned int j=0; j<pool.numTriangles(); ++j) {
-                // swap ordering of nodes to get outside-normals
-                put_triangle(out,
-                    V3(mesher.pointList()[ pool.triangle(j)[0] ]),
-                    V3(mesher.pointList()[ pool.triangle(j)[2] ]),
-                    V3(mesher.pointList()[ pool.triangle(j)[1] ]));
-                ++ntri;
-            }
-            for (unsigned int j=0; j<pool.numQuads(); ++j) {
-                // swap ordering of nodes to get outside-normals
-                put_triangle(out,
-                    V3(mesher.pointList()[ pool.quad(j)[0] ]),
-                    V3(mesher.pointList()[ pool.quad(j)[2] ]),
-                    V3(mesher.pointList()[ pool.quad(j)[1] ]));
-                put_triangle(out,
-                    V3(mesher.pointList()[ pool.quad(j)[0] ]),
-                    V3(mesher.pointList()[ pool.quad(j)[3] ]),
-                    V3(mesher.pointList()[ pool.quad(j)[2] ]));
-                ntri += 2;
-            }
-        }
-        out << "endsolid curv\n";
+        nbytes = write_stl(out, mesher);
         break;
     case obj_format:
-        for (unsigned int i = 0; i < mesher.pointListSize(); ++i) {
-            auto& pt = mesher.pointList()[i];
-            out << "v " << pt.x() << " " << pt.y() << " " << pt.z() << "\n";
-        }
-        for (unsigned int i=0; i<mesher.polygonPoolListSize(); ++i) {
-            openvdb::tools::PolygonPool& pool = mesher.polygonPoolList()[i];
-            for (unsigned int j=0; j<pool.numTriangles(); ++j) {
-                // swap ordering of nodes to get outside-normals
-                auto& tri = pool.triangle(j);
-                out << "f " << tri[0]+1 << " "
-                            << tri[2]+1 << " "
-                            << tri[1]+1 << "\n";
-                ++ntri;
-            }
-            for (unsigned int j=0; j<pool.numQuads(); ++j) {
-                // swap ordering of nodes to get outside-normals
-                auto& q = pool.quad(j);
-                out << "f " << q[0]+1 << " "
-                            << q[3]+1 << " "
-                            << q[2]+1 << " "
-                            << q[1]+1 << "\n";
-                ++nquad;
-            }
-        }
+        nbytes = write_obj(out, mesher);
         break;
     case x3d_format:
-      {
-        out <<
-        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
-        "<!DOCTYPE X3D PUBLIC \"ISO//Web3D//DTD X3D 3.1//EN\" \"http://www.web3d.org/specifications/x3d-3.1.dtd\">\n"
-        "<X3D profile=\"Interchange\" version=\"3.1\" xsd:noNamespaceSchemaLocation=\"http://www.web3d.org/specifications/x3d-3.1.xsd\" xmlns:xsd=\"http://www.w3.org/2001/XMLSchema-instance\">\n"
-        " <head>\n"
-        "  <meta content=\"Curv, https://github.com/doug-moen/curv\" name=\"generator\"/>\n"
-        " </head>\n"
-        " <Scene>\n"
-        "  <Shape>\n"
-        "   <IndexedFaceSet colorPerVertex=\"";
-        out << (colouring == vertex_colour ? "true" : "false");
-        out << "\" coordIndex=\"";
-        bool first = true;
-        for (unsigned int i=0; i<mesher.polygonPoolListSize(); ++i) {
-            openvdb::tools::PolygonPool& pool = mesher.polygonPoolList()[i];
-            for (unsigned int j=0; j<pool.numTriangles(); ++j) {
-                if (!first) out << " ";
-                first = false;
-                auto& tri = pool.triangle(j);
-                out << tri[0] << " " << tri[2] << " " << tri[1] << " -1";
-                ++ntri;
-            }
-            for (unsigned int j=0; j<pool.numQuads(); ++j) {
-                if (!first) out << " ";
-                first = false;
-                auto& q = pool.quad(j);
-                out << q[0] << " " << q[2] << " " << q[1] << " -1 "
-                    << q[0] << " " << q[3] << " " << q[2] << " -1";
-                ntri += 2;
-            }
-        }
-        out <<
-        "\">\n"
-        "    <Coordinate point=\"";
-        first = true;
-        for (unsigned int i = 0; i < mesher.pointListSize(); ++i) {
-            if (!first) out << " ";
-            first = false;
-            auto& pt = mesher.pointList()[i];
-            out << pt.x() << " " << pt.y() << " " << pt.z();
-        }
-        out <<
-        "\"/>\n"
-        "    <Color color=\"";
-        switch (colouring) {
-        case face_colour:
-            for (unsigned int i=0; i<mesher.polygonPoolListSize(); ++i) {
-                openvdb::tools::PolygonPool& pool = mesher.polygonPoolList()[i];
-                for (unsigned int j=0; j<pool.numTriangles(); ++j) {
-                    put_face_colour(out, shape,
-                        mesher.pointList()[ pool.triangle(j)[0] ],
-                        mesher.pointList()[ pool.triangle(j)[2] ],
-                        mesher.pointList()[ pool.triangle(j)[1] ]);
-                }
-                for (unsigned int j=0; j<pool.numQuads(); ++j) {
-                    put_face_colour(out, shape,
-                        mesher.pointList()[ pool.quad(j)[0] ],
-                        mesher.pointList()[ pool.quad(j)[2] ],
-                        mesher.pointList()[ pool.quad(j)[1] ]);
-                    put_face_colour(out, shape,
-                        mesher.pointList()[ pool.quad(j)[0] ],
-                        mesher.pointList()[ pool.quad(j)[3] ],
-                        mesher.pointList()[ pool.quad(j)[2] ]);
-                }
-            }
-            break;
-        case vertex_colour:
-            for (unsigned int i = 0; i < mesher.pointListSize(); ++i) {
-                put_vertex_colour(out, shape, mesher.pointList()[i]);
-            }
-            break;
-        }
-        out <<
-        "\"/>\n"
-        "   </IndexedFaceSet>\n"
-        "  </Shape>\n"
-        " </Scene>\n"
-        "</X3D>\n";
+        nbytes = write_x3d(out, mesher, colours, colouring == vertex_colour);
+        break;
+    case stlb_format:
+        nbytes = write_stlb(out, mesher);
+        break;
+    case ply_format:
+        nbytes = write_ply(out, mesher, colour ? &colours : nullptr);
+        break;
+    case glb_format:
+        nbytes = write_glb(out, mesher, colour ? &colours : nullptr);
         break;
-      }
     default:
         curv::die("bad mesh format");
     }
+    std::chrono::duration<double> write_time =
+        std::chrono::steady_clock::now() - write_start;
+    report_mesh(ntri, nquad, nbytes, write_time.count());
+}
 
+// Report the size of the mesh, and how long it took to write.
+void report_mesh(long long ntri, long long nquad, std::uintmax_t nbytes,
+    double write_time)
+{
     if (ntri == 0 && nquad == 0) {
         std::cerr << "WARNING: no mesh was created (no volumes were found).\n"
           << "Maybe you should try a smaller voxel size.\n";
@@ -416,6 +960,11 @@ void export_mesh(Mesh_Format format, curv::Value value,
             std::cerr << ", ";
         if (nquad > 0)
             std::cerr << nquad << " quads";
+        if (nbytes > 0) {
+            double mb = nbytes / 1e6;
+            std::cerr << "; wrote " << mb << " MB in " << write_time
+                << "s (" << mb / write_time << " MB/s)";
+        }
         std::cerr << ".\n";
     }
 }
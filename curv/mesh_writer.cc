@@ -0,0 +1,838 @@
+// Copyright 2016-2019 Doug Moen
+// Licensed under the Apache License, version 2.0
+// See accompanying file LICENSE or https://www.apache.org/licenses/LICENSE-2.0
+
+#include "mesh_writer.h"
+
+#include <libcurv/dtostr.h>
+#include <libcurv/exception.h>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+using openvdb::Vec3s;
+using openvdb::tools::PolygonPool;
+using openvdb::tools::VolumeToMesh;
+
+namespace {
+
+// Buffers binary output, and writes it to an ostream in large blocks.
+// Numbers are written in little-endian byte order.
+struct Block_Writer
+{
+    static constexpr size_t block_size = 1 << 20;
+
+    std::ostream& out_;
+    std::unique_ptr<char[]> buf_{new char[block_size]};
+    size_t pos_ = 0;
+    std::uintmax_t count_ = 0;
+
+    Block_Writer(std::ostream& out) : out_(out) {}
+
+    char* reserve(size_t n)
+    {
+        if (pos_ + n > block_size)
+            flush();
+        char* p = &buf_[pos_];
+        pos_ += n;
+        return p;
+    }
+    void bytes(const void* data, size_t n)
+    {
+        const char* p = (const char*)data;
+        while (n > 0) {
+            if (pos_ == block_size)
+                flush();
+            size_t k = std::min(n, block_size - pos_);
+            memcpy(&buf_[pos_], p, k);
+            pos_ += k;
+            p += k;
+            n -= k;
+        }
+    }
+    void bytes(const std::string& s) { bytes(s.data(), s.size()); }
+    void u8(std::uint8_t n) { *reserve(1) = char(n); }
+    void u16(std::uint16_t n)
+    {
+        char* p = reserve(2);
+        p[0] = char(n);
+        p[1] = char(n >> 8);
+    }
+    void u32(std::uint32_t n)
+    {
+        char* p = reserve(4);
+        p[0] = char(n);
+        p[1] = char(n >> 8);
+        p[2] = char(n >> 16);
+        p[3] = char(n >> 24);
+    }
+    void f32(float f)
+    {
+        std::uint32_t n;
+        memcpy(&n, &f, 4);
+        u32(n);
+    }
+    void vec3(const Vec3s& v)
+    {
+        f32(v.x());
+        f32(v.y());
+        f32(v.z());
+    }
+    void flush()
+    {
+        out_.write(&buf_[0], pos_);
+        count_ += pos_;
+        pos_ = 0;
+    }
+    // Flush the buffer, and return the total number of bytes written.
+    std::uintmax_t finish()
+    {
+        flush();
+        out_.flush();
+        return count_;
+    }
+};
+
+std::uintmax_t
+count_triangles(VolumeToMesh& mesher)
+{
+    std::uintmax_t ntri = 0;
+    for (size_t i = 0; i < mesher.polygonPoolListSize(); ++i) {
+        PolygonPool& pool = mesher.polygonPoolList()[i];
+        ntri += pool.numTriangles() + 2 * pool.numQuads();
+    }
+    return ntri;
+}
+
+// Call f(a,b,c) with the point indexes of each triangle, with the winding
+// order reversed to get outside normals.
+template <class F>
+void
+for_each_triangle(VolumeToMesh& mesher, F f)
+{
+    for (size_t i = 0; i < mesher.polygonPoolListSize(); ++i) {
+        PolygonPool& pool = mesher.polygonPoolList()[i];
+        for (size_t j = 0; j < pool.numTriangles(); ++j) {
+            auto& t = pool.triangle(j);
+            f(t[0], t[2], t[1]);
+        }
+        for (size_t j = 0; j < pool.numQuads(); ++j) {
+            auto& q = pool.quad(j);
+            f(q[0], q[2], q[1]);
+            f(q[0], q[3], q[2]);
+        }
+    }
+}
+
+Vec3s
+facet_normal(const Vec3s& v0, const Vec3s& v1, const Vec3s& v2)
+{
+    Vec3s n = (v1 - v0).cross(v2 - v0);
+    float len = n.length();
+    if (len > 0.0f)
+        n *= 1.0f / len;
+    return n;
+}
+
+// Convert a linear RGB colour component to an 8 bit sRGB value,
+// using the same approximation as the X3D exporter.
+std::uint8_t
+srgb_byte(float c)
+{
+    c = std::pow(std::max(0.0f, std::min(c, 1.0f)), 0.4545f);
+    return std::uint8_t(std::lround(c * 255.0f));
+}
+
+// A float, printed with enough precision to be read back exactly.
+struct Exact
+{
+    float f_;
+};
+std::ostream&
+operator<<(std::ostream& out, Exact x)
+{
+    return out << std::setprecision(9) << double(x.f_);
+}
+
+// Text output is formatted into a Text buffer using <<, like an ostream,
+// but without the overhead of locales and stream state. Floats are printed
+// as the shortest string that reads back exactly.
+struct Text
+{
+    std::string s_;
+};
+inline Text& operator<<(Text& t, const char* s) { t.s_ += s; return t; }
+inline Text& operator<<(Text& t, char c) { t.s_ += c; return t; }
+inline Text& operator<<(Text& t, float f)
+{
+    char buf[curv::DTOSTR_BUFSIZE];
+    curv::ftostr(f, buf);
+    t.s_ += buf;
+    return t;
+}
+inline Text& operator<<(Text& t, unsigned n)
+{
+    char buf[16];
+    char* p = buf + sizeof(buf);
+    do {
+        *--p = char('0' + n % 10);
+        n /= 10;
+    } while (n != 0);
+    t.s_.append(p, buf + sizeof(buf) - p);
+    return t;
+}
+inline Text& operator<<(Text& t, const Vec3s& v)
+{
+    return t << v.x() << ' ' << v.y() << ' ' << v.z();
+}
+
+// Write `nitems` items of text to `out`, in order. `format(i, text)` appends
+// the text of item i. Items are formatted in parallel, a batch at a time,
+// so that memory use doesn't grow with the size of the mesh. If `skip_first`
+// is true, then the first character of the output (a separator) is dropped.
+// Returns the number of bytes written.
+template <class F>
+std::uintmax_t
+write_text(std::ostream& out, size_t nitems, F format, bool skip_first = false)
+{
+    constexpr size_t batch_size = 256;
+    std::vector<Text> texts(std::min(nitems, batch_size));
+    std::uintmax_t count = 0;
+    for (size_t b = 0; b < nitems; b += batch_size) {
+        size_t e = std::min(nitems, b + batch_size);
+        tbb::parallel_for(tbb::blocked_range<size_t>(b, e),
+            [&](const tbb::blocked_range<size_t>& r) -> void
+            {
+                for (size_t i = r.begin(); i < r.end(); ++i) {
+                    Text& t = texts[i - b];
+                    t.s_.clear();
+                    format(i, t);
+                }
+            });
+        for (size_t i = b; i < e; ++i) {
+            const std::string& s = texts[i - b].s_;
+            size_t skip = (skip_first && count == 0 && !s.empty()) ? 1 : 0;
+            out.write(s.data() + skip, s.size() - skip);
+            count += s.size() - skip;
+        }
+    }
+    return count;
+}
+
+// The point list is formatted in chunks of this many points.
+constexpr size_t points_per_chunk = 4096;
+
+size_t
+num_point_chunks(VolumeToMesh& mesher)
+{
+    return (mesher.pointListSize() + points_per_chunk - 1) / points_per_chunk;
+}
+
+// Call f(p) for each point in the i'th chunk of the point list.
+template <class F>
+void
+for_each_point_in_chunk(VolumeToMesh& mesher, size_t i, F f)
+{
+    size_t end = std::min(size_t(mesher.pointListSize()),
+        (i + 1) * points_per_chunk);
+    for (size_t p = i * points_per_chunk; p < end; ++p)
+        f(p);
+}
+
+// Write a string, and return its size.
+std::uintmax_t
+write_string(std::ostream& out, const char* s)
+{
+    size_t n = strlen(s);
+    out.write(s, n);
+    return n;
+}
+
+// Write an ASCII STL facet.
+void
+put_facet(Text& t, const Vec3s& v0, const Vec3s& v1, const Vec3s& v2)
+{
+    t << "facet normal " << facet_normal(v0, v1, v2) << "\n"
+      << " outer loop\n"
+      << "  vertex " << v0 << "\n"
+      << "  vertex " << v1 << "\n"
+      << "  vertex " << v2 << "\n"
+      << " endloop\n"
+      << "endfacet\n";
+}
+
+// Tile polygons are formatted in chunks of this many polygons.
+constexpr size_t polygons_per_chunk = 1024;
+
+// Format the polygons of a tile in parallel, and write them in order.
+// `put_tri(text, triangle)` and `put_quad(text, quad)` format one polygon.
+template <class T, class Q>
+std::uintmax_t
+write_tile_polygons(std::ostream& out, const Tile_Mesh& m, T put_tri, Q put_quad)
+{
+    auto nchunks = [](size_t n) -> size_t
+    {
+        return (n + polygons_per_chunk - 1) / polygons_per_chunk;
+    };
+    size_t ntchunks = nchunks(m.triangles_.size());
+    size_t nqchunks = nchunks(m.quads_.size());
+    return write_text(out, ntchunks + nqchunks,
+        [&](size_t i, Text& t) -> void
+        {
+            if (i < ntchunks) {
+                size_t end = std::min(m.triangles_.size(),
+                    (i + 1) * polygons_per_chunk);
+                for (size_t j = i * polygons_per_chunk; j < end; ++j)
+                    put_tri(t, m.triangles_[j]);
+            } else {
+                i -= ntchunks;
+                size_t end = std::min(m.quads_.size(),
+                    (i + 1) * polygons_per_chunk);
+                for (size_t j = i * polygons_per_chunk; j < end; ++j)
+                    put_quad(t, m.quads_[j]);
+            }
+        });
+}
+
+struct STL_Tile_Writer : public Tile_Writer
+{
+    std::ostream& out_;
+    std::uintmax_t count_;
+
+    STL_Tile_Writer(std::ostream& out)
+    :
+        out_(out),
+        count_(write_string(out, "solid curv\n"))
+    {}
+
+    virtual void write(const Tile_Mesh& m) override
+    {
+        auto& p = m.points_;
+        count_ += write_tile_polygons(out_, m,
+            [&](Text& t, const openvdb::Vec3I& tri) -> void {
+                put_facet(t, p[tri[0]], p[tri[2]], p[tri[1]]);
+            },
+            [&](Text& t, const openvdb::Vec4I& q) -> void {
+                put_facet(t, p[q[0]], p[q[2]], p[q[1]]);
+                put_facet(t, p[q[0]], p[q[3]], p[q[2]]);
+            });
+    }
+    virtual std::uintmax_t finish() override
+    {
+        count_ += write_string(out_, "endsolid curv\n");
+        out_.flush();
+        return count_;
+    }
+};
+
+struct STLB_Tile_Writer : public Tile_Writer
+{
+    Block_Writer w_;
+    std::streampos start_;
+    std::uintmax_t ntri_ = 0;
+
+    STLB_Tile_Writer(std::ostream& out)
+    :
+        w_(out),
+        start_(out.tellp())
+    {
+        if (start_ == std::streampos(-1))
+            throw curv::Exception_Base(curv::stringify(
+                "tiled binary STL export needs a seekable output stream"));
+        char header[80] = "binary STL file, generated by Curv";
+        w_.bytes(header, sizeof(header));
+        w_.u32(0); // the triangle count, written by finish()
+    }
+
+    virtual void write(const Tile_Mesh& m) override
+    {
+        auto& p = m.points_;
+        auto put = [&](const Vec3s& a, const Vec3s& b, const Vec3s& c) -> void
+        {
+            w_.vec3(facet_normal(a, b, c));
+            w_.vec3(a);
+            w_.vec3(b);
+            w_.vec3(c);
+            w_.u16(0);
+        };
+        for (auto& t : m.triangles_)
+            put(p[t[0]], p[t[2]], p[t[1]]);
+        for (auto& q : m.quads_) {
+            put(p[q[0]], p[q[2]], p[q[1]]);
+            put(p[q[0]], p[q[3]], p[q[2]]);
+        }
+        ntri_ += m.triangles_.size() + 2 * m.quads_.size();
+    }
+    virtual std::uintmax_t finish() override
+    {
+        if (ntri_ > 0xFFFFFFFF)
+            throw curv::Exception_Base(
+                curv::stringify("mesh is too large for the STL format"));
+        std::uintmax_t count = w_.finish();
+        std::ostream& out = w_.out_;
+        char n[4] = {
+            char(ntri_), char(ntri_ >> 8), char(ntri_ >> 16), char(ntri_ >> 24)
+        };
+        out.seekp(start_ + std::streamoff(80));
+        out.write(n, 4);
+        out.seekp(0, std::ios::end);
+        out.flush();
+        return count;
+    }
+};
+
+// The coordinates of a point, used as a hash table key for welding.
+struct Point_Key
+{
+    std::uint32_t bits_[3];
+
+    Point_Key(const Vec3s& p) { memcpy(bits_, p.asPointer(), sizeof(bits_)); }
+    float z() const
+    {
+        float f;
+        memcpy(&f, &bits_[2], sizeof(f));
+        return f;
+    }
+    bool operator==(const Point_Key& k) const
+    {
+        return memcmp(bits_, k.bits_, sizeof(bits_)) == 0;
+    }
+};
+struct Point_Hash
+{
+    size_t operator()(const Point_Key& k) const
+    {
+        std::uint64_t h = 14695981039346656037ull;
+        for (auto b : k.bits_)
+            h = (h ^ b) * 1099511628211ull;
+        return size_t(h);
+    }
+};
+
+struct OBJ_Tile_Writer : public Tile_Writer
+{
+    std::ostream& out_;
+    std::uintmax_t count_ = 0;
+    unsigned nvertices_ = 0;
+    // The 1-based vertex index of each seam point that has been written.
+    std::unordered_map<Point_Key, unsigned, Point_Hash> seam_;
+    // The vertex index of each point in the current tile, and the points
+    // that are new vertices.
+    std::vector<unsigned> index_;
+    std::vector<unsigned> new_points_;
+
+    OBJ_Tile_Writer(std::ostream& out) : out_(out) {}
+
+    virtual void write(const Tile_Mesh& m) override
+    {
+        auto& p = m.points_;
+        index_.resize(p.size());
+        new_points_.clear();
+        for (size_t i = 0; i < p.size(); ++i) {
+            if (m.seam_[i]) {
+                auto ins = seam_.emplace(Point_Key(p[i]), nvertices_ + 1);
+                index_[i] = ins.first->second;
+                if (!ins.second)
+                    continue;
+            } else
+                index_[i] = nvertices_ + 1;
+            ++nvertices_;
+            new_points_.push_back(unsigned(i));
+        }
+        count_ += write_text(out_,
+            (new_points_.size() + points_per_chunk - 1) / points_per_chunk,
+            [&](size_t i, Text& t) -> void
+            {
+                size_t end = std::min(new_points_.size(),
+                    (i + 1) * points_per_chunk);
+                for (size_t j = i * points_per_chunk; j < end; ++j)
+                    t << "v " << p[new_points_[j]] << "\n";
+            });
+        count_ += write_tile_polygons(out_, m,
+            [&](Text& t, const openvdb::Vec3I& tri) -> void {
+                t << "f " << index_[tri[0]] << " "
+                          << index_[tri[2]] << " "
+                          << index_[tri[1]] << "\n";
+            },
+            [&](Text& t, const openvdb::Vec4I& q) -> void {
+                t << "f " << index_[q[0]] << " "
+                          << index_[q[3]] << " "
+                          << index_[q[2]] << " "
+                          << index_[q[1]] << "\n";
+            });
+    }
+    virtual void forget_seam_below(float z) override
+    {
+        for (auto i = seam_.begin(); i != seam_.end(); ) {
+            if (i->first.z() < z)
+                i = seam_.erase(i);
+            else
+                ++i;
+        }
+    }
+    virtual std::uintmax_t finish() override
+    {
+        out_.flush();
+        return count_;
+    }
+};
+
+} // namespace
+
+std::unique_ptr<Tile_Writer>
+make_stl_tile_writer(std::ostream& out)
+{
+    return std::make_unique<STL_Tile_Writer>(out);
+}
+
+std::unique_ptr<Tile_Writer>
+make_stlb_tile_writer(std::ostream& out)
+{
+    return std::make_unique<STLB_Tile_Writer>(out);
+}
+
+std::unique_ptr<Tile_Writer>
+make_obj_tile_writer(std::ostream& out)
+{
+    return std::make_unique<OBJ_Tile_Writer>(out);
+}
+
+std::uintmax_t
+write_stl(std::ostream& out, VolumeToMesh& mesher)
+{
+    auto& points = mesher.pointList();
+    std::uintmax_t count = write_string(out, "solid curv\n");
+    count += write_text(out, mesher.polygonPoolListSize(),
+        [&](size_t i, Text& t) -> void
+        {
+            PolygonPool& pool = mesher.polygonPoolList()[i];
+            for (size_t j = 0; j < pool.numTriangles(); ++j) {
+                auto& tri = pool.triangle(j);
+                put_facet(t, points[tri[0]], points[tri[2]], points[tri[1]]);
+            }
+            for (size_t j = 0; j < pool.numQuads(); ++j) {
+                auto& q = pool.quad(j);
+                put_facet(t, points[q[0]], points[q[2]], points[q[1]]);
+                put_facet(t, points[q[0]], points[q[3]], points[q[2]]);
+            }
+        });
+    count += write_string(out, "endsolid curv\n");
+    out.flush();
+    return count;
+}
+
+std::uintmax_t
+write_obj(std::ostream& out, VolumeToMesh& mesher)
+{
+    auto& points = mesher.pointList();
+    std::uintmax_t count = write_text(out, num_point_chunks(mesher),
+        [&](size_t i, Text& t) -> void
+        {
+            for_each_point_in_chunk(mesher, i, [&](size_t p) -> void {
+                t << "v " << points[p] << "\n";
+            });
+        });
+    // OBJ indexes are 1-based.
+    count += write_text(out, mesher.polygonPoolListSize(),
+        [&](size_t i, Text& t) -> void
+        {
+            PolygonPool& pool = mesher.polygonPoolList()[i];
+            for (size_t j = 0; j < pool.numTriangles(); ++j) {
+                auto& tri = pool.triangle(j);
+                t << "f " << tri[0]+1 << " "
+                          << tri[2]+1 << " "
+                          << tri[1]+1 << "\n";
+            }
+            for (size_t j = 0; j < pool.numQuads(); ++j) {
+                auto& q = pool.quad(j);
+                t << "f " << q[0]+1 << " "
+                          << q[3]+1 << " "
+                          << q[2]+1 << " "
+                          << q[1]+1 << "\n";
+            }
+        });
+    out.flush();
+    return count;
+}
+
+std::uintmax_t
+write_x3d(std::ostream& out, VolumeToMesh& mesher,
+    const std::vector<float>& colours, bool per_vertex)
+{
+    std::uintmax_t count = write_string(out,
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<!DOCTYPE X3D PUBLIC \"ISO//Web3D//DTD X3D 3.1//EN\" \"http://www.web3d.org/specifications/x3d-3.1.dtd\">\n"
+        "<X3D profile=\"Interchange\" version=\"3.1\" xsd:noNamespaceSchemaLocation=\"http://www.web3d.org/specifications/x3d-3.1.xsd\" xmlns:xsd=\"http://www.w3.org/2001/XMLSchema-instance\">\n"
+        " <head>\n"
+        "  <meta content=\"Curv, https://github.com/doug-moen/curv\" name=\"generator\"/>\n"
+        " </head>\n"
+        " <Scene>\n"
+        "  <Shape>\n"
+        "   <IndexedFaceSet colorPerVertex=\"");
+    count += write_string(out, per_vertex ? "true" : "false");
+    count += write_string(out, "\" coordIndex=\"");
+    count += write_text(out, mesher.polygonPoolListSize(),
+        [&](size_t i, Text& t) -> void
+        {
+            PolygonPool& pool = mesher.polygonPoolList()[i];
+            for (size_t j = 0; j < pool.numTriangles(); ++j) {
+                auto& tri = pool.triangle(j);
+                t << " " << tri[0] << " " << tri[2] << " " << tri[1] << " -1";
+            }
+            for (size_t j = 0; j < pool.numQuads(); ++j) {
+                auto& q = pool.quad(j);
+                t << " " << q[0] << " " << q[2] << " " << q[1] << " -1 "
+                  << q[0] << " " << q[3] << " " << q[2] << " -1";
+            }
+        },
+        true);
+    count += write_string(out,
+        "\">\n"
+        "    <Coordinate point=\"");
+    auto& points = mesher.pointList();
+    count += write_text(out, num_point_chunks(mesher),
+        [&](size_t i, Text& t) -> void
+        {
+            for_each_point_in_chunk(mesher, i, [&](size_t p) -> void {
+                t << " " << points[p];
+            });
+        },
+        true);
+    count += write_string(out,
+        "\"/>\n"
+        "    <Color color=\"");
+    // X3D colours are sRGB.
+    constexpr size_t colours_per_chunk = 3 * points_per_chunk;
+    count += write_text(out,
+        (colours.size() + colours_per_chunk - 1) / colours_per_chunk,
+        [&](size_t i, Text& t) -> void
+        {
+            size_t end = std::min(colours.size(), (i+1) * colours_per_chunk);
+            for (size_t c = i * colours_per_chunk; c < end; ++c)
+                t << " " << std::pow(colours[c], 0.4545f);
+        });
+    count += write_string(out,
+        "\"/>\n"
+        "   </IndexedFaceSet>\n"
+        "  </Shape>\n"
+        " </Scene>\n"
+        "</X3D>\n");
+    out.flush();
+    return count;
+}
+
+std::uintmax_t
+write_stlb(std::ostream& out, VolumeToMesh& mesher)
+{
+    Block_Writer w(out);
+    // The header must not begin with "solid", or the file might be
+    // mistaken for an ASCII STL file.
+    char header[80] = "binary STL file, generated by Curv";
+    w.bytes(header, sizeof(header));
+    std::uintmax_t ntri = count_triangles(mesher);
+    if (ntri > 0xFFFFFFFF)
+        throw curv::Exception_Base(
+            curv::stringify("mesh is too large for the STL format"));
+    w.u32(std::uint32_t(ntri));
+    auto& points = mesher.pointList();
+    for_each_triangle(mesher, [&](unsigned a, unsigned b, unsigned c) -> void {
+        w.vec3(facet_normal(points[a], points[b], points[c]));
+        w.vec3(points[a]);
+        w.vec3(points[b]);
+        w.vec3(points[c]);
+        w.u16(0);
+    });
+    return w.finish();
+}
+
+std::uintmax_t
+write_ply(std::ostream& out, VolumeToMesh& mesher,
+    const std::vector<float>* colours)
+{
+    Block_Writer w(out);
+    size_t npoints = mesher.pointListSize();
+    std::uintmax_t nfaces = 0;
+    for (size_t i = 0; i < mesher.polygonPoolListSize(); ++i) {
+        PolygonPool& pool = mesher.polygonPoolList()[i];
+        nfaces += pool.numTriangles() + pool.numQuads();
+    }
+    std::ostringstream header;
+    header << "ply\n"
+        "format binary_little_endian 1.0\n"
+        "comment generated by Curv\n"
+        "element vertex " << npoints << "\n"
+        "property float x\n"
+        "property float y\n"
+        "property float z\n";
+    if (colours) {
+        header <<
+        "property uchar red\n"
+        "property uchar green\n"
+        "property uchar blue\n";
+    }
+    header <<
+        "element face " << nfaces << "\n"
+        "property list uchar uint vertex_indices\n"
+        "end_header\n";
+    w.bytes(header.str());
+
+    auto& points = mesher.pointList();
+    for (size_t i = 0; i < npoints; ++i) {
+        w.vec3(points[i]);
+        if (colours) {
+            const float* c = &(*colours)[3*i];
+            w.u8(srgb_byte(c[0]));
+            w.u8(srgb_byte(c[1]));
+            w.u8(srgb_byte(c[2]));
+        }
+    }
+    for (size_t i = 0; i < mesher.polygonPoolListSize(); ++i) {
+        PolygonPool& pool = mesher.polygonPoolList()[i];
+        for (size_t j = 0; j < pool.numTriangles(); ++j) {
+            auto& t = pool.triangle(j);
+            w.u8(3);
+            w.u32(t[0]);
+            w.u32(t[2]);
+            w.u32(t[1]);
+        }
+        for (size_t j = 0; j < pool.numQuads(); ++j) {
+            auto& q = pool.quad(j);
+            w.u8(4);
+            w.u32(q[0]);
+            w.u32(q[3]);
+            w.u32(q[2]);
+            w.u32(q[1]);
+        }
+    }
+    return w.finish();
+}
+
+std::uintmax_t
+write_glb(std::ostream& out, VolumeToMesh& mesher,
+    const std::vector<float>* colours)
+{
+    Block_Writer w(out);
+    size_t npoints = mesher.pointListSize();
+    std::uintmax_t ntri = count_triangles(mesher);
+    auto& points = mesher.pointList();
+
+    // The buffer contains positions, normals, optional colours, and indices,
+    // each of which is a multiple of 4 bytes.
+    std::uintmax_t vbytes = 12 * std::uintmax_t(npoints);
+    std::uintmax_t ibytes = 12 * ntri;
+    std::uintmax_t norm_offset = vbytes;
+    std::uintmax_t col_offset = 2 * vbytes;
+    std::uintmax_t ind_offset = (colours ? 3 : 2) * vbytes;
+    std::uintmax_t bin_size = ind_offset + ibytes;
+    bool empty = (ntri == 0);
+
+    std::ostringstream json;
+    json << "{\"asset\":{\"version\":\"2.0\",\"generator\":\"Curv\"},"
+        "\"scene\":0,";
+    if (empty) {
+        json << "\"scenes\":[{}]}";
+    } else {
+        Vec3s lo = points[0], hi = points[0];
+        for (size_t i = 1; i < npoints; ++i) {
+            lo = openvdb::math::minComponent(lo, points[i]);
+            hi = openvdb::math::maxComponent(hi, points[i]);
+        }
+        auto view = [&](std::uintmax_t offset, std::uintmax_t len, int target)
+        {
+            json << "{\"buffer\":0,\"byteOffset\":" << offset
+                 << ",\"byteLength\":" << len
+                 << ",\"target\":" << target << "}";
+        };
+        auto accessor = [&](int view, int type, std::uintmax_t count,
+            const char* shape)
+        {
+            json << "{\"bufferView\":" << view
+                 << ",\"componentType\":" << type
+                 << ",\"count\":" << count
+                 << ",\"type\":\"" << shape << "\"";
+        };
+        json << "\"scenes\":[{\"nodes\":[0]}],"
+            "\"nodes\":[{\"mesh\":0}],"
+            "\"meshes\":[{\"primitives\":[{\"attributes\":"
+            "{\"POSITION\":0,\"NORMAL\":1";
+        if (colours)
+            json << ",\"COLOR_0\":2";
+        json << "},\"indices\":" << (colours ? 3 : 2) << ",\"mode\":4}]}],"
+            "\"buffers\":[{\"byteLength\":" << bin_size << "}],"
+            "\"bufferViews\":[";
+        view(0, vbytes, 34962);
+        json << ",";
+        view(norm_offset, vbytes, 34962);
+        if (colours) {
+            json << ",";
+            view(col_offset, vbytes, 34962);
+        }
+        json << ",";
+        view(ind_offset, ibytes, 34963);
+        json << "],\"accessors\":[";
+        accessor(0, 5126, npoints, "VEC3");
+        json << ",\"min\":[" << Exact{lo.x()} << "," << Exact{lo.y()}
+             << "," << Exact{lo.z()} << "],\"max\":[" << Exact{hi.x()}
+             << "," << Exact{hi.y()} << "," << Exact{hi.z()} << "]},";
+        accessor(1, 5126, npoints, "VEC3");
+        json << "},";
+        if (colours) {
+            accessor(2, 5126, npoints, "VEC3");
+            json << "},";
+        }
+        accessor(colours ? 3 : 2, 5125, 3 * ntri, "SCALAR");
+        json << "}]}";
+    }
+    std::string js = json.str();
+    js.resize((js.size() + 3) & ~size_t(3), ' ');
+
+    // Header, then the JSON chunk, then the binary chunk.
+    std::uintmax_t total = 12 + 8 + js.size() + (empty ? 0 : 8 + bin_size);
+    if (total > 0xFFFFFFFF)
+        throw curv::Exception_Base(
+            curv::stringify("mesh is too large for the GLB format"));
+    w.u32(0x46546C67); // "glTF"
+    w.u32(2);
+    w.u32(std::uint32_t(total));
+    w.u32(std::uint32_t(js.size()));
+    w.u32(0x4E4F534A); // "JSON"
+    w.bytes(js);
+    if (empty)
+        return w.finish();
+    w.u32(std::uint32_t(bin_size));
+    w.u32(0x004E4942); // "BIN"
+
+    // Vertex normals are the area weighted sum of the facet normals.
+    std::vector<Vec3s> normals(npoints, Vec3s(0.0f));
+    for_each_triangle(mesher, [&](unsigned a, unsigned b, unsigned c) -> void {
+        Vec3s n = (points[b] - points[a]).cross(points[c] - points[a]);
+        normals[a] += n;
+        normals[b] += n;
+        normals[c] += n;
+    });
+    for (size_t i = 0; i < npoints; ++i)
+        w.vec3(points[i]);
+    for (auto& n : normals) {
+        float len = n.length();
+        w.vec3(len > 0.0f ? n * (1.0f / len) : Vec3s(0.0f, 0.0f, 1.0f));
+    }
+    if (colours) {
+        // glTF requires colour components in the range [0,1].
+        for (float c : *colours)
+            w.f32(std::max(0.0f, std::min(c, 1.0f)));
+    }
+    for_each_triangle(mesher, [&](unsigned a, unsigned b, unsigned c) -> void {
+        w.u32(a);
+        w.u32(b);
+        w.u32(c);
+    });
+    return w.finish();
+}
@@ -0,0 +1,82 @@
+// Copyright 2016-2019 Doug Moen
+// Licensed under the Apache License, version 2.0
+// See accompanying file LICENSE or https://www.apache.org/licenses/LICENSE-2.0
+
+#ifndef MESH_WRITER_H
+#define MESH_WRITER_H
+
+#include <openvdb/openvdb.h>
+#include <openvdb/tools/VolumeToMesh.h>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+// Mesh file writers, used by export_mesh. They write the output of
+// a VolumeToMesh directly from its point list and polygon pools, in large
+// blocks. Quads are split into two triangles, except by write_obj and
+// write_ply. The text writers format the polygon pools (and chunks of the
+// point list) in parallel, then write the text in order.
+// Polygons are written with the winding order reversed, so that the normals
+// point outside.
+//
+// `colours` contains linear RGB colours, each stored as 3 consecutive floats.
+// For write_ply and write_glb, it is null, or has a colour for each point.
+//
+// Each writer returns the number of bytes written.
+
+// ASCII STL.
+std::uintmax_t write_stl(std::ostream&, openvdb::tools::VolumeToMesh&);
+
+// Wavefront OBJ.
+std::uintmax_t write_obj(std::ostream&, openvdb::tools::VolumeToMesh&);
+
+// X3D, with a colour for each point if `per_vertex` is true, otherwise
+// a colour for each triangle, in the order they are written.
+std::uintmax_t write_x3d(std::ostream&, openvdb::tools::VolumeToMesh&,
+    const std::vector<float>& colours, bool per_vertex);
+
+// Binary STL.
+std::uintmax_t write_stlb(std::ostream&, openvdb::tools::VolumeToMesh&);
+
+// Binary little-endian PLY, with optional 8 bit sRGB vertex colours.
+std::uintmax_t write_ply(std::ostream&, openvdb::tools::VolumeToMesh&,
+    const std::vector<float>* colours);
+
+// glTF 2.0 binary (GLB), with indexed positions, normals and
+// optional vertex colours.
+std::uintmax_t write_glb(std::ostream&, openvdb::tools::VolumeToMesh&,
+    const std::vector<float>* colours);
+
+// A piece of a mesh, produced by one tile of a tiled export.
+// Polygons index `points_`, with the same winding order as VolumeToMesh.
+// A point is flagged in `seam_` if it may also be used by the polygons of
+// another tile. Neighbouring tiles compute identical coordinates for a
+// shared point.
+struct Tile_Mesh
+{
+    std::vector<openvdb::Vec3s> points_;
+    std::vector<bool> seam_;
+    std::vector<openvdb::Vec3I> triangles_;
+    std::vector<openvdb::Vec4I> quads_;
+};
+
+// Writes a mesh file one tile at a time, in the order the tiles are given,
+// so that the whole mesh is never in memory. Indexed formats weld the seam
+// points shared by different tiles into a single vertex.
+struct Tile_Writer
+{
+    virtual ~Tile_Writer() {}
+    virtual void write(const Tile_Mesh&) = 0;
+    // No later tile will use a seam point whose z coordinate is less than z.
+    virtual void forget_seam_below(float) {}
+    // Finish the file, and return the number of bytes written.
+    virtual std::uintmax_t finish() = 0;
+};
+
+std::unique_ptr<Tile_Writer> make_stl_tile_writer(std::ostream&);
+std::unique_ptr<Tile_Writer> make_obj_tile_writer(std::ostream&);
+// The triangle count is written last, so the output must be seekable.
+std::unique_ptr<Tile_Writer> make_stlb_tile_writer(std::ostream&);
+
+#endif // include guard
@@ -156,6 +156,7 @@ Environ::lookup_lvar(const Identifier& id, unsigned edepth)
         auto loc = env->single_lvar_lookup(id);
         if (loc != nullptr)
             return loc;
+        env->assigns_outer_ = true;
     }
     // Figure out what went wrong and give a good error.
     for (; env != nullptr; env = env->parent_) {
@@ -1073,7 +1074,9 @@ For_Phrase::analyse(Environ& env, unsigned edepth) const
     auto body = analyse_op(*body_, scope, edepth+1);
 
     env.frame_maxslots_ = scope.frame_maxslots_;
-    return make<For_Op>(share(*this), pat, list, cond, body);
+    auto op = make<For_Op>(share(*this), pat, list, cond, body);
+    op->parallel_ = !scope.assigns_outer_;
+    return op;
 }
 
 Shared<Meaning>
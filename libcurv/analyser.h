@@ -41,6 +41,10 @@ struct Environ
     slot_t frame_nslots_;
     slot_t frame_maxslots_;
 
+    // Set if a := statement within this environment assigns a variable
+    // that is defined outside of it.
+    bool assigns_outer_ = false;
+
     // constructor for root environment of a source file
     Environ(File_Analyser& analyser)
     :
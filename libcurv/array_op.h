@@ -23,21 +23,96 @@
 
 namespace curv {
 
+// If `v` is a List that isn't referenced by anything else, return it.
+// An element-wise array operation can store its result in such a list,
+// instead of allocating a new one. The caller must pass a uniquely owned
+// temporary by std::move, otherwise the use_count will be at least 2.
+inline List* unique_list(Value& v)
+{
+    if (v.is_ref()) {
+        List* list = ref_cast<List>(v.to_ref_unsafe());
+        if (list && list->is_unique())
+            return list;
+    }
+    return nullptr;
+}
+
+// Fetch element `i` of `list`. If `list` is the `dest` list that is being
+// reused to hold the result, then move the element out, so that an element
+// that is itself a list (eg, a vec3 in a list of points) is also unique.
+template <class L>
+inline Value take_element(const L& list, size_t i, List* dest)
+{
+    if ((const void*)&list == (const void*)dest)
+        return std::move((*dest)[i]);
+    return list[i];
+}
+
+// Return a Packed_List of size `n` to hold the result of an operation on
+// packed lists. An argument `x` or `y` is reused if it is a Packed_List
+// of size `n` that isn't referenced by anything else (see unique_list).
+inline Shared<Packed_List>
+packed_result(size_t n, Value& x, Value* y = nullptr)
+{
+    for (Value* v : {&x, y}) {
+        Packed_List* p = v ? packed_list(*v) : nullptr;
+        if (p && p->is_unique() && p->size() == n)
+            return share(*p);
+    }
+    return Packed_List::make(n);
+}
+
+// Store `f(i)` in `out[i]`, for each i in [0,n). A NaN result is a domain
+// error: return the index of the first NaN, or n if there is none.
+// The elements are computed in fixed size blocks, which the compiler can
+// vectorize. A block is copied to `out` only if it has no NaN, so if `out`
+// is also an input, the input to the failed element is intact.
+template <class F>
+size_t packed_map(size_t n, double* out, F f)
+{
+    constexpr size_t block = 8;
+    size_t i = 0;
+    for (; i + block <= n; i += block) {
+        double tmp[block];
+        bool nan = false;
+        for (size_t j = 0; j < block; ++j) {
+            tmp[j] = f(i + j);
+            nan |= (tmp[j] != tmp[j]);
+        }
+        if (nan)
+            break;
+        for (size_t j = 0; j < block; ++j)
+            out[i + j] = tmp[j];
+    }
+    for (; i < n; ++i) {
+        double r = f(i);
+        if (r != r)
+            return i;
+        out[i] = r;
+    }
+    return n;
+}
+
 template <class Scalar_Op>
 struct Binary_Numeric_Array_Op
 {
-    // TODO: optimize: move semantics. unique object reuse.
-
     static Value
     reduce(const Scalar_Op& f, double zero, Value arg)
     {
-        auto list = arg.to<List>(f.cx);
-        Value result = {zero};
-        for (auto val : *list)
-            result = op(f, result, val);
-        return result;
+        if (!is_list(arg))
+            arg.to_abort(f.cx, List::name);
+        return visit_list(arg.to_ref_unsafe(), [&](const auto& list) {
+            // After the first iteration, `result` is usually a unique list,
+            // which `op` updates in place.
+            Value result = {zero};
+            for (size_t i = 0; i < list.size(); ++i)
+                result = elem(f, std::move(result), list[i]);
+            return result;
+        });
     }
 
+    // Pass uniquely owned list arguments using std::move,
+    // so that their storage can be reused for the result.
     static Value
     op(const Scalar_Op& f, Value x, Value y)
     {
@@ -46,14 +121,33 @@ struct Binary_Numeric_Array_Op
         if (r == r)
             return {r};
 
+        // if x, y, or both, are packed lists of numbers
+        Packed_List* xp = packed_list(x);
+        Packed_List* yp = packed_list(y);
+        if (xp || yp) {
+            Value result = packed_op(f, x, xp, y, yp);
+            if (!result.is_missing())
+                return result;
+        }
+
         // if x, y, or both, are lists
-        if (auto xlist = x.dycast<List>()) {
-            if (auto ylist = y.dycast<List>())
-                return {element_wise_op(f, xlist, ylist)};
-            return {broadcast_left(f, xlist, y)};
+        if (is_list(x)) {
+            return visit_list(x.to_ref_unsafe(), [&](const auto& xlist) {
+                if (is_list(y)) {
+                    return visit_list(y.to_ref_unsafe(),
+                        [&](const auto& ylist) {
+                            return Value{element_wise_op(f, xlist, ylist,
+                                unique_list(x), unique_list(y))};
+                        });
+                }
+                return Value{broadcast_left(f, xlist, y, unique_list(x))};
+            });
+        }
+        if (is_list(y)) {
+            return visit_list(y.to_ref_unsafe(), [&](const auto& ylist) {
+                return Value{broadcast_right(f, x, ylist, unique_list(y))};
+            });
         }
-        if (auto ylist = y.dycast<List>())
-            return {broadcast_right(f, x, ylist)};
 
         // One of x or y is reactive, the other is a number.
         // Both x and y are reactive.
@@ -90,34 +184,117 @@ struct Binary_Numeric_Array_Op
             stringify(f.callstr(x,y),": domain error"));
     }
 
+    // Handle the cases where x and y are both packed lists of the same size,
+    // or one is packed and the other is a number, with a loop over unboxed
+    // doubles. Otherwise return missing, and let the general code handle it.
+    static Value
+    packed_op(const Scalar_Op& f,
+        Value& x, const Packed_List* xp, Value& y, const Packed_List* yp)
+    {
+        size_t n;
+        Shared<Packed_List> result;
+        size_t bad;
+        if (xp && yp) {
+            n = xp->size();
+            if (yp->size() != n)
+                return missing;
+            result = packed_result(n, x, &y);
+            const double* a = xp->data();
+            const double* b = yp->data();
+            bad = packed_map(n, result->data(),
+                [&](size_t i) { return f.call(a[i], b[i]); });
+            if (bad < n)
+                throw_domain_error(f, a[bad], b[bad]);
+        } else if (xp && y.is_num()) {
+            n = xp->size();
+            result = packed_result(n, x);
+            const double* a = xp->data();
+            double b = y.to_num_unsafe();
+            bad = packed_map(n, result->data(),
+                [&](size_t i) { return f.call(a[i], b); });
+            if (bad < n)
+                throw_domain_error(f, a[bad], b);
+        } else if (x.is_num() && yp) {
+            n = yp->size();
+            result = packed_result(n, y);
+            double a = x.to_num_unsafe();
+            const double* b = yp->data();
+            bad = packed_map(n, result->data(),
+                [&](size_t i) { return f.call(a, b[i]); });
+            if (bad < n)
+                throw_domain_error(f, a, b[bad]);
+        } else
+            return missing;
+        return {result};
+    }
+
+    static void
+    throw_domain_error [[noreturn]] (const Scalar_Op& f, double x, double y)
+    {
+        throw Exception(f.cx,
+            stringify(f.callstr(Value{x},Value{y}),": domain error"));
+    }
+
+    // Apply `op` to a pair of list elements. A pair of numbers is handled
+    // inline, so a numeric list, or a list of vec3, doesn't make a recursive
+    // call per number.
+    static Value
+    elem(const Scalar_Op& f, Value x, Value y)
+    {
+        if (x.is_num() && y.is_num()) {
+            double r = f.call(x.to_num_unsafe(), y.to_num_unsafe());
+            if (r == r)
+                return {r};
+        }
+        return op(f, std::move(x), std::move(y));
+    }
+
+    // The list arguments are each either a List or a Range_Value.
+    // If `dest` is not null, it is a unique list argument that is reused
+    // to hold the result.
+    template <class XList>
     static Shared<List>
-    broadcast_left(const Scalar_Op& f, Shared<List> xlist, Value y)
+    broadcast_left(const Scalar_Op& f, const XList& xlist, Value y,
+        List* dest)
     {
-        Shared<List> result = List::make(xlist->size());
-        for (unsigned i = 0; i < xlist->size(); ++i)
-            (*result)[i] = op(f, (*xlist)[i], y);
+        Shared<List> result = dest ? share(*dest) : List::make(xlist.size());
+        for (unsigned i = 0; i < xlist.size(); ++i)
+            (*result)[i] = elem(f, take_element(xlist, i, dest), y);
         return result;
     }
 
+    template <class YList>
     static Shared<List>
-    broadcast_right(const Scalar_Op& f, Value x, Shared<List> ylist)
+    broadcast_right(const Scalar_Op& f, Value x, const YList& ylist,
+        List* dest)
     {
-        Shared<List> result = List::make(ylist->size());
-        for (unsigned i = 0; i < ylist->size(); ++i)
-            (*result)[i] = op(f, x, (*ylist)[i]);
+        Shared<List> result = dest ? share(*dest) : List::make(ylist.size());
+        for (unsigned i = 0; i < ylist.size(); ++i)
+            (*result)[i] = elem(f, x, take_element(ylist, i, dest));
         return result;
     }
 
+    template <class XList, class YList>
     static Shared<List>
-    element_wise_op(const Scalar_Op& f, Shared<List> xs, Shared<List> ys)
+    element_wise_op(const Scalar_Op& f, const XList& xs, const YList& ys,
+        List* xdest, List* ydest)
     {
-        if (xs->size() != ys->size())
+        if (xs.size() != ys.size())
             throw Exception(f.cx, stringify(
                 "mismatched list sizes (",
-                xs->size(),",",ys->size(),") in array operation"));
-        Shared<List> result = List::make(xs->size());
-        for (unsigned i = 0; i < xs->size(); ++i)
-            (*result)[i] = op(f, (*xs)[i], (*ys)[i]);
+                xs.size(),",",ys.size(),") in array operation"));
+        List* dest = xdest ? xdest : ydest;
+        if (dest == nullptr) {
+            Shared<List> result = List::make(xs.size());
+            for (unsigned i = 0; i < xs.size(); ++i)
+                (*result)[i] = elem(f, xs[i], ys[i]);
+            return result;
+        }
+        Shared<List> result = share(*dest);
+        for (unsigned i = 0; i < xs.size(); ++i) {
+            (*result)[i] = elem(f,
+                take_element(xs, i, dest), take_element(ys, i, dest));
+        }
         return result;
     }
 };
@@ -128,7 +305,7 @@ struct Unary_Scalar_Prim
     typedef Value scalar_t;
     static bool unbox(Value a, scalar_t& b, const Context&)
     {
-        if (a.dycast<List>()) {
+        if (is_list(a)) {
             return false;
         } else {
             b = a;
@@ -381,7 +558,6 @@ struct Binary_Bool32_Prim : public Bool32_Prim
 template <class Prim>
 struct Binary_Array_Op
 {
-    // TODO: optimize: move semantics. unique object reuse.
     // TODO: optimize: faster fast path in `op` for number case.
 
     static Shared<const String> domain_error(Value x, Value y)
@@ -407,11 +583,16 @@ struct Binary_Array_Op
     static Value
     reduce(const Context& cx, Value zero, Value arg)
     {
-        auto list = arg.to<List>(cx);
-        Value result = zero;
-        for (auto val : *list)
-            result = op(cx, result, val);
-        return result;
+        if (!is_list(arg))
+            arg.to_abort(cx, List::name);
+        return visit_list(arg.to_ref_unsafe(), [&](const auto& list) {
+            // After the first iteration, `result` is usually a unique list,
+            // which `op` updates in place.
+            Value result = zero;
+            for (size_t i = 0; i < list.size(); ++i)
+                result = op(cx, std::move(result), list[i]);
+            return result;
+        });
     }
     static SC_Value
     sc_reduce(const Context& cx, Value zero, Operation& argx, SC_Frame& f)
@@ -455,6 +636,8 @@ struct Binary_Array_Op
         }
     }
 
+    // Pass uniquely owned list arguments using std::move,
+    // so that their storage can be reused for the result.
     static Value
     op(const Context& cx, Value x, Value y)
     {
@@ -473,7 +656,9 @@ struct Binary_Array_Op
                 Ref_Value& ry(y.to_ref_unsafe());
                 switch (ry.type_) {
                 case Ref_Value::ty_list:
-                    return broadcast_right(cx, x, (List&)ry);
+                    return visit_list(ry, [&](const auto& ylist) {
+                        return broadcast_right(cx, x, ylist, unique_list(y));
+                    });
                 case Ref_Value::ty_reactive:
                     return reactive_op(cx, x, y);
                 }
@@ -483,13 +668,21 @@ struct Binary_Array_Op
             Ref_Value& rx(x.to_ref_unsafe());
             switch (rx.type_) {
             case Ref_Value::ty_list:
-                if (Prim::unbox_right(y, sy, cx))
-                    return broadcast_left(cx, (List&)rx, y);
+                if (Prim::unbox_right(y, sy, cx)) {
+                    return visit_list(rx, [&](const auto& xlist) {
+                        return broadcast_left(cx, xlist, y, unique_list(x));
+                    });
+                }
                 else if (y.is_ref()) {
                     Ref_Value& ry(y.to_ref_unsafe());
                     switch (ry.type_) {
                     case Ref_Value::ty_list:
-                        return element_wise_op(cx, (List&)rx, (List&)ry);
+                        return visit_list(rx, [&](const auto& xlist) {
+                            return visit_list(ry, [&](const auto& ylist) {
+                                return element_wise_op(cx, xlist, ylist,
+                                    unique_list(x), unique_list(y));
+                            });
+                        });
                     case Ref_Value::ty_reactive:
                         return reactive_op(cx, x, y);
                     }
@@ -523,34 +716,46 @@ struct Binary_Array_Op
         return Prim::sc_call(f, x, y);
     }
 
+    // The list arguments are each either a List or a Range_Value.
+    // If `dest` is not null, it is a unique list argument that is reused
+    // to hold the result.
+    template <class XList>
     static Value
-    broadcast_left(const Context& cx, List& xlist, Value y)
+    broadcast_left(const Context& cx, const XList& xlist, Value y,
+        List* dest)
     {
-        Shared<List> result = List::make(xlist.size());
+        Shared<List> result = dest ? share(*dest) : List::make(xlist.size());
         for (unsigned i = 0; i < xlist.size(); ++i)
-            (*result)[i] = op(cx, xlist[i], y);
+            (*result)[i] = op(cx, take_element(xlist, i, dest), y);
         return {result};
     }
 
+    template <class YList>
     static Value
-    broadcast_right(const Context& cx, Value x, List& ylist)
+    broadcast_right(const Context& cx, Value x, const YList& ylist,
+        List* dest)
     {
-        Shared<List> result = List::make(ylist.size());
+        Shared<List> result = dest ? share(*dest) : List::make(ylist.size());
         for (unsigned i = 0; i < ylist.size(); ++i)
-            (*result)[i] = op(cx, x, ylist[i]);
+            (*result)[i] = op(cx, x, take_element(ylist, i, dest));
         return {result};
     }
 
+    template <class XList, class YList>
     static Value
-    element_wise_op(const Context& cx, List& xs, List& ys)
+    element_wise_op(const Context& cx, const XList& xs, const YList& ys,
+        List* xdest, List* ydest)
     {
         if (xs.size() != ys.size())
             throw Exception(cx, stringify(
                 "mismatched list sizes (",
                 xs.size(),",",ys.size(),") in array operation"));
-        Shared<List> result = List::make(xs.size());
-        for (unsigned i = 0; i < xs.size(); ++i)
-            (*result)[i] = op(cx, xs[i], ys[i]);
+        List* dest = xdest ? xdest : ydest;
+        Shared<List> result = dest ? share(*dest) : List::make(xs.size());
+        for (unsigned i = 0; i < xs.size(); ++i) {
+            (*result)[i] = op(cx,
+                take_element(xs, i, dest), take_element(ys, i, dest));
+        }
         return {result};
     }
 
@@ -591,16 +796,31 @@ struct Binary_Array_Op
 template <class Scalar_Op>
 struct Unary_Numeric_Array_Op
 {
-    // TODO: optimize: move semantics. unique object reuse.
-
+    // Pass a uniquely owned list argument using std::move,
+    // so that its storage can be reused for the result.
     static Value
     op(const Scalar_Op& f, Value x)
     {
         double r = f.call(x.to_num_or_nan());
         if (r == r)
             return {r};
-        if (auto xlist = x.dycast<List>())
-            return {element_wise_op(f, xlist)};
+        if (Packed_List* xp = packed_list(x)) {
+            size_t n = xp->size();
+            Shared<Packed_List> result = packed_result(n, x);
+            const double* a = xp->data();
+            size_t bad = packed_map(n, result->data(),
+                [&](size_t i) { return f.call(a[i]); });
+            if (bad < n) {
+                throw Exception(f.cx,
+                    stringify(f.callstr(Value{a[bad]}),": domain error"));
+            }
+            return {result};
+        }
+        if (is_list(x)) {
+            return visit_list(x.to_ref_unsafe(), [&](const auto& xlist) {
+                return Value{element_wise_op(f, xlist, unique_list(x))};
+            });
+        }
         auto xre = x.dycast<Reactive_Value>();
         if (xre && xre->sctype_ == SC_Type::Num()) {
             return {make<Reactive_Expression>(
@@ -612,12 +832,24 @@ struct Unary_Numeric_Array_Op
             stringify(f.callstr(x),": domain error"));
     }
 
+    // `xs` is either a List or a Range_Value. If `dest` is not null,
+    // it is `xs`, which is unique, and is reused to hold the result.
+    template <class XList>
     static Shared<List>
-    element_wise_op(const Scalar_Op& f, Shared<List> xs)
-    {
-        Shared<List> result = List::make(xs->size());
-        for (unsigned i = 0; i < xs->size(); ++i)
-            (*result)[i] = op(f, (*xs)[i]);
+    element_wise_op(const Scalar_Op& f, const XList& xs, List* dest)
+    {
+        Shared<List> result = dest ? share(*dest) : List::make(xs.size());
+        for (unsigned i = 0; i < xs.size(); ++i) {
+            Value x = take_element(xs, i, dest);
+            if (x.is_num()) {
+                double r = f.call(x.to_num_unsafe());
+                if (r == r) {
+                    (*result)[i] = {r};
+                    continue;
+                }
+            }
+            (*result)[i] = op(f, std::move(x));
+        }
         return result;
     }
 };
@@ -625,8 +857,8 @@ struct Unary_Numeric_Array_Op
 template <class Prim>
 struct Unary_Array_Op
 {
-    // TODO: optimize: move semantics. unique object reuse.
-
+    // Pass a uniquely owned list argument using std::move,
+    // so that its storage can be reused for the result.
     static Value
     op(const Context& cx, Value x)
     {
@@ -637,7 +869,9 @@ struct Unary_Array_Op
             Ref_Value& rx(x.to_ref_unsafe());
             switch (rx.type_) {
             case Ref_Value::ty_list:
-                return element_wise_op(cx, (List&)rx);
+                return visit_list(rx, [&](const auto& xlist) {
+                    return element_wise_op(cx, xlist, unique_list(x));
+                });
             case Ref_Value::ty_reactive:
                 return reactive_op(cx, x);
             }
@@ -653,12 +887,15 @@ struct Unary_Array_Op
         return Prim::sc_call(f, a);
     }
 
+    // `xs` is either a List or a Range_Value. If `dest` is not null,
+    // it is `xs`, which is unique, and is reused to hold the result.
+    template <class XList>
     static Value
-    element_wise_op(const Context& cx, List& xs)
+    element_wise_op(const Context& cx, const XList& xs, List* dest)
     {
-        Shared<List> result = List::make(xs.size());
+        Shared<List> result = dest ? share(*dest) : List::make(xs.size());
         for (unsigned i = 0; i < xs.size(); ++i)
-            (*result)[i] = op(cx, xs[i]);
+            (*result)[i] = op(cx, take_element(xs, i, dest));
         return {result};
     }
 
@@ -52,7 +52,7 @@ struct Unary_Array_Func : public Function
     using Op = Unary_Array_Op<Prim>;
     Value call(Value arg, Frame& f) override
     {
-        return Op::op(At_Arg(*this, f), arg);
+        return Op::op(At_Arg(*this, f), std::move(arg));
     }
     SC_Value sc_call_expr(Operation& argx, Shared<const Phrase> ph, SC_Frame& f)
     const override
@@ -164,8 +164,7 @@ struct Bit_Prim : public Unary_Bool_Prim
     static SC_Value sc_call(SC_Frame& f, SC_Value arg)
     {
         auto result = f.sc_.newvalue(SC_Type::Num_Or_Vec(arg.type.count()));
-        f.sc_.out() << "  " << result.type << " " << result << " = "
-            << result.type << "(" << arg << ");\n";
+        f.sc_.emit_construct(result, &arg, 1);
         return result;
     }
 };
@@ -268,12 +267,10 @@ struct Atan2_Function : public Legacy_Function
             throw Exception(At_SC_Phrase(f.call_phrase_, f),
                 "domain error");
 
+        x = sc_convert(f, x, At_SC_Arg(0, f), rtype);
+        y = sc_convert(f, y, At_SC_Arg(1, f), rtype);
         SC_Value result = f.sc_.newvalue(rtype);
-        f.sc_.out() <<"  "<<rtype<<" "<<result<<" = atan(";
-        sc_put_as(f, x, At_SC_Arg(0, f), rtype);
-        f.sc_.out() << ",";
-        sc_put_as(f, y, At_SC_Arg(1, f), rtype);
-        f.sc_.out() << ");\n";
+        f.sc_.emit_call(result, "atan", {x, y});
         return result;
     }
 };
@@ -300,44 +297,36 @@ SC_Value sc_minmax(const char* name, Operation& argx, SC_Frame& f)
                     name,": argument has bad type"));
             }
         }
-        auto result = f.sc_.newvalue(type);
         if (args.size() == 0) {
             // TODO: BUG: this only works for 'max'. min requires +inf.
-            f.sc_.out() << "  " << type << " " << result << " = -0.0/0.0;\n";
+            auto result = f.sc_.newvalue(type);
+            f.sc_.emit_num(result, NAN);
+            return result;
         }
-        else if (args.size() == 1)
-            return args.front();
-        else {
-            f.sc_.out() << "  " << type << " " << result << " = ";
-            int rparens = 0;
-            while (args.size() > 2) {
-                f.sc_.out() << name << "(" << args.front() << ",";
-                args.pop_front();
-                ++rparens;
-            }
-            f.sc_.out() << name << "(" << args.front() << "," << args.back() << ")";
-            while (rparens > 0) {
-                f.sc_.out() << ")";
-                --rparens;
-            }
-            f.sc_.out() << ";\n";
+        // name(a,name(b,c))
+        auto result = args.back();
+        args.pop_back();
+        while (!args.empty()) {
+            auto x = args.back();
+            args.pop_back();
+            auto y = result;
+            result = f.sc_.newvalue(x.type.is_num_vec() ? x.type : y.type);
+            f.sc_.emit_call(result, name, {x, y});
         }
         return result;
     } else {
         auto arg = sc_eval_op(f, argx);
-        auto result = f.sc_.newvalue(SC_Type::Num());
-        f.sc_.out() << "  float "<<result<<" = ";
-        if (arg.type == SC_Type::Vec(2))
-            f.sc_.out() << name <<"("<<arg<<".x,"<<arg<<".y);\n";
-        else if (arg.type == SC_Type::Vec(3))
-            f.sc_.out() << name<<"("<<name<<"("<<arg<<".x,"<<arg<<".y),"
-                <<arg<<".z);\n";
-        else if (arg.type == SC_Type::Vec(4))
-            f.sc_.out() << name<<"("<<name<<"("<<name<<"("<<arg<<".x,"<<arg<<".y),"
-                <<arg<<".z),"<<arg<<".w);\n";
-        else
+        if (!arg.type.is_num_vec())
             throw Exception(At_SC_Phrase(argx.syntax_, f), stringify(
                 name,": argument is not a vector"));
+        // name(name(a.x,a.y),a.z)
+        auto result = sc_vec_element(f, arg, 0);
+        for (unsigned i = 1; i < arg.type.count(); ++i) {
+            auto y = sc_vec_element(f, arg, i);
+            auto x = result;
+            result = f.sc_.newvalue(SC_Type::Num());
+            f.sc_.emit_call(result, name, {x, y});
+        }
         return result;
     }
 }
@@ -457,13 +446,13 @@ Value add(Value a, Value b, const At_Syntax& cx)
         Scalar_Op(const At_Syntax& as) : cx(as) {}
     };
     static Binary_Numeric_Array_Op<Scalar_Op> array_op;
-    return array_op.op(Scalar_Op(cx), a, b);
+    return array_op.op(Scalar_Op(cx), std::move(a), std::move(b));
 }
 Value Add_Expr::eval(Frame& f) const
 {
     Value a = arg1_->eval(f);
     Value b = arg2_->eval(f);
-    return add(a,b, At_Phrase(*syntax_, f));
+    return add(std::move(a), std::move(b), At_Phrase(*syntax_, f));
 }
 SC_Value Add_Expr::sc_eval(SC_Frame& f) const
 {
@@ -478,27 +467,19 @@ struct CppName##_Prim : public Binary_Bool_Or_Bool32_Prim\
     static Value call(bool x, bool y, const Context&) { return {x LogOp y}; }\
     static SC_Value sc_call(SC_Frame& f, SC_Value x, SC_Value y)\
     {\
-        auto result = f.sc_.newvalue(x.type);\
-        f.sc_.out() << "  " << x.type << " " << result << " = ";\
-        if (x.type.is_bool())\
-            f.sc_.out() << x << #LogOp << y << ";\n";\
-        else if (x.type.is_bool_or_vec()) {\
+        if (x.type.is_bool_or_vec() && !x.type.is_bool()) {\
             /* In GLSL 4.6, I *think* you can use '&' and '|' instead. */ \
             /* TODO: SubCurv: more efficient and|or in bvec case */ \
-            bool first = true;\
-            f.sc_.out() << x.type << "(";\
+            SC_Value elem[4];\
             for (unsigned i = 0; i < x.type.count(); ++i) {\
-                if (!first) f.sc_.out() << ",";\
-                first = false;\
-                f.sc_.out() << x << "[" << i << "]"\
-                    << #LogOp << y << "[" << i << "]";\
+                elem[i] = sc_binop(f, SC_Type::Bool(),\
+                    sc_vec_element(f, x, i), #LogOp, sc_vec_element(f, y, i));\
             }\
-            f.sc_.out() << ")";\
+            auto result = f.sc_.newvalue(x.type);\
+            f.sc_.emit_construct(result, elem, x.type.count());\
+            return result;\
         }\
-        else\
-            f.sc_.out() << x << #BitOp << y << ";\n";\
-        f.sc_.out() << ";\n";\
-        return result;\
+        return sc_binop(f, x.type, x, x.type.is_bool() ? #LogOp : #BitOp, y);\
     }\
 };\
 using CppName##_Function = Monoid_Func<CppName##_Prim>;\
@@ -513,14 +494,12 @@ struct Xor_Prim : public Binary_Bool_Or_Bool32_Prim
     static SC_Value sc_call(SC_Frame& f, SC_Value x, SC_Value y)
     {
         auto result = f.sc_.newvalue(x.type);
-        f.sc_.out() << "  " << result.type << " " << result << " = ";
         if (x.type.is_bool())
-            f.sc_.out() << x << "!=" << y;
+            f.sc_.emit_binop(result, x, "!=", y);
         else if (x.type.is_bool_or_vec())
-            f.sc_.out() << "notEqual(" << x << "," << y << ")";
+            f.sc_.emit_call(result, "notEqual", {x, y});
         else // bool32 or vector of bool32
-            f.sc_.out() << x << "^" << y;
-        f.sc_.out() << ";\n";
+            f.sc_.emit_binop(result, x, "^", y);
         return result;
     }
 };
@@ -587,10 +566,7 @@ struct Bool32_Sum_Prim : public Binary_Bool32_Prim
     }
     static SC_Value sc_call(SC_Frame& f, SC_Value x, SC_Value y)
     {
-        auto result = f.sc_.newvalue(x.type);
-        f.sc_.out() << "  " << x.type << " " << result << " = "
-            << x << " + " << y << ";\n";
-        return result;
+        return sc_binop(f, x.type, x, "+", y);
     }
 };
 using Bool32_Sum_Function = Monoid_Func<Bool32_Sum_Prim>;
@@ -608,10 +584,7 @@ struct Bool32_Product_Prim : public Binary_Bool32_Prim
     }
     static SC_Value sc_call(SC_Frame& f, SC_Value x, SC_Value y)
     {
-        auto result = f.sc_.newvalue(x.type);
-        f.sc_.out() << "  " << x.type << " " << result << " = "
-            << x << " * " << y << ";\n";
-        return result;
+        return sc_binop(f, x.type, x, "*", y);
     }
 };
 using Bool32_Product_Function = Monoid_Func<Bool32_Product_Prim>;
@@ -678,8 +651,7 @@ struct Bool32_To_Float_Prim : public Unary_Bool32_Prim
     {
         unsigned count = x.type == SC_Type::Bool32() ? 1 : x.type.count();
         auto result = f.sc_.newvalue(SC_Type::Num_Or_Vec(count));
-        f.sc_.out() << "  " << result.type << " " << result
-            << " = uintBitsToFloat(" << x << ");\n";
+        f.sc_.emit_call(result, "uintBitsToFloat", {x});
         return result;
     }
 };
@@ -694,8 +666,7 @@ struct Float_To_Bool32_Prim : public Unary_Num_Prim
     static SC_Value sc_call(SC_Frame& f, SC_Value x)
     {
         auto result = f.sc_.newvalue(SC_Type::Bool32(x.type.count()));
-        f.sc_.out() << "  " << result.type << " " << result
-            << " = floatBitsToUint(" << x << ");\n";
+        f.sc_.emit_call(result, "floatBitsToUint", {x});
         return result;
     }
 };
@@ -707,10 +678,16 @@ select(Value a, Value b, Value c, const Context& cx)
     if (a.is_bool())
         return a.to_bool_unsafe() ? b : c;
     if (auto alist = a.dycast<List>()) {
-        auto blist = b.dycast<List>();
-        if (blist) blist->assert_size(alist->size(), At_Index(1, cx));
-        auto clist = c.dycast<List>();
-        if (clist) clist->assert_size(alist->size(), At_Index(2, cx));
+        // b and c may be packed lists of numbers.
+        Shared<List> blist, clist;
+        if (is_list(b)) {
+            blist = to_list(b, At_Index(1, cx));
+            blist->assert_size(alist->size(), At_Index(1, cx));
+        }
+        if (is_list(c)) {
+            clist = to_list(c, At_Index(2, cx));
+            clist->assert_size(alist->size(), At_Index(2, cx));
+        }
         Shared<List> r = List::make(alist->size());
         for (unsigned i = 0; i < alist->size(); ++i) {
             r->at(i) = select(alist->at(i),
@@ -767,8 +744,7 @@ struct Select_Function : public Legacy_Function
         SC_Value result;
         if (cond.type.is_bool()) {
             result = f.sc_.newvalue(consequent.type);
-            f.sc_.out() << "  " << result.type << " " << result << " = ";
-            f.sc_.out() << cond << "?" << consequent << ":" << alternate;
+            f.sc_.emit_select(result, cond, consequent, alternate);
         } else {
             // 'cond' is a boolean vector.
             if (consequent.type.count() == 1) {
@@ -787,8 +763,6 @@ struct Select_Function : public Legacy_Function
                     "Vector length ",consequent.type.count()," does not match"
                     " length of condition vector (", cond.type.count(),")"));
             }
-            result = f.sc_.newvalue(consequent.type);
-            f.sc_.out() << "  " << result.type << " " << result << " = ";
             // In GLSL 4.5, this is `mix(alt,cons,cond)` (all args are vectors).
             // Right now, we are locked to GLSL 3.3, so we can't use this.
             // TODO: SubCurv: more efficient `select` for vector case
@@ -800,22 +774,23 @@ struct Select_Function : public Legacy_Function
                 // fail due to floating point approximation). But I saw IQ use
                 // linear interpolation of vectors to implement a 'select' in
                 // WebGL, so maybe this is efficient code.
-                f.sc_.out() << "mix(" << alternate << "," << consequent
-                    << ",vec" << cond.type.count() << "(" << cond << "))";
+                auto t = f.sc_.newvalue(consequent.type);
+                f.sc_.emit_construct(t, &cond, 1);
+                result = f.sc_.newvalue(consequent.type);
+                f.sc_.emit_call(result, "mix", {alternate, consequent, t});
             } else {
-                f.sc_.out() << result.type << "(";
-                bool atfirst = true;
-                for (unsigned i = 0; i < result.type.count(); ++i) {
-                    if (!atfirst) f.sc_.out() << ",";
-                    atfirst = false;
-                    f.sc_.out() << cond << "[" << i << "] ? "
-                                << consequent << "[" << i << "] : "
-                                << alternate << "[" << i << "]";
+                SC_Value elem[4];
+                for (unsigned i = 0; i < consequent.type.count(); ++i) {
+                    elem[i] = f.sc_.newvalue(consequent.type.abase());
+                    f.sc_.emit_select(elem[i],
+                        sc_vec_element(f, cond, i),
+                        sc_vec_element(f, consequent, i),
+                        sc_vec_element(f, alternate, i));
                 }
-                f.sc_.out() << ")";
+                result = f.sc_.newvalue(consequent.type);
+                f.sc_.emit_construct(result, elem, consequent.type.count());
             }
         }
-        f.sc_.out() << ";\n";
         return result;
     }
 };
@@ -829,13 +804,10 @@ struct Equal_Prim : public Binary_Scalar_Prim
     static SC_Value sc_call(SC_Frame& f, SC_Value x, SC_Value y)
     {
         auto result = f.sc_.newvalue(SC_Type::Bool(x.type.count()));
-        f.sc_.out() << "  " << result.type << " " << result << " = ";
-        if (x.type.is_any_vec()) {
-            f.sc_.out() << "equal(" << x << "," << y << ")";
-        } else {
-            f.sc_.out() << x << "==" << y;
-        }
-        f.sc_.out() << ";\n";
+        if (x.type.is_any_vec())
+            f.sc_.emit_call(result, "equal", {x, y});
+        else
+            f.sc_.emit_binop(result, x, "==", y);
         return result;
     }
 };
@@ -849,13 +821,10 @@ struct Unequal_Prim : public Binary_Scalar_Prim
     static SC_Value sc_call(SC_Frame& f, SC_Value x, SC_Value y)
     {
         auto result = f.sc_.newvalue(SC_Type::Bool(x.type.count()));
-        f.sc_.out() << "  " << result.type << " " << result << " = ";
-        if (x.type.is_any_vec()) {
-            f.sc_.out() << "notEqual(" << x << "," << y << ")";
-        } else {
-            f.sc_.out() << x << "!=" << y;
-        }
-        f.sc_.out() << ";\n";
+        if (x.type.is_any_vec())
+            f.sc_.emit_call(result, "notEqual", {x, y});
+        else
+            f.sc_.emit_binop(result, x, "!=", y);
         return result;
     }
 };
@@ -868,9 +837,7 @@ SC_Value Equal_Expr::sc_eval(SC_Frame& f) const
         throw Exception(At_SC_Phrase(syntax_, f),
             stringify("domain error: ",a.type," == ",b.type));
     }
-    SC_Value result = f.sc_.newvalue(SC_Type::Bool());
-    f.sc_.out() <<"  bool "<<result<<" =("<<a<<" == "<<b<<");\n";
-    return result;
+    return sc_binop(f, SC_Type::Bool(), a, "==", b);
 }
 SC_Value Not_Equal_Expr::sc_eval(SC_Frame& f) const
 {
@@ -880,9 +847,7 @@ SC_Value Not_Equal_Expr::sc_eval(SC_Frame& f) const
         throw Exception(At_SC_Phrase(syntax_, f),
             stringify("domain error: ",a.type," != ",b.type));
     }
-    SC_Value result = f.sc_.newvalue(SC_Type::Bool());
-    f.sc_.out() <<"  bool "<<result<<" =("<<a<<" != "<<b<<");\n";
-    return result;
+    return sc_binop(f, SC_Type::Bool(), a, "!=", b);
 }
 
 // Generalized dot product that includes vector dot product and matrix product.
@@ -903,7 +868,7 @@ struct Dot_Function : public Legacy_Function
         if (a.type != b.type)
             throw Exception(At_SC_Arg(1, f), "dot: arguments have different types");
         auto result = f.sc_.newvalue(SC_Type::Num());
-        f.sc_.out() << "  float "<<result<<" = dot("<<a<<","<<b<<");\n";
+        f.sc_.emit_call(result, "dot", {a, b});
         return result;
     }
 };
@@ -916,15 +881,27 @@ struct Mag_Function : public Legacy_Function
         // TODO: use hypot() or BLAS DNRM2 or Eigen stableNorm/blueNorm?
         // Avoids overflow/underflow due to squaring of large/small values.
         // Slower.  https://forum.kde.org/viewtopic.php?f=74&t=62402
-        auto list = args[0].to<List>(At_Arg(*this, args));
-        // Fast path: assume we have a list of number, compute a result.
-        double sum = 0.0;
-        for (auto val : *list) {
-            double x = val.to_num_or_nan();
-            sum += x * x;
+        if (auto packed = packed_list(args[0])) {
+            // Fastest path: a packed list contains only numbers.
+            const double* x = packed->data();
+            double sum = 0.0;
+            for (size_t i = 0; i < packed->size(); ++i)
+                sum += x[i] * x[i];
+            return {sqrt(sum)};
         }
+        // Fast path: assume we have a list of number, compute a result.
+        double sum = visit_list(args[0], At_Arg(*this, args),
+            [](const auto& list) {
+                double sum = 0.0;
+                for (size_t i = 0; i < list.size(); ++i) {
+                    double x = list[i].to_num_or_nan();
+                    sum += x * x;
+                }
+                return sum;
+            });
         if (sum == sum)
             return {sqrt(sum)};
+        auto list = args[0].to<List>(At_Arg(*this, args));
         // The computation failed. Second fastest path: assume a mix of numbers
         // and reactive numbers, try to return a reactive result.
         Shared<List_Expr> rlist =
@@ -964,7 +941,7 @@ struct Mag_Function : public Legacy_Function
         if (!arg.type.is_num_vec())
             throw Exception(At_SC_Arg(0, f), "mag: argument is not a vector");
         auto result = f.sc_.newvalue(SC_Type::Num());
-        f.sc_.out() << "  float "<<result<<" = length("<<arg<<");\n";
+        f.sc_.emit_call(result, "length", {arg});
         return result;
     }
 };
@@ -974,8 +951,11 @@ struct Count_Function : public Legacy_Function
     Count_Function(const char* nm) : Legacy_Function(1,nm) {}
     Value call(Frame& args) override
     {
-        if (auto list = args[0].dycast<const List>())
-            return {double(list->size())};
+        if (is_list(args[0])) {
+            return visit_list(args[0].to_ref_unsafe(), [](const auto& list) {
+                return Value{double(list.size())};
+            });
+        }
         if (auto string = args[0].dycast<const String>())
             return {double(string->size())};
         if (auto re = args[0].dycast<const Reactive_Value>()) {
@@ -992,7 +972,7 @@ struct Count_Function : public Legacy_Function
         if (!arg.type.is_list())
             throw Exception(At_SC_Arg(0, f), "count: argument is not a list");
         auto result = f.sc_.newvalue(SC_Type::Num());
-        f.sc_.out() << "  float "<<result<<" = "<<arg.type.count()<<";\n";
+        f.sc_.emit_num(result, arg.type.count());
         return result;
     }
 };
@@ -1012,16 +992,19 @@ struct Strcat_Function : public Legacy_Function
     Strcat_Function(const char* nm) : Legacy_Function(1,nm) {}
     Value call(Frame& args) override
     {
-        if (auto list = args[0].dycast<const List>()) {
+        if (is_list(args[0])) {
             String_Builder sb;
-            for (auto val : *list) {
-                if (auto str = val.dycast<const String_or_Symbol>())
-                    sb << *str;
-                else if (val.is_bool())
-                    sb << (val.to_bool_unsafe() ? "true" : "false");
-                else
-                    sb << val;
-            }
+            visit_list(args[0].to_ref_unsafe(), [&](const auto& list) {
+                for (size_t i = 0; i < list.size(); ++i) {
+                    Value val = list[i];
+                    if (auto str = val.dycast<const String_or_Symbol>())
+                        sb << *str;
+                    else if (val.is_bool())
+                        sb << (val.to_bool_unsafe() ? "true" : "false");
+                    else
+                        sb << val;
+                }
+            });
             return {sb.get_string()};
         }
         throw Exception(At_Arg(*this, args), "not a list");
@@ -1044,9 +1027,10 @@ struct Decode_Function : public Legacy_Function
     {
         String_Builder sb;
         At_Arg cx(*this, f);
-        auto list = f[0].to<List>(cx);
-        for (size_t i = 0; i < list->size(); ++i)
-            sb << (char)(*list)[i].to_int(1, 127, At_Index(i,cx));
+        visit_list(f[0], cx, [&](const auto& list) {
+            for (size_t i = 0; i < list.size(); ++i)
+                sb << (char)list[i].to_int(1, 127, At_Index(i,cx));
+        });
         return {sb.get_string()};
     }
 };
@@ -1070,10 +1054,13 @@ struct Match_Function : public Legacy_Function
     Value call(Frame& f) override
     {
         At_Arg ctx0(*this, f);
-        auto list = f[0].to<List>(ctx0);
         std::vector<Shared<Function>> cases;
-        for (size_t i = 0; i < list->size(); ++i)
-            cases.push_back(list->at(i).to<Function>(At_Index(i,ctx0)));
+        visit_list(f[0], ctx0, [&](const auto& list) {
+            for (size_t i = 0; i < list.size(); ++i) {
+                Value fn = list.at(i);
+                cases.push_back(fn.to<Function>(At_Index(i,ctx0)));
+            }
+        });
         auto mf = make<Piecewise_Function>(cases);
         mf->name_ = name_;
         mf->argpos_ = 1;
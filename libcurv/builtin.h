@@ -15,7 +15,7 @@ namespace curv {
 struct Meaning;
 struct Identifier;
 
-struct Builtin : public Shared_Base
+struct Builtin : public Shared_Published_Base
 {
     virtual Shared<Meaning> to_meaning(const Identifier&) const = 0;
 };
@@ -23,7 +23,7 @@ struct Builtin : public Shared_Base
 struct Builtin_Value : public Builtin
 {
     Value value_;
-    Builtin_Value(Value v) : value_(std::move(v)) {}
+    Builtin_Value(Value v) : value_(std::move(v)) { value_.publish(); }
     virtual Shared<Meaning> to_meaning(const Identifier&) const override;
 };
 
@@ -382,7 +382,9 @@ analyse_module(Definition& def, Environ& env)
 Function_Setter_Base::Element::Element(slot_t s, Shared<Lambda> l)
 :
     slot_(s), lambda_(l)
-{}
+{
+    lambda_->publish();
+}
 
 Function_Setter_Base::Element::Element() noexcept {}
 
@@ -14,7 +14,7 @@ struct Recursive_Scope;
 
 // All Definitions are 'recursive' definitions. Sequential definitions
 // begin with the 'local' keyword and aren't part of the Definition protocol.
-struct Definition : public Shared_Base
+struct Definition : public Shared_Published_Base
 {
     Shared<const Phrase> syntax_;
 
@@ -9,6 +9,7 @@
 #include <libcurv/import.h>
 #include <cstdlib>
 #include <iostream>
+#include <mutex>
 
 namespace curv {
 
@@ -34,6 +35,8 @@ Dir_Record::Dir_Record(Filesystem::path dir, const Context& cx)
 {
     namespace fs = boost::filesystem;
     System& sys(cx.system());
+    if (!sys.import_cache_.pending_.empty())
+        deps_ = sys.import_cache_.pending_.back();
 
     fs::directory_iterator i(dir);
     fs::directory_iterator end;
@@ -68,11 +71,13 @@ Dir_Record::Dir_Record(Filesystem::path dir, const Context& cx)
     }
 }
 
-Dir_Record::Dir_Record(Filesystem::path dir, Symbol_Map<File> fields)
+Dir_Record::Dir_Record(Filesystem::path dir, Symbol_Map<File> fields,
+    std::shared_ptr<Import_Deps> deps)
 :
     Record(Ref_Value::sty_dir_record),
     dir_(dir),
-    fields_(fields)
+    fields_(fields),
+    deps_(std::move(deps))
 {
 }
 
@@ -93,9 +98,59 @@ Value Dir_Record::find_field(Symbol_Ref sym, const Context& cx) const
     auto p = fields_.find(sym);
     if (p == fields_.end())
         return missing;
-    if (p->second.value_.is_missing())
-        p->second.value_ = p->second.importer_(p->second.path_, cx);
-    return p->second.value_;
+    return file_value(p->second, &cx);
+}
+
+// Files are imported lazily, which mutates the Dir_Record. A published
+// Dir_Record may be accessed by several threads, so this is done while
+// holding a lock (recursive, since an import may reference another file),
+// and the imported value is published. A thread of a parallel `for` loop
+// doesn't import into a shared Dir_Record: the loop is run again sequentially,
+// so that the file's output is kept, in order.
+Value Dir_Record::file_value(const File& file, const Context* cx) const
+{
+    if (!is_published()) {
+        if (file.value_.is_missing() && cx != nullptr)
+            file.value_ = import_file(file, *cx);
+        return file.value_;
+    }
+    static std::recursive_mutex mutex;
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    if (file.value_.is_missing() && cx != nullptr) {
+        auto& cache = cx->system().import_cache_;
+        if (cache.parallel_)
+            cache.miss(*cx);
+        Value val = import_file(file, *cx);
+        val.publish();
+        file.value_ = val;
+    }
+    return file.value_;
+}
+
+// The value of the file is stored in this Dir_Record, so the files that it
+// imports are dependencies of the cached import that created the Dir_Record,
+// which may have finished long ago, as well as of the current import.
+Value Dir_Record::import_file(const File& file, const Context& cx) const
+{
+    auto& cache = cx.system().import_cache_;
+    Value val;
+    std::shared_ptr<Import_Deps> deps;
+    {
+        Pending_Import pi(cache);
+        pi.deps_->add(File_Stamp::get(file.path_));
+        val = file.importer_(file.path_, cx);
+        deps = pi.deps_;
+    }
+    if (deps_)
+        deps_->add(deps);
+    cache.depend(deps);
+    return val;
+}
+
+void Dir_Record::publish_children() const
+{
+    for (auto& f : fields_)
+        f.second.value_.publish();
 }
 
 bool Dir_Record::hasfield(Symbol_Ref sym) const
@@ -111,7 +166,7 @@ size_t Dir_Record::size() const
 Shared<Record>
 Dir_Record::clone() const
 {
-    return make<Dir_Record>(dir_, fields_);
+    return make<Dir_Record>(dir_, fields_, deps_);
 }
 
 Value*
@@ -122,10 +177,8 @@ Dir_Record::ref_field(Symbol_Ref name, bool need_value, const Context& cx)
         throw Exception(cx, stringify(Value{share(*this)},
             " has no field named ", name));
     }
-    if (p->second.value_.is_missing()) {
-        if (need_value)
-            p->second.value_ = p->second.importer_(p->second.path_, cx);
-    }
+    if (need_value)
+        file_value(p->second, &cx);
     return &p->second.value_;
 }
 
@@ -145,17 +198,14 @@ Dir_Record::Iter::Iter(const Dir_Record& rec)
 {
     if (i_ != rec_.fields_.end()) {
         key_ = i_->first;
-        value_ = i_->second.value_;
+        value_ = rec_.file_value(i_->second, nullptr);
     }
 }
 
 void Dir_Record::Iter::load_value(const Context& cx)
 {
-    if (i_ != rec_.fields_.end()) {
-        if (i_->second.value_.is_missing())
-            i_->second.value_ = i_->second.importer_(i_->second.path_, cx);
-        value_ = i_->second.value_;
-    }
+    if (i_ != rec_.fields_.end())
+        value_ = rec_.file_value(i_->second, &cx);
 }
 
 void Dir_Record::Iter::next()
@@ -163,7 +213,7 @@ void Dir_Record::Iter::next()
     ++i_;
     if (i_ != rec_.fields_.end()) {
         key_ = i_->first;
-        value_ = i_->second.value_;
+        value_ = rec_.file_value(i_->second, nullptr);
     } else
         key_ = Symbol_Ref();
 }
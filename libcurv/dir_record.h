@@ -22,9 +22,14 @@ struct Dir_Record : public Record
         mutable Value value_;
     };
     Symbol_Map<File> fields_;
+    // The dependencies of the import that created this Dir_Record, if any,
+    // which are cached with its value. The files that are imported later,
+    // on first reference, are added to them.
+    std::shared_ptr<Import_Deps> deps_;
 
     Dir_Record(Filesystem::path dir, const Context&);
-    Dir_Record(Filesystem::path dir, Symbol_Map<File> fields);
+    Dir_Record(Filesystem::path dir, Symbol_Map<File> fields,
+        std::shared_ptr<Import_Deps> deps);
 
     virtual void print(std::ostream&) const override;
     virtual Value find_field(Symbol_Ref, const Context&) const override;
@@ -45,7 +50,16 @@ struct Dir_Record : public Record
         virtual void next() override;
     };
     virtual std::unique_ptr<Record::Iter> iter() const override;
+
+    /// Return the value of a file. It is imported on first reference if `cx`
+    /// is not null; otherwise, missing is returned if it isn't imported yet.
+    Value file_value(const File&, const Context* cx) const;
+protected:
+    virtual void publish_children() const override;
+private:
+    Value import_file(const File&, const Context&) const;
 };
+REF_TAG(Dir_Record, sty_dir_record, sty_dir_record);
 
 }
 #endif
@@ -41,7 +41,10 @@ struct StyleSpec { const char* inf; const char* nan; } stylespec[4] = {
     { "1.0/0.0", "0.0/0.0" }, // EXPR
 };
 
-void dtostr(double n, char* buf, dfmt::style style)
+// Format `n`, which is exactly representable as a float if `mode` is
+// SHORTEST_SINGLE.
+static void
+format(double n, Converter::DtoaMode mode, char* buf, dfmt::style style)
 {
     if (n != n) {
         strcpy(buf, stylespec[style].nan);
@@ -63,7 +66,7 @@ void dtostr(double n, char* buf, dfmt::style style)
     char decimal_rep[kDecimalRepCapacity];
     int decimal_rep_length;
 
-    Converter::DoubleToAscii(n, Converter::SHORTEST, 0,
+    Converter::DoubleToAscii(n, mode, 0,
         decimal_rep, kDecimalRepCapacity,
         &sign, &decimal_rep_length, &decimal_point);
 
@@ -136,6 +139,16 @@ void dtostr(double n, char* buf, dfmt::style style)
     sprintf(p, "%d", decimal_point - 1);
 }
 
+void dtostr(double n, char* buf, dfmt::style style)
+{
+    format(n, Converter::SHORTEST, buf, style);
+}
+
+void ftostr(float n, char* buf, dfmt::style style)
+{
+    format(n, Converter::SHORTEST_SINGLE, buf, style);
+}
+
 // Print a floating point number accurately.
 std::ostream&
 operator<<(std::ostream& out, dfmt n)
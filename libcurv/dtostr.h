@@ -51,5 +51,11 @@ constexpr int DTOSTR_BUFSIZE = 32;
 /// when read using strtod, reconstructs the original number exactly.
 void dtostr(double, char[DTOSTR_BUFSIZE], dfmt::style = dfmt::C);
 
+/// Format a float as the shortest decimal string that,
+/// when read using strtof, reconstructs the original number exactly.
+/// This is shorter than the output of dtostr for the same number,
+/// eg 0.1f is "0.1", not "0.10000000149011612".
+void ftostr(float, char[DTOSTR_BUFSIZE], dfmt::style = dfmt::C);
+
 } // namespace curv
 #endif // header guard
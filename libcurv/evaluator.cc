@@ -13,7 +13,13 @@
 #include <libcurv/record.h>
 #include <libcurv/sc_compiler.h>
 #include <libcurv/string.h>
+#include <libcurv/system.h>
+#include <atomic>
 #include <cmath>
+#include <exception>
+#include <sstream>
+#include <thread>
+#include <vector>
 
 namespace curv {
 
@@ -94,9 +100,11 @@ Value
 Symbolic_Ref::eval(Frame& f) const
 {
     auto& m = *f.nonlocals_;
-    auto b = m.dictionary_->find(name_);
-    assert(b != m.dictionary_->end());
-    return m.get(b->second);
+    slot_t slot;
+    bool found = cache_.find(*m.dictionary_, name_, slot);
+    assert(found);
+    (void)found;
+    return m.get(slot);
 }
 
 Value
@@ -123,6 +131,15 @@ Value
 Dot_Expr::eval(Frame& f) const
 {
     Value basev = base_->eval(f);
+    if (selector_.id_ && basev.is_ref()) {
+        auto& ref = basev.to_ref_unsafe();
+        if (ref.subtype_ == Ref_Value::sty_module) {
+            auto& m = (Module&)ref;
+            slot_t slot;
+            if (cache_.find(*m.dictionary_, selector_.id_->symbol_, slot))
+                return m.get(slot);
+        }
+    }
     Symbol_Ref id = selector_.eval(f);
     return basev.at(id, At_Phrase(*base_->syntax_, f));
 }
@@ -132,11 +149,13 @@ eval_not(Value x, const At_Syntax& cx)
 {
     if (x.is_bool())
         return {!x.to_bool_unsafe()};
-    if (auto xlist = x.dycast<List>()) {
-        Shared<List> result = List::make(xlist->size());
-        for (unsigned i = 0; i < xlist->size(); ++i)
-            (*result)[i] = eval_not((*xlist)[i], cx);
-        return {result};
+    if (is_list(x)) {
+        return visit_list(x.to_ref_unsafe(), [&](const auto& xlist) {
+            Shared<List> result = List::make(xlist.size());
+            for (unsigned i = 0; i < xlist.size(); ++i)
+                (*result)[i] = eval_not(xlist[i], cx);
+            return Value{result};
+        });
     }
     auto re = x.dycast<Reactive_Value>();
     if (re && re->sctype_ == SC_Type::Bool()) {
@@ -210,14 +229,14 @@ Subtract_Expr::eval(Frame& f) const
     static Binary_Numeric_Array_Op<Scalar_Op> array_op;
     Value a = arg1_->eval(f);
     Value b = arg2_->eval(f);
-    return array_op.op(Scalar_Op(*syntax_, f), a, b);
+    return array_op.op(Scalar_Op(*syntax_, f), std::move(a), std::move(b));
 }
 Value
 Multiply_Expr::eval(Frame& f) const
 {
     Value a = arg1_->eval(f);
     Value b = arg2_->eval(f);
-    return multiply(a,b, At_Phrase(*syntax_, f));
+    return multiply(std::move(a), std::move(b), At_Phrase(*syntax_, f));
 }
 Value
 Divide_Expr::eval(Frame& f) const
@@ -240,7 +259,7 @@ Divide_Expr::eval(Frame& f) const
     static Binary_Numeric_Array_Op<Scalar_Op> array_op;
     Value a = arg1_->eval(f);
     Value b = arg2_->eval(f);
-    return array_op.op(Scalar_Op(*syntax_, f), a, b);
+    return array_op.op(Scalar_Op(*syntax_, f), std::move(a), std::move(b));
 }
 
 Value
@@ -378,7 +397,7 @@ Class::eval(Frame& f) const \
         return {true}; \
     if (a.to_num_or_nan() GE b.to_num_or_nan()) \
         return {false}; \
-    return array_op.op(At_Phrase(*syntax_,f), a, b); \
+    return array_op.op(At_Phrase(*syntax_,f), std::move(a), std::move(b)); \
 } \
 SC_Value \
 Class::sc_eval(SC_Frame& f) const \
@@ -387,11 +406,10 @@ Class::sc_eval(SC_Frame& f) const \
     auto arg2 = sc_eval_num_or_vec(f, *arg2_); \
     sc_struc_unify(f, arg1, arg2, At_SC_Phrase(syntax_,f)); \
     SC_Value result = f.sc_.newvalue(SC_Type::Bool(arg1.type.count())); \
-    f.sc_.out() <<"  "<<result.type<<" "<<result<<" = "; \
     if (arg1.type.is_num()) \
-        f.sc_.out() <<"("<<arg1<<" "#LT" "<<arg2<<");\n"; \
+        f.sc_.emit_binop(result, arg1, #LT, arg2); \
     else \
-        f.sc_.out() <<#lessThan"("<<arg1<<","<<arg2<<");\n"; \
+        f.sc_.emit_call(result, #lessThan, {arg1, arg2}); \
     return result; \
 }
 RELATION(Less_Expr, <, >=, lessThan)
@@ -421,15 +439,17 @@ Power_Expr::eval(Frame& f) const
     return array_op.op(Scalar_Op(*syntax_, f), arg1_->eval(f), arg2_->eval(f));
 }
 
+template <class List_Type>
 Value
-list_at(const List& list, Value index, const Context& cx)
-{
-    if (auto indices = index.dycast<List>()) {
-        Shared<List> result = List::make(indices->size());
-        int j = 0;
-        for (auto i : *indices)
-            (*result)[j++] = list_at(list, i, cx);
-        return {result};
+list_at(const List_Type& list, Value index, const Context& cx)
+{
+    if (is_list(index)) {
+        return visit_list(index.to_ref_unsafe(), [&](const auto& indices) {
+            Shared<List> result = List::make(indices.size());
+            for (size_t j = 0; j < indices.size(); ++j)
+                (*result)[j] = list_at(list, indices[j], cx);
+            return Value{result};
+        });
     }
     int i = index.to_int(0, (int)(list.size()-1), cx);
     return list[i];
@@ -453,12 +473,14 @@ Value
 string_at(const String& string, Value index, const Context& cx)
 {
     // TODO: this code only works for ASCII strings.
-    if (auto indices = index.dycast<List>()) {
+    if (is_list(index)) {
         String_Builder sb;
-        for (auto ival : *indices) {
-            int i = ival.to_int(0, (int)(string.size()-1), cx);
-            sb << string[i];
-        }
+        visit_list(index.to_ref_unsafe(), [&](const auto& indices) {
+            for (size_t j = 0; j < indices.size(); ++j) {
+                int i = indices[j].to_int(0, (int)(string.size()-1), cx);
+                sb << string[i];
+            }
+        });
         return {sb.get_string()};
     }
     int i = index.to_int(0, (int)(string.size()-1), cx);
@@ -477,12 +499,14 @@ value_at_path(Value a, const List& path, Shared<const Phrase> callph, Frame& f)
                 goto domain_error;
             return string_at(*string, path[i], icx);
         }
-        if (auto list = a.dycast<List>()) {
-            if (i < path.size()-1) {
-                int j = path[i].to_int(0, (int)(list->size()-1), icx);
-                a = list->at(j);
-            } else
-                a = list_at(*list, path[i], icx);
+        if (is_list(a)) {
+            a = visit_list(a.to_ref_unsafe(), [&](const auto& list) {
+                if (i < path.size()-1) {
+                    int j = path[i].to_int(0, (int)(list.size()-1), icx);
+                    return Value{list[j]};
+                }
+                return list_at(list, path[i], icx);
+            });
             continue;
         }
         auto re = a.dycast<Reactive_Value>();
@@ -625,22 +649,31 @@ Call_Expr::tail_eval(std::unique_ptr<Frame>& f) const
     tail_call_func(func_->eval(*f), arg_->eval(*f), syntax_, f);
 }
 
-Shared<List>
-List_Expr_Base::eval_list(Frame& f) const
+void
+List_Expr_Base::exec_elements(Frame& f, List_Builder& lb) const
 {
-    // TODO: if the # of elements generated is known at compile time,
-    // then the List could be constructed directly without using a std::vector.
-    List_Builder lb;
+    // Each element usually generates one value, so this is typically
+    // the final size of the List.
+    lb.reserve(this->size());
     List_Executor lex(lb);
     for (size_t i = 0; i < this->size(); ++i)
         (*this)[i]->exec(f, lex);
+}
+
+Shared<List>
+List_Expr_Base::eval_list(Frame& f) const
+{
+    List_Builder lb;
+    exec_elements(f, lb);
     return lb.get_list();
 }
 
 Value
 List_Expr_Base::eval(Frame& f) const
 {
-    return {eval_list(f)};
+    List_Builder lb;
+    exec_elements(f, lb);
+    return lb.get_value();
 }
 
 void
@@ -649,9 +682,11 @@ Spread_Op::exec(Frame& f, Executor& ex) const
     At_Phrase cstmt(*syntax_, f);
     At_Phrase carg(*arg_->syntax_, f);
     auto arg = arg_->eval(f);
-    if (auto list = arg.dycast<const List>()) {
-        for (size_t i = 0; i < list->size(); ++i)
-            ex.push_value(list->at(i), cstmt);
+    if (is_list(arg)) {
+        visit_list(arg.to_ref_unsafe(), [&](const auto& list) {
+            for (size_t i = 0; i < list.size(); ++i)
+                ex.push_value(list[i], cstmt);
+        });
         return;
     }
     if (auto rec = arg.dycast<const Record>()) {
@@ -708,7 +743,11 @@ Scope_Executable::exec(Frame& f) const
 void
 Boxed_Locative::store(Frame& f, const Operation& expr) const
 {
-    *reference(f,false) = expr.eval(f);
+    // Evaluate `expr` first. If it refers to the list or record being
+    // updated (as in `a[0] := a`), then reference() must see that it is
+    // shared, and copy it.
+    Value val = expr.eval(f);
+    *reference(f,false) = val;
 }
 
 Shared<Locative>
@@ -739,23 +778,70 @@ Value*
 Dot_Locative::reference(Frame& f, bool need_value) const
 {
     Value* base = base_->reference(f,true);
-    Shared<Record> base_rec = base->to<Record>(At_Phrase(*base_->syntax_, f));
-    if (base_rec->use_count > 1) {
-        base_rec = base_rec->clone();
-        *base = {base_rec};
+    // Update the record in place if *base holds the only reference.
+    // Test the use_count before creating a Shared pointer to the record.
+    Record* base_rec = base->is_ref()
+        ? ref_cast<Record>(base->to_ref_unsafe()) : nullptr;
+    if (base_rec == nullptr || !base_rec->is_unique()) {
+        Shared<Record> copy =
+            base->to<Record>(At_Phrase(*base_->syntax_, f))->clone();
+        *base = {copy};
+        base_rec = copy.get();
+    }
+    if (selector_.id_ && base_rec->subtype_ == Ref_Value::sty_module) {
+        auto& m = (Module&)*base_rec;
+        slot_t slot;
+        if (cache_.find(*m.dictionary_, selector_.id_->symbol_, slot))
+            return &m.at(slot);
     }
     Symbol_Ref id = selector_.eval(f);
     return base_rec->ref_field(id, need_value, At_Phrase(*syntax_, f));
 }
 
+void
+Indexed_Locative::store(Frame& f, const Operation& expr) const
+{
+    // Evaluate `expr` first: see Boxed_Locative::store.
+    Value val = expr.eval(f);
+    Value* base = base_->reference(f,true);
+    // A number is stored into an unshared Packed_List in place.
+    // Anything else converts the Packed_List to a boxed List.
+    Packed_List* packed = packed_list(*base);
+    if (packed && packed->is_unique() && val.is_num()) {
+        At_Phrase cx(*syntax_, f);
+        int i = visit_list(index_->eval(f), cx, [&](const auto& index) {
+            index.assert_size(1, cx);
+            return index.at(0).to_int(0, int(packed->size())-1, cx);
+        });
+        packed->data()[i] = val.to_num_unsafe();
+        return;
+    }
+    *element(base, f, false) = val;
+}
+
 Value*
 Indexed_Locative::reference(Frame& f, bool need_value) const
 {
-    Value* base = base_->reference(f,true);
-    Shared<List> base_list = base->to<List>(At_Phrase(*base_->syntax_, f));
-    if (base_list->use_count > 1) {
-        base_list = base_list->clone();
-        *base = {base_list};
+    return element(base_->reference(f,true), f, need_value);
+}
+
+// Return a pointer to the element of the list *base selected by index_.
+// *base is first replaced by a boxed List, with no other references.
+Value*
+Indexed_Locative::element(Value* base, Frame& f, bool need_value) const
+{
+    // Update the list in place if *base holds the only reference.
+    // Test the use_count before creating a Shared pointer to the list.
+    List* base_list = base->is_ref()
+        ? ref_cast<List>(base->to_ref_unsafe()) : nullptr;
+    if (base_list == nullptr || !base_list->is_unique()) {
+        // *base is shared, or it's a Range_Value or Packed_List
+        // (converted by to<List>).
+        Shared<List> copy = base->to<List>(At_Phrase(*base_->syntax_, f));
+        if (!copy->is_unique())
+            copy = copy->clone();
+        *base = {copy};
+        base_list = copy.get();
     }
     auto ix = index_->eval(f);
     return base_list->ref_element(ix, need_value, At_Phrase(*syntax_, f));
@@ -841,25 +927,210 @@ While_Op::exec(Frame& f, Executor& ex) const
     }
 }
 
+namespace {
+
+// Set while a thread runs part of a parallel `for` loop, so that nested
+// loops run sequentially.
+thread_local bool in_parallel_for = false;
+
+// A list comprehension with fewer elements than this is not worth the cost
+// of starting threads.
+constexpr size_t k_parallel_for_min = 256;
+
+// The System used by one chunk of a parallel `for` loop. Console output
+// (from print, warning and so on) is buffered, and is written to the real
+// console afterwards, in iteration order. The chunk sees the files already
+// in the import cache, which were checked and published before the loop,
+// and the files it imports are recorded as dependencies of the file being
+// imported, if there is one.
+struct Chunk_System : public System
+{
+    System& sys_;
+    std::ostringstream console_;
+
+    Chunk_System(System& sys) : sys_(sys)
+    {
+        use_colour_ = sys.use_colour_;
+        use_json_api_ = sys.use_json_api_;
+        active_files_ = sys.active_files_;
+        importers_ = sys.importers_;
+        import_cache_.entries_ = sys.import_cache_.entries_;
+        import_cache_.parallel_ = true;
+        if (!sys.import_cache_.pending_.empty())
+            import_cache_.pending_.push_back(std::make_shared<Import_Deps>());
+    }
+    virtual const Namespace& std_namespace() override
+    {
+        return sys_.std_namespace();
+    }
+    virtual std::ostream& console() override
+    {
+        return console_;
+    }
+};
+
+// A contiguous range of the iterations of a parallel `for` loop.
+struct For_Chunk
+{
+    size_t begin_;
+    size_t end_;
+    std::unique_ptr<Chunk_System> sys_;
+    List_Builder values_;
+    bool stopped_ = false; // the loop condition became false
+    std::exception_ptr error_ = nullptr;
+};
+
+// Run a list comprehension on `jobs` threads. The list is split into chunks,
+// which idle threads take in order. Each chunk is run in a copy of the frame,
+// and the results are merged in order, so the result, the console output
+// and the error that is reported (the first one) don't depend on timing.
+//
+// A file that isn't in the import cache would be evaluated by each chunk
+// that imports it, repeating its output, so a chunk stops before evaluating
+// a file, the results are discarded and false is returned. The caller then
+// runs the loop sequentially, which leaves the file in the cache for next time.
+template <class List>
+bool
+parallel_for(
+    const For_Op& op, Frame& f, const List& list, Operation::Executor& ex,
+    unsigned jobs)
+{
+    auto& cache = f.system_.import_cache_;
+    cache.prune();
+    for (auto& e : cache.entries_)
+        e.second.value_.publish();
+
+    size_t n = list.size();
+    size_t nchunks = std::min(n, size_t(jobs) * 8);
+    std::vector<For_Chunk> chunks(nchunks);
+    for (size_t c = 0; c < nchunks; ++c) {
+        chunks[c].begin_ = n * c / nchunks;
+        chunks[c].end_ = n * (c + 1) / nchunks;
+        chunks[c].sys_ = std::make_unique<Chunk_System>(f.system_);
+    }
+
+    // The values visible to the loop body are shared by all of the threads.
+    for (slot_t i = 0; i < f.size_; ++i)
+        f[i].publish();
+    if (f.nonlocals_)
+        f.nonlocals_->publish();
+    if (f.func_)
+        f.func_->publish();
+
+    auto run_chunk = [&](For_Chunk& chunk) -> void {
+        auto cf = Frame::make(f.size_, *chunk.sys_, f.parent_frame_,
+            f.call_phrase_, f.nonlocals_);
+        cf->func_ = f.func_;
+        for (slot_t i = 0; i < f.size_; ++i)
+            (*cf)[i] = f[i];
+        Operation::List_Executor cex(chunk.values_);
+        At_Phrase cx{*op.list_->syntax_, *cf};
+        At_Index icx{0, cx};
+        for (size_t i = chunk.begin_; i < chunk.end_; ++i) {
+            icx.index_ = i;
+            op.pattern_->exec(cf->array_, list[i], icx, *cf);
+            if (op.cond_ && !op.cond_->eval(*cf).to_bool(
+                At_Phrase{*op.cond_->syntax_, *cf}))
+            {
+                chunk.stopped_ = true;
+                break;
+            }
+            op.body_->exec(*cf, cex);
+        }
+    };
+
+    // Chunks after one that stops the loop or fails are not needed,
+    // and no chunks are needed after one that evaluates a file.
+    std::atomic<size_t> next_chunk{0};
+    std::atomic<size_t> end_chunk{nchunks};
+    std::atomic<bool> imported{false};
+    auto worker = [&]() -> void {
+        in_parallel_for = true;
+        for (;;) {
+            size_t c = next_chunk++;
+            if (c >= end_chunk) break;
+            try {
+                run_chunk(chunks[c]);
+            } catch (...) {
+                chunks[c].error_ = std::current_exception();
+            }
+            if (chunks[c].sys_->import_cache_.misses_ > 0) {
+                imported = true;
+                end_chunk = 0;
+            }
+            else if (chunks[c].stopped_ || chunks[c].error_) {
+                size_t end = end_chunk;
+                while (c + 1 < end
+                    && !end_chunk.compare_exchange_weak(end, c + 1))
+                    ;
+            }
+        }
+        in_parallel_for = false;
+    };
+    {
+        Parallel_Section section;
+        std::vector<std::thread> threads;
+        for (unsigned i = 1; i < std::min(size_t(jobs), nchunks); ++i)
+            threads.emplace_back(worker);
+        worker();
+        for (auto& t : threads)
+            t.join();
+    }
+    if (imported)
+        return false;
+
+    At_Phrase cx{*op.body_->syntax_, f};
+    for (size_t c = 0; c < end_chunk; ++c) {
+        auto& chunk = chunks[c];
+        std::string out = chunk.sys_->console_.str();
+        if (!out.empty())
+            f.system_.console() << out << std::flush;
+        cache.hits_ += chunk.sys_->import_cache_.hits_;
+        if (!chunk.sys_->import_cache_.pending_.empty())
+            cache.depend(chunk.sys_->import_cache_.pending_.back());
+        if (chunk.error_)
+            std::rethrow_exception(chunk.error_);
+        for (size_t i = 0; i < chunk.values_.size(); ++i)
+            ex.push_value(chunk.values_[i], cx);
+        if (chunk.stopped_)
+            break;
+    }
+    return true;
+}
+
+} // namespace
+
 void
 For_Op::exec(Frame& f, Executor& ex) const
 {
     At_Phrase cx{*list_->syntax_, f};
-    At_Index icx{0, cx};
-    auto list = list_->eval(f).to<List>(cx);
-    for (size_t i = 0; i < list->size(); ++i) {
-        icx.index_ = i;
-        pattern_->exec(f.array_, list->at(i), icx, f);
-        if (cond_ && !cond_->eval(f).to_bool(At_Phrase{*cond_->syntax_,f}))
-            break;
-        body_->exec(f, ex);
-    }
+    Value listv = list_->eval(f);
+    if (!is_list(listv))
+        listv.to_abort(cx, List::name);
+    // Iterate over a Range_Value without materializing it.
+    visit_list(listv.to_ref_unsafe(), [&](const auto& list) {
+        unsigned jobs = f.system_.jobs_;
+        if (parallel_ && jobs > 1 && list.size() >= k_parallel_for_min
+            && !in_parallel_for && dynamic_cast<List_Executor*>(&ex))
+        {
+            listv.publish();
+            if (parallel_for(*this, f, list, ex, jobs))
+                return;
+        }
+        At_Index icx{0, cx};
+        for (size_t i = 0; i < list.size(); ++i) {
+            icx.index_ = i;
+            pattern_->exec(f.array_, list[i], icx, f);
+            if (cond_ && !cond_->eval(f).to_bool(At_Phrase{*cond_->syntax_,f}))
+                break;
+            body_->exec(f, ex);
+        }
+    });
 }
 
 Value
 Range_Expr::eval(Frame& f) const
 {
-    List_Builder lb;
     Value firstv = arg1_->eval(f);
     double first = firstv.to_num_or_nan();
 
@@ -879,9 +1150,8 @@ Range_Expr::eval(Frame& f) const
     // integer. It could be a float integer too large to increment (for large
     // float i, i==i+1). So we impose a limit on the count.
     if (countd < 1'000'000'000.0) {
-        unsigned count = (unsigned) countd;
-        for (unsigned i = 0; i < count; ++i)
-            lb.push_back(Value{first + step*i});
+        // The elements are computed on demand, see Range_Value.
+        return {make<Range_Value>(first, step, (size_t) countd)};
     } else {
         const char* err =
             (countd == countd ? "too many elements in range" : "domain error");
@@ -891,7 +1161,6 @@ Range_Expr::eval(Frame& f) const
                 ? stringify(firstv,dots,lastv," by ",stepv,": ", err)
                 : stringify(firstv,dots,lastv,": ", err));
     }
-    return {lb.get_list()};
 }
 
 Value
@@ -930,23 +1199,26 @@ void
 Bracket_Segment::generate(Frame& f, String_Builder& sb) const
 {
     At_Phrase cx(*expr_->syntax_, f);
-    auto list = expr_->eval(f).to<List>(cx);
-    for (size_t i = 0; i < list->size(); ++i)
-        sb << (char)(*list)[i].to_int(1, 127, At_Index(i,cx));
+    visit_list(expr_->eval(f), cx, [&](const auto& list) {
+        for (size_t i = 0; i < list.size(); ++i)
+            sb << (char)list[i].to_int(1, 127, At_Index(i,cx));
+    });
 }
 void
 Brace_Segment::generate(Frame& f, String_Builder& sb) const
 {
     At_Phrase cx(*expr_->syntax_, f);
-    auto list = expr_->eval(f).to<List>(cx);
-    for (auto val : *list) {
-        if (auto str = val.dycast<String_or_Symbol>())
-            sb << *str;
-        else if (val.is_bool())
-            sb << (val.to_bool_unsafe() ? "true" : "false");
-        else
-            sb << val;
-    }
+    visit_list(expr_->eval(f), cx, [&](const auto& list) {
+        for (size_t i = 0; i < list.size(); ++i) {
+            Value val = list[i];
+            if (auto str = val.dycast<String_or_Symbol>())
+                sb << *str;
+            else if (val.is_bool())
+                sb << (val.to_bool_unsafe() ? "true" : "false");
+            else
+                sb << val;
+        }
+    });
 }
 Value
 String_Expr_Base::eval(Frame& f) const
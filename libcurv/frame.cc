@@ -18,4 +18,84 @@ Frame_Base::Frame_Base(
     nonlocals_(nl)
 {}
 
+namespace {
+
+// Frame sizes are rounded up to a multiple of k_granule bytes. Frames larger
+// than k_max_pooled bytes are not pooled (they are rare: most functions have
+// a few slots). Each block is prefixed by a header recording its size class,
+// which is 0 for an unpooled block. The header is 16 bytes, to preserve the
+// alignment returned by malloc.
+constexpr size_t k_granule = 64;
+constexpr size_t k_max_pooled = 1024;
+constexpr size_t k_nclasses = k_max_pooled / k_granule;
+constexpr size_t k_header = 16;
+// Limit the memory held by an idle pool after a deep recursion.
+constexpr unsigned k_max_free = 256;
+
+struct Free_Block
+{
+    Free_Block* next_;
+};
+
+struct Frame_Pool
+{
+    Free_Block* free_[k_nclasses] = {};
+    unsigned nfree_[k_nclasses] = {};
+    // Set when the thread exits. Frames that outlive the pool (eg, owned by
+    // a static object) are then allocated and freed using malloc and free.
+    bool dead_ = false;
+
+    ~Frame_Pool()
+    {
+        for (auto b : free_) {
+            while (b != nullptr) {
+                auto next = b->next_;
+                free(b);
+                b = next;
+            }
+        }
+        dead_ = true;
+    }
+};
+
+thread_local Frame_Pool frame_pool;
+
+} // namespace
+
+void* Frame_Base::tail_alloc(size_t size) noexcept
+{
+    size_t cls = (size + k_granule - 1) / k_granule;
+    char* block;
+    if (cls > k_nclasses || frame_pool.dead_) {
+        cls = 0;
+        block = (char*) malloc(k_header + size);
+        if (block == nullptr) return nullptr;
+    } else if (auto b = frame_pool.free_[cls-1]) {
+        frame_pool.free_[cls-1] = b->next_;
+        --frame_pool.nfree_[cls-1];
+        block = (char*) b;
+    } else {
+        block = (char*) malloc(k_header + cls * k_granule);
+        if (block == nullptr) return nullptr;
+    }
+    *(size_t*)block = cls;
+    return block + k_header;
+}
+
+void Frame_Base::tail_free(void* p) noexcept
+{
+    char* block = (char*)p - k_header;
+    size_t cls = *(size_t*)block;
+    if (cls == 0 || frame_pool.dead_
+        || frame_pool.nfree_[cls-1] >= k_max_free)
+    {
+        free(block);
+        return;
+    }
+    auto b = (Free_Block*) block;
+    b->next_ = frame_pool.free_[cls-1];
+    frame_pool.free_[cls-1] = b;
+    ++frame_pool.nfree_[cls-1];
+}
+
 } // namespaces
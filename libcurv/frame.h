@@ -86,6 +86,12 @@ struct Frame_Base
     }
 
     Frame_Base(System&, Frame* parent, Shared<const Phrase>, Module*);
+
+    // Frame storage is recycled using a per-thread pool with one free list
+    // per size class, since a frame is allocated for each function call.
+    // These are called by Tail_Array; see Tail_Alloc.
+    static void* tail_alloc(size_t) noexcept;
+    static void tail_free(void*) noexcept;
 };
 
 Value tail_eval_frame(std::unique_ptr<Frame>);
@@ -87,10 +87,11 @@ Legacy_Function::call(Value arg, Frame& f)
         return call(f);
     }
     At_Arg cx(*this, f);
-    auto list = arg.to<const List>(cx);
-    list->assert_size(nargs_,cx);
-    for (size_t i = 0; i < list->size(); ++i)
-        f[i] = (*list)[i];
+    visit_list(arg, cx, [&](const auto& list) {
+        list.assert_size(nargs_,cx);
+        for (size_t i = 0; i < list.size(); ++i)
+            f[i] = list[i];
+    });
     return call(f);
 }
 
@@ -101,14 +102,16 @@ Legacy_Function::try_call(Value arg, Frame& f)
         f[0] = arg;
         return call(f);
     }
-    auto list = arg.dycast<const List>();
-    if (list && list->size() == nargs_) {
-        for (size_t i = 0; i < list->size(); ++i)
-            f[i] = (*list)[i];
-        return call(f);
-    } else {
+    if (!is_list(arg))
         return missing;
-    }
+    bool match = visit_list(arg.to_ref_unsafe(), [&](const auto& list) {
+        if (list.size() != nargs_)
+            return false;
+        for (size_t i = 0; i < list.size(); ++i)
+            f[i] = list[i];
+        return true;
+    });
+    return match ? call(f) : missing;
 }
 
 SC_Value
@@ -195,6 +198,13 @@ Closure::sc_call_expr(Operation& arg, Shared<const Phrase> cp, SC_Frame& f) cons
     return sc_eval_op(*f2, *expr_);
 }
 
+void
+Closure::publish_children() const
+{
+    // pattern_ and expr_ are compiled code, which is always published.
+    nonlocals_->publish();
+}
+
 void
 Lambda::print(std::ostream& out) const
 {
@@ -263,4 +273,11 @@ const
         "piecewise function is not supported");
 }
 
+void
+Piecewise_Function::publish_children() const
+{
+    for (auto& c : cases_)
+        c->publish();
+}
+
 } // namespace curv
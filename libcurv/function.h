@@ -65,6 +65,7 @@ struct Function : public Ref_Value
 
     static const char name[];
 };
+REF_TAG(Function, ty_function, ty_function);
 
 // Returns nullptr if argument is not a function.
 // If the Value is a record with a `call` field, then we cast the value
@@ -147,6 +148,7 @@ struct Lambda : public Ref_Value
     /// Print a value like a Curv expression.
     virtual void print(std::ostream&) const;
 };
+REF_TAG(Lambda, ty_lambda, ty_lambda);
 
 /// A user-defined function value,
 /// represented by a closure over a lambda expression.
@@ -188,6 +190,8 @@ struct Closure : public Function
 
     // generate a call to the function during geometry compilation
     virtual SC_Value sc_call_expr(Operation&, Shared<const Phrase>, SC_Frame&) const override;
+protected:
+    virtual void publish_children() const override;
 };
 
 struct Piecewise_Function : public Function
@@ -210,6 +214,8 @@ struct Piecewise_Function : public Function
 
     // generate a call to the function during geometry compilation
     virtual SC_Value sc_call_expr(Operation&, Shared<const Phrase>, SC_Frame&) const override;
+protected:
+    virtual void publish_children() const override;
 };
 
 } // namespace curv
@@ -10,10 +10,11 @@
 
 namespace curv { namespace geom {
 
-Compiled_Shape::Compiled_Shape(Shape_Program& rshape)
+Compiled_Shape::Compiled_Shape(Shape_Program& rshape, bool use_cache)
 :
     cpp_{rshape.system_}
 {
+    cpp_.use_cache_ = use_cache;
     is_2d_ = rshape.is_2d_;
     is_3d_ = rshape.is_3d_;
     bbox_ = rshape.bbox_;
@@ -27,6 +28,8 @@ Compiled_Shape::Compiled_Shape(Shape_Program& rshape)
     cpp_.compile(cx);
     dist_ = (Cpp_Dist_Func) cpp_.get_function("dist");
     colour_ = (Cpp_Colour_Func) cpp_.get_function("colour");
+    dist_batch_ = (Cpp_Batch_Func) cpp_.get_function("dist_batch");
+    colour_batch_ = (Cpp_Batch_Func) cpp_.get_function("colour_batch");
 }
 
 void
@@ -16,6 +16,9 @@ namespace curv { namespace geom {
 extern "C" {
     typedef void (*Cpp_Dist_Func)(const glm::vec4* in, float* out);
     typedef void (*Cpp_Colour_Func)(const glm::vec4* in, glm::vec3* out);
+    // Batched entry points, see Shape::dist_batch.
+    typedef void (*Cpp_Batch_Func)(
+        unsigned n, const float* const* in, float* const* out);
 }
 
 struct Compiled_Shape final : public Shape
@@ -23,8 +26,11 @@ struct Compiled_Shape final : public Shape
     Cpp_Program cpp_;
     Cpp_Dist_Func dist_;
     Cpp_Colour_Func colour_;
+    Cpp_Batch_Func dist_batch_;
+    Cpp_Batch_Func colour_batch_;
 
-    Compiled_Shape(Shape_Program&);
+    // If use_cache is true, use the persistent cache of compiled shapes.
+    Compiled_Shape(Shape_Program&, bool use_cache = true);
 
     virtual double dist(double x, double y, double z, double t) override
     {
@@ -40,6 +46,16 @@ struct Compiled_Shape final : public Shape
         colour_(&in, &out);
         return Vec3{out.x,out.y,out.z};
     }
+    virtual void dist_batch(
+        unsigned n, const float* const* in, float* const* out) override
+    {
+        dist_batch_(n, in, out);
+    }
+    virtual void colour_batch(
+        unsigned n, const float* const* in, float* const* out) override
+    {
+        colour_batch_(n, in, out);
+    }
 };
 
 void export_cpp(Shape_Program& shape, std::ostream& out);
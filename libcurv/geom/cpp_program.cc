@@ -4,6 +4,7 @@
 
 #include <libcurv/geom/cpp_program.h>
 
+#include <libcurv/geom/jit_cache.h>
 #include <libcurv/geom/tempfile.h>
 #include <libcurv/context.h>
 #include <libcurv/exception.h>
@@ -24,6 +25,12 @@ const char Cpp_Program::standard_header[] =
     "using namespace glm;\n"
     "\n";
 
+#if defined(__x86_64__) || defined(__i386__)
+static const char native_arch_flags[] = "-march=native";
+#else
+static const char native_arch_flags[] = "";
+#endif
+
 Cpp_Program::Cpp_Program(System& sys)
 :
     system_{sys},
@@ -50,20 +57,30 @@ Cpp_Program::compile(const Context& cx)
 {
     file_.close();
 
-    // compile C++ to optimized object code
-    auto cc_cmd = stringify("c++ -fpic -O3 -c ", path_.c_str());
-    //auto cc_cmd = stringify("c++ -fpic -c -g ", path_.c_str());
-    if (system(cc_cmd->c_str()) != 0) {
-        preserve_tempfile();
-        throw Exception(cx, stringify("c++ compile failed; see ", path_));
-    }
+    // The code runs on the machine that compiled it, so we can target the
+    // host CPU's vector instructions, for the benefit of the *_batch functions.
+    auto cc_cmd = stringify("c++ -fpic -O3 ", native_arch_flags, " -c ");
 
-    // create shared object
-    auto obj_name = register_tempfile(tempfile_id_,".o");
-    auto so_name = register_tempfile(tempfile_id_,".so");
-    auto link_cmd = stringify("c++ -shared -o ", so_name.c_str(), " ", obj_name.c_str());
-    if (system(link_cmd->c_str()) != 0)
-        throw Exception(cx, "c++ link failed");
+    // A cache hit skips the compile and link steps.
+    Jit_Cache cache(path_, cc_cmd->c_str(), use_cache_);
+    Filesystem::path so_name = cache.lookup();
+    if (so_name.empty()) {
+        // compile C++ to optimized object code
+        cc_cmd = stringify(cc_cmd->c_str(), path_.c_str());
+        //auto cc_cmd = stringify("c++ -fpic -c -g ", path_.c_str());
+        if (system(cc_cmd->c_str()) != 0) {
+            preserve_tempfile();
+            throw Exception(cx, stringify("c++ compile failed; see ", path_));
+        }
+
+        // create shared object
+        auto obj_name = register_tempfile(tempfile_id_,".o");
+        so_name = register_tempfile(tempfile_id_,".so");
+        auto link_cmd = stringify("c++ -shared -o ", so_name.c_str(), " ", obj_name.c_str());
+        if (system(link_cmd->c_str()) != 0)
+            throw Exception(cx, "c++ link failed");
+        cache.insert(so_name);
+    }
 
     // load shared object
     // TODO: so_name should contain a / character to prevent PATH search.
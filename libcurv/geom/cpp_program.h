@@ -22,6 +22,8 @@ struct Cpp_Program
     std::ofstream file_;
     SC_Compiler sc_;
     void* dll_ = nullptr;
+    // Use the persistent cache of compiled shared objects (see Jit_Cache).
+    bool use_cache_ = true;
 
     Cpp_Program(System&);
     ~Cpp_Program();
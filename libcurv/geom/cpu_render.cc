@@ -0,0 +1,398 @@
+// Copyright 2016-2019 Doug Moen
+// Licensed under the Apache License, version 2.0
+// See accompanying file LICENSE or https://www.apache.org/licenses/LICENSE-2.0
+
+#include <libcurv/geom/cpu_render.h>
+
+#include <libcurv/geom/vm_shape.h>
+#include <libcurv/shape.h>
+#include <libcurv/context.h>
+#include <libcurv/exception.h>
+
+#include <glm/common.hpp>
+#include <glm/exponential.hpp>
+#include <glm/geometric.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace curv { namespace geom {
+
+namespace {
+
+using glm::vec2;
+using glm::vec3;
+using glm::vec4;
+
+// The ray marcher and lighting model are transliterated from the GLSL code
+// in export_frag_3d, which is based on code by Inigo Quilez (MIT Licence).
+struct Pixel_Renderer
+{
+    Shape& shape_;
+    const Image_Export& opts_;
+    vec2 resolution_;
+    vec3 bg_;
+
+    // 2D view
+    float scale_;
+    vec2 offset_;
+
+    // 3D camera
+    vec3 eye_;
+    vec3 uu_, vv_, ww_;
+
+    Pixel_Renderer(Shape& shape, const Image_Export& opts)
+    :
+        shape_(shape),
+        opts_(opts),
+        resolution_(opts.size),
+        bg_(opts.bg_)
+    {
+        BBox bbox = shape.bbox_;
+        if (shape.is_2d_) {
+            if (bbox.empty2() || bbox.infinite2()) {
+                bbox.xmin = bbox.ymin = -10.0;
+                bbox.xmax = bbox.ymax = +10.0;
+            }
+            vec2 size(bbox.xmax - bbox.xmin, bbox.ymax - bbox.ymin);
+            vec2 scale2 = size / resolution_;
+            offset_ = vec2(bbox.xmin, bbox.ymin);
+            if (scale2.x > scale2.y) {
+                scale_ = scale2.x;
+                offset_.y -= (resolution_.y*scale_ - size.y)/2.0f;
+            } else {
+                scale_ = scale2.y;
+                offset_.x -= (resolution_.x*scale_ - size.x)/2.0f;
+            }
+        } else {
+            if (bbox.empty3() || bbox.infinite3()) {
+                bbox.xmin = bbox.ymin = bbox.zmin = -10.0;
+                bbox.xmax = bbox.ymax = bbox.zmax = +10.0;
+            }
+            vec3 bmin(bbox.xmin, bbox.ymin, bbox.zmin);
+            vec3 bmax(bbox.xmax, bbox.ymax, bbox.zmax);
+            vec3 origin = (bmin + bmax) / 2.0f;
+            vec3 radius = (bmax - bmin) / 2.0f;
+            float r = std::max(radius.x, std::max(radius.y, radius.z)) / 1.3f;
+            // The viewer's home position, converted from the OpenGL
+            // coordinate system to the Curv coordinate system.
+            eye_ = vec3(2.598076f, -4.5f, 3.0f)*r + origin;
+            vec3 centre = origin;
+            vec3 up = vec3(-0.25f, 0.433013f, 0.866025f);
+            ww_ = glm::normalize(centre - eye_);
+            uu_ = glm::normalize(glm::cross(ww_, up));
+            vv_ = glm::normalize(glm::cross(uu_, ww_));
+        }
+    }
+
+    float dist(vec3 p, float time)
+    {
+        return shape_.dist(p.x, p.y, p.z, time);
+    }
+    vec3 colour(vec3 p, float time)
+    {
+        return vec3(shape_.colour(p.x, p.y, p.z, time));
+    }
+
+    // Result is (t,r,g,b), where t is the distance marched, and r,g,b is the
+    // colour at the point we ended up at, or (-1,-1,-1) if nothing was hit.
+    vec4 cast_ray(vec3 ro, vec3 rd, float time)
+    {
+        float tmax = opts_.ray_max_depth_;
+        float t = 0.0f;
+        vec3 c(-1.0f, -1.0f, -1.0f);
+        for (int i = 0; i < opts_.ray_max_iter_; ++i) {
+            float precis = 0.0005f*t;
+            vec3 p = ro + rd*t;
+            float d = dist(p, time);
+            if (d < precis) {
+                c = colour(p, time);
+                break;
+            }
+            t += d;
+            if (t > tmax) break;
+        }
+        return vec4(t, c);
+    }
+
+    vec3 calc_normal(vec3 pos, float time)
+    {
+        vec2 e = vec2(1.0f,-1.0f)*0.5773f*0.0005f;
+        vec3 xyy(e.x, e.y, e.y), yyx(e.y, e.y, e.x),
+             yxy(e.y, e.x, e.y), xxx(e.x, e.x, e.x);
+        return glm::normalize(xyy*dist(pos + xyy, time) +
+                              yyx*dist(pos + yyx, time) +
+                              yxy*dist(pos + yxy, time) +
+                              xxx*dist(pos + xxx, time));
+    }
+
+    // Ambient occlusion factor: 0 means no other surfaces around the point,
+    // 1 means the point is occluded by other surfaces.
+    float calc_ao(vec3 pos, vec3 nor, float time)
+    {
+        float occ = 0.0f;
+        float sca = 1.0f;
+        for (int i = 0; i < 5; ++i) {
+            float hr = 0.01f + 0.12f*float(i)/4.0f;
+            vec3 aopos = nor * hr + pos;
+            float dd = dist(aopos, time);
+            occ += -(dd-hr)*sca;
+            sca *= 0.95f;
+        }
+        return glm::clamp(1.0f - 3.0f*occ, 0.0f, 1.0f);
+    }
+
+    // Lighting used by the standard and sf1 shaders.
+    vec3 lighting(vec3 pos, vec3 nor, vec3 rd, vec3 col, float occ)
+    {
+        vec3 ref = glm::reflect(rd, nor);
+        vec3 lig = glm::normalize(vec3(-0.4f, 0.6f, 0.7f));
+        float amb = glm::clamp(0.5f+0.5f*nor.z, 0.0f, 1.0f);
+        float dif = glm::clamp(glm::dot(nor, lig), 0.0f, 1.0f);
+        float bac = glm::clamp(
+            glm::dot(nor, glm::normalize(vec3(-lig.x,lig.y,0.0f))), 0.0f, 1.0f)
+            * glm::clamp(1.0f-pos.z, 0.0f, 1.0f);
+        float dom = glm::smoothstep(-0.1f, 0.1f, ref.z);
+        float fre = glm::pow(
+            glm::clamp(1.0f+glm::dot(nor,rd), 0.0f, 1.0f), 2.0f);
+        float spe = glm::pow(
+            glm::clamp(glm::dot(ref, lig), 0.0f, 1.0f), 16.0f);
+
+        vec3 lin = vec3(0.0f);
+        lin += 1.30f*dif*vec3(1.00f,0.80f,0.55f);
+        lin += 2.00f*spe*vec3(1.00f,0.90f,0.70f)*dif;
+        lin += 0.40f*amb*vec3(0.40f,0.60f,1.00f)*occ;
+        lin += 0.50f*dom*vec3(0.40f,0.60f,1.00f)*occ;
+        lin += 0.50f*bac*vec3(0.35f,0.35f,0.35f)*occ;
+        lin += 0.25f*fre*vec3(1.00f,1.00f,1.00f)*occ;
+        vec3 iqcol = col*lin;
+        return glm::mix(col, iqcol, 0.5f); // adjust contrast
+    }
+
+    // The pew shader, written by Philipp Emanuel Weidmann.
+    vec3 pew(vec3 point, vec3 normal, vec3 rd, vec3 color, float time)
+    {
+        struct Light { vec3 position, specular, diffuse, ambient; };
+        static const Light lights[3] = {
+            {vec3(-10.0f, -100.0f,  100.0f),
+                vec3(1.5f), vec3(1.5f), vec3(0.25f)},
+            {vec3(  0.0f,  100.0f,  100.0f),
+                vec3(2.0f), vec3(2.0f), vec3(0.25f)},
+            {vec3( 20.0f,  100.0f, -100.0f),
+                vec3(1.5f), vec3(1.5f), vec3(0.5f)},
+        };
+        const vec3 specular_reflectivity(1.5f);
+        const vec3 diffuse_reflectivity(1.2f);
+        const vec3 ambient_reflectivity(0.5f);
+        const vec3 shininess(15.0f);
+
+        vec3 viewer_direction = -rd;
+        vec3 illumination = vec3(0.0f);
+        for (auto& light : lights) {
+            illumination += ambient_reflectivity * light.ambient;
+            vec3 light_direction = glm::normalize(light.position - point);
+            vec4 result = cast_ray(point, light_direction, time);
+            if (result.y < 0.0f) {
+                // No part of the shape lies between the surface point
+                // and the light source.
+                vec3 reflection_direction =
+                    -glm::reflect(light_direction, normal);
+                float diffuse_term = glm::dot(light_direction, normal);
+                if (diffuse_term > 0.0f) {
+                    illumination +=
+                        diffuse_reflectivity * diffuse_term * light.diffuse;
+                    float specular_term =
+                        glm::dot(reflection_direction, viewer_direction);
+                    if (specular_term > 0.0f) {
+                        illumination +=
+                            specular_reflectivity
+                            * glm::pow(vec3(specular_term), shininess)
+                            * light.specular;
+                    }
+                }
+            }
+        }
+        return glm::mix(color,
+            glm::clamp(color*illumination, 0.0f, 1.0f), 0.5f);
+    }
+
+    vec3 render(vec3 ro, vec3 rd, float time)
+    {
+        vec4 res = cast_ray(ro, rd, time);
+        float t = res.x;
+        vec3 c(res.y, res.z, res.w);
+        if (c.x < 0.0f)
+            return glm::clamp(bg_, 0.0f, 1.0f);
+        vec3 pos = ro + t*rd;
+        vec3 nor = calc_normal(pos, time);
+        vec3 col;
+        switch (opts_.shader_) {
+        case Render_Opts::Shader::standard:
+            col = lighting(pos, nor, rd, c, calc_ao(pos, nor, time));
+            break;
+        case Render_Opts::Shader::sf1:
+            col = lighting(pos, nor, rd, c, 1.0f);
+            break;
+        case Render_Opts::Shader::pew:
+            return pew(pos, nor, rd, c, time);
+        }
+        return glm::clamp(col, 0.0f, 1.0f);
+    }
+
+    // Compute the colour of the pixel whose bottom left corner is (x,y).
+    vec3 pixel(int x, int y)
+    {
+        int aa = opts_.aa_;
+        int taa = opts_.taa_;
+        vec2 frag_coord(x + 0.5f, y + 0.5f);
+        vec3 col(0.0f);
+        for (int m = 0; m < aa; ++m)
+        for (int n = 0; n < aa; ++n) {
+            vec2 jitter = aa > 1
+                ? vec2(float(m),float(n)) / float(aa) - 0.5f
+                : vec2(0.0f);
+            vec2 xy = frag_coord + jitter;
+            vec3 p;
+            vec3 dir;
+            if (shape_.is_2d_)
+                p = vec3(xy*scale_ + offset_, 0.0f);
+            else {
+                vec2 s = -1.0f + 2.0f * xy / resolution_;
+                s.x *= resolution_.x/resolution_.y;
+                dir = glm::normalize(uu_*s.x + vv_*s.y + ww_*2.5f);
+            }
+            for (int t = 0; t < taa; ++t) {
+                float time = opts_.fstart_;
+                if (taa > 1)
+                    time += float(t)/float(taa)*float(opts_.fdur_);
+                if (shape_.is_2d_) {
+                    if (dist(p, time) > 0.0f)
+                        col += bg_;
+                    else
+                        col += colour(p, time);
+                } else
+                    col += render(eye_, dir, time);
+            }
+        }
+        col /= float(aa*aa*taa);
+        // convert linear RGB to sRGB
+        return glm::pow(col, vec3(0.454545454545454545f));
+    }
+};
+
+inline unsigned char
+to_byte(float c)
+{
+    return (unsigned char)(glm::clamp(c, 0.0f, 1.0f)*255.0f + 0.5f);
+}
+
+} // namespace
+
+void
+cpu_render(
+    const Shape_Program& prog,
+    const Image_Export& ix,
+    unsigned char* pixels)
+{
+    if (ix.shader_ == Render_Opts::Shader::sf1 && ix.sf1_ != nullptr) {
+        throw Exception(At_Program(prog),
+            "CPU renderer: custom sf1 shader functions are not supported");
+    }
+
+    // Compile the shape to VM code if possible, since that is faster.
+    std::unique_ptr<VM_Shape> vshape = nullptr;
+    try {
+        vshape = std::make_unique<VM_Shape>(prog);
+    } catch (Exception& e) {
+        if (ix.verbose_) {
+            std::cerr << e.what() << "\n"
+                << "CPU renderer: using the interpreter instead.\n";
+        }
+    }
+
+    constexpr int tile_size = 32;
+    int width = ix.size.x;
+    int height = ix.size.y;
+    int xtiles = (width + tile_size - 1) / tile_size;
+    int ytiles = (height + tile_size - 1) / tile_size;
+    int ntiles = xtiles * ytiles;
+    std::atomic<int> next_tile{0};
+
+    unsigned nthreads = std::thread::hardware_concurrency();
+    nthreads = std::max(1u, std::min(nthreads, unsigned(ntiles)));
+
+    // The interpreter mutates the shape's dist and colour frames, so each
+    // thread other than this one gets its own clone of the shape.
+    std::vector<Shape*> shapes;
+    std::vector<std::unique_ptr<Shape_Program>> clones;
+    if (vshape != nullptr)
+        shapes.assign(nthreads, vshape.get());
+    else {
+        shapes.push_back(const_cast<Shape_Program*>(&prog));
+        for (unsigned i = 1; i < nthreads; ++i) {
+            clones.push_back(prog.clone_for_thread());
+            shapes.push_back(clones.back().get());
+        }
+    }
+
+    // An evaluation error stops all of the threads, and the first error
+    // is rethrown once they have been joined.
+    std::exception_ptr error = nullptr;
+    std::mutex error_mutex;
+
+    auto worker = [&](Shape* shape) -> void {
+        Pixel_Renderer renderer(*shape, ix);
+        try {
+            for (;;) {
+                int tile = next_tile++;
+                if (tile >= ntiles) break;
+                int x0 = (tile % xtiles) * tile_size;
+                int y0 = (tile / xtiles) * tile_size;
+                int x1 = std::min(x0 + tile_size, width);
+                int y1 = std::min(y0 + tile_size, height);
+                for (int y = y0; y < y1; ++y) {
+                    for (int x = x0; x < x1; ++x) {
+                        vec3 col = renderer.pixel(x, y);
+                        unsigned char* pix = &pixels[(y * width + x) * 4];
+                        pix[0] = to_byte(col.r);
+                        pix[1] = to_byte(col.g);
+                        pix[2] = to_byte(col.b);
+                        pix[3] = 255;
+                    }
+                }
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (error == nullptr)
+                error = std::current_exception();
+            next_tile = ntiles;
+        }
+    };
+
+    {
+        Parallel_Section section;
+        std::vector<std::thread> threads;
+        for (unsigned i = 1; i < nthreads; ++i)
+            threads.emplace_back(worker, shapes[i]);
+        worker(shapes[0]);
+        for (auto& t : threads)
+            t.join();
+    }
+    if (error != nullptr)
+        std::rethrow_exception(error);
+
+    if (ix.verbose_) {
+        std::cerr << "CPU renderer: " << ntiles << " tiles, "
+            << nthreads << " threads\n";
+    }
+}
+
+}} // namespace
@@ -0,0 +1,27 @@
+// Copyright 2016-2019 Doug Moen
+// Licensed under the Apache License, version 2.0
+// See accompanying file LICENSE or https://www.apache.org/licenses/LICENSE-2.0
+
+#ifndef LIBCURV_GEOM_CPU_RENDER_H
+#define LIBCURV_GEOM_CPU_RENDER_H
+
+#include <libcurv/geom/png.h>
+
+namespace curv { namespace geom {
+
+// Render a shape on the CPU, without OpenGL, producing the same image as
+// the fragment shader generated by export_frag (standard, sf1 and pew
+// shaders, plus the aa, taa, bg, ray_max_iter and ray_max_depth options).
+//
+// The dist and colour functions are compiled to SubCurv VM code, and the
+// image is rendered in tiles, in parallel, using all of the CPU cores.
+// If the shape can't be compiled, it is rendered by the interpreter,
+// using a single thread.
+//
+// `pixels` has 4 bytes per pixel (RGBA), and the rows are ordered bottom
+// to top, like the output of glReadPixels.
+void cpu_render(const Shape_Program&, const Image_Export&,
+    unsigned char* pixels);
+
+}} // namespace
+#endif // header guard
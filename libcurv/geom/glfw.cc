@@ -35,4 +35,28 @@ bool opengl_init()
     return gladLoadGL() != 0;
 }
 
+bool opengl_available()
+{
+    static int available = -1;
+    if (available < 0) {
+        auto old_callback = glfwSetErrorCallback(nullptr);
+        available = 0;
+        if (glfwInit()) {
+            glfw_set_context_parameters();
+            glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+            GLFWwindow* window =
+                glfwCreateWindow(16, 16, "curv", nullptr, nullptr);
+            if (window) {
+                glfwMakeContextCurrent(window);
+                available = opengl_init();
+                glfwMakeContextCurrent(nullptr);
+                glfwDestroyWindow(window);
+            }
+            glfwDefaultWindowHints();
+        }
+        glfwSetErrorCallback(old_callback);
+    }
+    return available > 0;
+}
+
 }} // namespaces
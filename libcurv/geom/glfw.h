@@ -33,5 +33,10 @@ extern const char glsl_version[];
 // Returns true if the load succeeds.
 bool opengl_init();
 
+// Test if an OpenGL context can be created, by creating an invisible window.
+// This fails on a headless server with no GPU or display.
+// The result is cached.
+bool opengl_available();
+
 }} // namespaces
 #endif // header guard
@@ -0,0 +1,211 @@
+// Copyright 2016-2019 Doug Moen
+// Licensed under the Apache License, version 2.0
+// See accompanying file LICENSE or https://www.apache.org/licenses/LICENSE-2.0
+
+#include <libcurv/geom/jit_cache.h>
+
+#include <libcurv/progdir.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+extern "C" {
+#include <unistd.h>
+}
+
+namespace curv { namespace geom {
+
+namespace fs = Filesystem;
+
+static bool
+read_file(const fs::path& path, std::string& contents)
+{
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if (!in)
+        return false;
+    std::stringstream buf;
+    buf << in.rdbuf();
+    contents = buf.str();
+    return !in.bad();
+}
+
+// Run a shell command and return its standard output.
+static std::string
+command_output(const std::string& cmd)
+{
+    std::string result;
+    FILE* p = popen(cmd.c_str(), "r");
+    if (p == nullptr)
+        return result;
+    char buf[256];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), p)) > 0)
+        result.append(buf, n);
+    pclose(p);
+    return result;
+}
+
+// The output of `c++ --version`, which identifies the compiler.
+// Computed once per process.
+static const std::string&
+compiler_identity()
+{
+    static std::string id = command_output("c++ --version 2>/dev/null");
+    return id;
+}
+
+// The target options that the compile command resolves to. A command line
+// containing -march=native names a different instruction set on each CPU,
+// so we key on the resolved options instead: an object built for one CPU
+// must not be loaded from a shared or copied cache on another (SIGILL).
+// Uses the GCC option `-Q --help=target`; the result is empty if the
+// compiler doesn't support it. Memoized, since the command rarely varies.
+static std::string
+target_identity(const std::string& cmd)
+{
+    static std::mutex mutex;
+    static std::map<std::string, std::string> memo;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto i = memo.find(cmd);
+    if (i == memo.end()) {
+        i = memo.emplace(cmd,
+            command_output(cmd + " -Q --help=target 2>/dev/null")).first;
+    }
+    return i->second;
+}
+
+// 64 bit FNV-1a. Collisions are harmless, since lookup() compares sources.
+static std::uint64_t
+fnv1a(const std::string& str, std::uint64_t hash = 14695981039346656037ULL)
+{
+    for (unsigned char c : str) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+Jit_Cache::Jit_Cache(
+    const fs::path& cpp, const std::string& cmd, bool enable)
+{
+    if (!enable || !read_file(cpp, source_))
+        return;
+    std::string target = target_identity(cmd);
+    if (target.empty() && cmd.find("-march=native") != std::string::npos)
+        return;
+    dir_ = cache_dir("jit");
+    std::uint64_t hash = fnv1a(compiler_identity());
+    hash = fnv1a(cmd, hash);
+    hash = fnv1a(target, hash);
+    hash = fnv1a(source_, hash);
+    char buf[17];
+    snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)hash);
+    key_ = buf;
+}
+
+fs::path
+Jit_Cache::lookup()
+{
+    if (!enabled())
+        return fs::path();
+    fs::path so = dir_ / (key_ + ".so");
+    std::string cached_source;
+    boost::system::error_code ec;
+    if (!fs::exists(so, ec)
+        || !read_file(dir_ / (key_ + ".cpp"), cached_source)
+        || cached_source != source_)
+    {
+        return fs::path();
+    }
+    // Mark the entry as recently used, for eviction.
+    fs::last_write_time(so, std::time(nullptr), ec);
+    return so;
+}
+
+void
+Jit_Cache::insert(const fs::path& so)
+{
+    if (!enabled())
+        return;
+    // Write to temporary names, then rename, so that concurrent curv
+    // processes sharing the cache never see a partially written entry.
+    auto tmp = [&](const char* ext) -> fs::path {
+        std::ostringstream name;
+        name << key_ << ext << ".tmp" << getpid();
+        return dir_ / name.str();
+    };
+    boost::system::error_code ec;
+    fs::path tmp_cpp = tmp(".cpp");
+    {
+        std::ofstream out(tmp_cpp.c_str(), std::ios::binary);
+        out << source_;
+        if (!out) {
+            fs::remove(tmp_cpp, ec);
+            return;
+        }
+    }
+    fs::path tmp_so = tmp(".so");
+    fs::copy_file(so, tmp_so, fs::copy_options::overwrite_existing, ec);
+    if (ec) {
+        fs::remove(tmp_cpp, ec);
+        return;
+    }
+    fs::rename(tmp_cpp, dir_ / (key_ + ".cpp"), ec);
+    fs::rename(tmp_so, dir_ / (key_ + ".so"), ec);
+
+    // Evict the least recently used entries until we fit in max_size.
+    // Temporary files left behind by a crashed or killed process are
+    // deleted once they are older than tmp_max_age; newer ones may belong
+    // to a concurrent insert, so they are only counted toward the total.
+    struct Entry { std::time_t time; std::uintmax_t size; fs::path so; };
+    std::vector<Entry> entries;
+    std::uintmax_t total = 0;
+    std::time_t now = std::time(nullptr);
+    for (fs::directory_iterator i(dir_, ec), end; !ec && i != end;
+         i.increment(ec))
+    {
+        const fs::path& p = i->path();
+        boost::system::error_code ec2;
+        if (p.filename().string().find(".tmp") != std::string::npos) {
+            std::time_t time = fs::last_write_time(p, ec2);
+            if (ec2) continue;
+            if (now - time > tmp_max_age) {
+                fs::remove(p, ec2);
+            } else {
+                std::uintmax_t size = fs::file_size(p, ec2);
+                if (!ec2) total += size;
+            }
+            continue;
+        }
+        if (p.extension() != ".so")
+            continue;
+        std::uintmax_t size = 0;
+        for (auto& file : {p, fs::path(p).replace_extension(".cpp")}) {
+            std::uintmax_t fsize = fs::file_size(file, ec2);
+            if (!ec2) size += fsize;
+        }
+        std::time_t time = fs::last_write_time(p, ec2);
+        if (ec2) continue;
+        entries.push_back(Entry{time, size, p});
+        total += size;
+    }
+    std::sort(entries.begin(), entries.end(),
+        [](const Entry& a, const Entry& b) -> bool
+        { return a.time < b.time; });
+    for (auto& e : entries) {
+        if (total <= max_size)
+            break;
+        fs::remove(e.so, ec);
+        fs::remove(fs::path(e.so).replace_extension(".cpp"), ec);
+        total -= e.size;
+    }
+}
+
+}} // namespace
@@ -0,0 +1,55 @@
+// Copyright 2016-2019 Doug Moen
+// Licensed under the Apache License, version 2.0
+// See accompanying file LICENSE or https://www.apache.org/licenses/LICENSE-2.0
+
+#ifndef LIBCURV_GEOM_JIT_CACHE_H
+#define LIBCURV_GEOM_JIT_CACHE_H
+
+#include <libcurv/filesystem.h>
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+namespace curv { namespace geom {
+
+// A persistent cache of shared objects built by Cpp_Program, stored in
+// $XDG_CACHE_HOME/curv/jit (or ~/.cache/curv/jit). An entry is keyed by a
+// hash of the C++ source code, the compiler identity, the compiler
+// command line and the target options it resolves to (see -march=native).
+// Each entry is a pair of files, <key>.cpp and <key>.so. The source is
+// stored so that a lookup can verify an exact match.
+//
+// Cache failures are never fatal: if the cache directory can't be
+// created or written, we just compile without caching.
+struct Jit_Cache
+{
+    // The cache is trimmed to this size (in bytes) after each insertion,
+    // by deleting the least recently used entries.
+    static constexpr std::uintmax_t max_size = 256 * 1024 * 1024;
+
+    // Temporary files written by insert() that are older than this (in
+    // seconds) were abandoned by a process that died, and are deleted.
+    static constexpr std::time_t tmp_max_age = 10 * 60;
+
+    Filesystem::path dir_;
+    std::string key_;
+    std::string source_;
+
+    // `cpp` is the C++ source file, and `cmd` is the compile command, minus
+    // the source file name. If `enable` is false, or if `cmd` targets the
+    // native CPU and we can't tell which CPU that is, the cache is not used.
+    Jit_Cache(const Filesystem::path& cpp, const std::string& cmd, bool enable);
+
+    // Return true if the cache directory is available.
+    bool enabled() const { return !dir_.empty(); }
+
+    // On a cache hit, return the path of the shared object,
+    // otherwise return an empty path.
+    Filesystem::path lookup();
+
+    // Copy a newly built shared object into the cache, then evict old entries.
+    void insert(const Filesystem::path& so);
+};
+
+}} // namespace
+#endif // include guard
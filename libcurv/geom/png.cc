@@ -4,6 +4,8 @@
 
 #include <libcurv/geom/png.h>
 
+#include <libcurv/geom/cpu_render.h>
+#include <libcurv/geom/glfw.h>
 #include <libcurv/shape.h>
 #include <libcurv/viewer/viewer.h>
 #include <libcurv/context.h>
@@ -69,6 +71,23 @@ export_png(
     };
     (void) origin; // TODO
 
+    if (p.renderer_ == Image_Export::Renderer::cpu || !opengl_available()) {
+        if (p.verbose_ && p.renderer_ != Image_Export::Renderer::cpu)
+            std::cerr << "OpenGL not available, using the CPU renderer.\n";
+        auto start_time = std::chrono::steady_clock::now();
+        std::unique_ptr<unsigned char[]>
+            pixels(new unsigned char[p.size.x*p.size.y*4]);
+        cpu_render(shape, p, pixels.get());
+        auto end_time = std::chrono::steady_clock::now();
+        if (p.verbose_) {
+            std::chrono::duration<double> render_time = end_time - start_time;
+            std::cerr << "image render time: " << render_time.count() << "s\n";
+        }
+        write_png_rgb(ofile.path().c_str(), pixels.get(), p.size.x, p.size.y,
+            ofile.system_);
+        return;
+    }
+
     Render_Opts opts{ p };
     /*
     opts.aa_ = p.aa_;
@@ -22,6 +22,10 @@ struct Image_Export : public Render_Opts
     double pixel_size;  // Size of a square pixel, in shape space.
     double fstart_ = 0.0;  // Frame start time, in seconds, for animations.
     bool verbose_ = false;
+    // The GPU renderer falls back to the CPU renderer if OpenGL is not
+    // available (eg, on a headless server without a GPU).
+    enum class Renderer { gpu, cpu };
+    Renderer renderer_ = Renderer::gpu;
 };
 
 void export_png(const Shape_Program&, const Image_Export&, Output_File&);
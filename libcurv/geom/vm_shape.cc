@@ -0,0 +1,30 @@
+// Copyright 2016-2019 Doug Moen
+// Licensed under the Apache License, version 2.0
+// See accompanying file LICENSE or https://www.apache.org/licenses/LICENSE-2.0
+
+#include <libcurv/geom/vm_shape.h>
+
+#include <libcurv/context.h>
+#include <libcurv/function.h>
+#include <libcurv/system.h>
+
+namespace curv { namespace geom {
+
+VM_Shape::VM_Shape(const Shape_Program& rshape)
+:
+    dist_{rshape.system_},
+    colour_{rshape.system_}
+{
+    is_2d_ = rshape.is_2d_;
+    is_3d_ = rshape.is_3d_;
+    bbox_ = rshape.bbox_;
+
+    At_System cx{rshape.system_};
+
+    dist_.define_function(SC_Type::Vec(4), SC_Type::Num(),
+        rshape.dist_fun_, cx);
+    colour_.define_function(SC_Type::Vec(4), SC_Type::Vec(3),
+        rshape.colour_fun_, cx);
+}
+
+}} // namespace
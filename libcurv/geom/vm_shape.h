@@ -0,0 +1,41 @@
+// Copyright 2016-2019 Doug Moen
+// Licensed under the Apache License, version 2.0
+// See accompanying file LICENSE or https://www.apache.org/licenses/LICENSE-2.0
+
+#ifndef LIBCURV_GEOM_VM_SHAPE_H
+#define LIBCURV_GEOM_VM_SHAPE_H
+
+#include <libcurv/sc_vm.h>
+#include <libcurv/shape.h>
+
+namespace curv { namespace geom {
+
+// A shape whose dist and colour functions are compiled to SubCurv VM code.
+// This is much faster than the interpreter, and unlike Compiled_Shape,
+// it doesn't need a C++ compiler. Throws an Exception if the shape uses
+// features that the VM doesn't support.
+struct VM_Shape final : public Shape
+{
+    SC_VM dist_;
+    SC_VM colour_;
+
+    VM_Shape(const Shape_Program&);
+
+    virtual double dist(double x, double y, double z, double t) override
+    {
+        float in[4] = {float(x), float(y), float(z), float(t)};
+        float out;
+        dist_.call(in, &out);
+        return out;
+    }
+    virtual Vec3 colour(double x, double y, double z, double t) override
+    {
+        float in[4] = {float(x), float(y), float(z), float(t)};
+        float out[3];
+        colour_.call(in, out);
+        return Vec3{out[0], out[1], out[2]};
+    }
+};
+
+}} // namespace
+#endif // include guard
@@ -9,7 +9,11 @@
 #include <libcurv/exception.h>
 #include <libcurv/program.h>
 #include <libcurv/system.h>
+#include <algorithm>
 #include <cstdlib>
+extern "C" {
+#include <sys/stat.h>
+}
 
 namespace curv {
 
@@ -31,9 +35,11 @@ Value import(const Filesystem::path& path, const Context& cx)
 
     // Import file based on extension
     auto importp = sys.importers_.find(ext);
-    if (importp != sys.importers_.end())
+    if (importp != sys.importers_.end()) {
+        if (importp->second != curv_import)
+            sys.import_cache_.depend(File_Stamp::get(path));
         return (*importp->second)(path, cx);
-    else {
+    } else {
         // If extension not recognized, it defaults to a Curv program.
         return curv_import(path, cx);
     }
@@ -42,22 +48,164 @@ Value import(const Filesystem::path& path, const Context& cx)
 Value curv_import(const Filesystem::path& path, const Context& cx)
 {
     System& sys{cx.system()};
+    auto& cache = sys.import_cache_;
+    auto& active_files = sys.active_files_;
+
+    // If the file is in the cache, and it hasn't changed, then we're done.
+    // If the path can't be canonicalized, File_Source reports the error.
+    boost::system::error_code errcode;
+    auto filekey = Filesystem::canonical(path, errcode);
+    if (!errcode && active_files.find(filekey) == active_files.end()) {
+        if (auto entry = cache.find(filekey)) {
+            ++cache.hits_;
+            cache.depend(entry->deps_);
+            return entry->value_;
+        }
+    }
+    cache.miss(cx);
+
+    // The stamp is taken before the file is read, so that a change made
+    // while the file is being evaluated invalidates the new cache entry.
+    auto stamp = File_Stamp::get(path);
     auto source = make<File_Source>(make_string(path.c_str()), cx);
     Program prog{std::move(source), sys,
         Program_Opts().file_frame(cx.frame())};
-    auto filekey = Filesystem::canonical(path);
-    auto& active_files = sys.active_files_;
+    filekey = Filesystem::canonical(path);
     if (active_files.find(filekey) != active_files.end())
         throw Exception{cx,
             stringify("illegal recursive reference to file ",path)};
-    Active_File af(active_files, filekey);
-    prog.compile();
-    return prog.eval();
+    Value value;
+    std::shared_ptr<Import_Deps> deps;
+    {
+        Active_File af(active_files, filekey);
+        Pending_Import pi(cache);
+        pi.deps_->add(stamp);
+        prog.compile();
+        value = prog.eval();
+        deps = pi.deps_;
+    }
+    cache.depend(deps);
+    cache.entries_[filekey] = Import_Cache::Entry{value, std::move(deps)};
+    return value;
 }
 
 Value dir_import(const Filesystem::path& dir, const Context& cx)
 {
+    // Adding or removing a file changes the directory's modification time.
+    // Changes to the files inside it are tracked by the Dir_Record,
+    // as it imports them.
+    cx.system().import_cache_.depend(File_Stamp::get(dir));
     return {make<Dir_Record>(dir, cx)};
 }
 
+File_Stamp File_Stamp::get(const Filesystem::path& path)
+{
+    File_Stamp stamp;
+    stamp.path_ = path;
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0) {
+#if __APPLE__
+        const struct timespec& mtime = st.st_mtimespec;
+#else
+        const struct timespec& mtime = st.st_mtim;
+#endif
+        stamp.mtime_ = std::int64_t(mtime.tv_sec) * 1000000000 + mtime.tv_nsec;
+        stamp.size_ = st.st_size;
+    }
+    return stamp;
+}
+
+bool File_Stamp::is_current() const
+{
+    auto now = get(path_);
+    return mtime_ != -1 && now.mtime_ == mtime_ && now.size_ == size_;
+}
+
+void Import_Deps::add(const File_Stamp& stamp)
+{
+    // A file that is imported many times is only checked once.
+    for (auto& f : files_) {
+        if (f.path_ == stamp.path_)
+            return;
+    }
+    files_.push_back(stamp);
+}
+
+void Import_Deps::add(std::shared_ptr<Import_Deps> deps)
+{
+    if (deps.get() == this)
+        return;
+    for (auto& d : imports_) {
+        if (d == deps)
+            return;
+    }
+    imports_.push_back(std::move(deps));
+}
+
+bool Import_Deps::is_current() const
+{
+    std::vector<const Import_Deps*> seen;
+    return is_current(seen);
+}
+
+// The graph of imports may be shared, and may even contain a cycle,
+// if a Dir_Record member imports the file that created the Dir_Record.
+bool Import_Deps::is_current(std::vector<const Import_Deps*>& seen) const
+{
+    if (std::find(seen.begin(), seen.end(), this) != seen.end())
+        return true;
+    seen.push_back(this);
+    for (auto& f : files_) {
+        if (!f.is_current())
+            return false;
+    }
+    for (auto& d : imports_) {
+        if (!d->is_current(seen))
+            return false;
+    }
+    return true;
+}
+
+auto Import_Cache::find(const Filesystem::path& file)
+-> const Entry*
+{
+    auto e = entries_.find(file);
+    if (e == entries_.end())
+        return nullptr;
+    if (!parallel_ && !e->second.deps_->is_current()) {
+        entries_.erase(e);
+        return nullptr;
+    }
+    return &e->second;
+}
+
+void Import_Cache::prune()
+{
+    for (auto e = entries_.begin(); e != entries_.end(); ) {
+        if (e->second.deps_->is_current())
+            ++e;
+        else
+            e = entries_.erase(e);
+    }
+}
+
+void Import_Cache::miss(const Context& cx)
+{
+    ++misses_;
+    if (parallel_)
+        throw Exception(cx, "file import in a parallel loop");
+}
+
+void Import_Cache::depend(const File_Stamp& stamp)
+{
+    if (!pending_.empty())
+        pending_.back()->add(stamp);
+}
+
+void Import_Cache::depend(std::shared_ptr<Import_Deps> deps)
+{
+    if (!pending_.empty())
+        pending_.back()->add(std::move(deps));
+}
+
 }
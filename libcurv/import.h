@@ -6,7 +6,9 @@
 #define LIBCURV_IMPORT_H
 
 #include <libcurv/filesystem.h>
+#include <libcurv/system.h>
 #include <libcurv/value.h>
+#include <memory>
 
 namespace curv {
 
@@ -25,5 +27,24 @@ Value curv_import(const Filesystem::path& path, const Context& cx);
 // Import a directory as a record value, using "directory syntax".
 Value dir_import(const Filesystem::path&, const Context&);
 
+// RAII helper class, for use with Import_Cache::pending_. The files imported
+// while a Pending_Import is in scope are recorded in `deps_`.
+struct Pending_Import
+{
+    Import_Cache& cache_;
+    std::shared_ptr<Import_Deps> deps_;
+    Pending_Import(Import_Cache& cache)
+    :
+        cache_(cache),
+        deps_(std::make_shared<Import_Deps>())
+    {
+        cache_.pending_.push_back(deps_);
+    }
+    ~Pending_Import()
+    {
+        cache_.pending_.pop_back();
+    }
+};
+
 }
 #endif
@@ -68,15 +68,14 @@ void write_json_value(Value val, std::ostream& out)
       }
     case Ref_Value::ty_list:
       {
-        auto& list = (List&)ref;
-        out << "[";
-        bool first = true;
-        for (auto e : list) {
-            if (!first) out << ",";
-            first = false;
-            write_json_value(e, out);
-        }
-        out << "]";
+        visit_list(ref, [&](const auto& list) {
+            out << "[";
+            for (size_t i = 0; i < list.size(); ++i) {
+                if (i > 0) out << ",";
+                write_json_value(list[i], out);
+            }
+            out << "]";
+        });
         return;
       }
     case Ref_Value::ty_record:
@@ -0,0 +1,513 @@
+// Copyright 2016-2019 Doug Moen
+// Licensed under the Apache License, version 2.0
+// See accompanying file LICENSE or https://www.apache.org/licenses/LICENSE-2.0
+
+#include <libcurv/library.h>
+
+#include <libcurv/context.h>
+#include <libcurv/exception.h>
+#include <libcurv/meaning.h>
+#include <libcurv/parser.h>
+#include <libcurv/phrase.h>
+#include <libcurv/progdir.h>
+#include <libcurv/program.h>
+#include <libcurv/scanner.h>
+#include <libcurv/system.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <sstream>
+
+extern "C" {
+#include <unistd.h>
+}
+
+namespace curv {
+
+namespace fs = Filesystem;
+
+namespace {
+
+// 64 bit FNV-1a.
+std::uint64_t
+fnv1a(const char* p, const char* end, std::uint64_t hash)
+{
+    for (; p < end; ++p) {
+        hash ^= (unsigned char)*p;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+std::uint64_t
+source_hash(const Source& src)
+{
+    std::uint64_t hash = 14695981039346656037ULL;
+    hash ^= Library_Index::version;
+    hash *= 1099511628211ULL;
+    return fnv1a(src.begin(), src.end(), hash);
+}
+
+// Call `f` on each identifier token in the byte range [first,last) of `src`.
+// The range begins and ends outside of any string literal. Like the parser,
+// we scan the contents of `$(...)`, `$[...]` and `${...}` in a string literal
+// as ordinary tokens.
+void
+for_each_identifier(
+    const Source& src, System& sys, unsigned first, unsigned last,
+    std::function<void(Symbol_Ref)> f)
+{
+    Scanner scanner(share(src), sys, Scanner_Opts().skip_prefix(first));
+    // For each open bracket, the string literal state to restore at
+    // the matching close bracket.
+    std::vector<Token> string_states;
+    for (;;) {
+        Token tok = scanner.get_token();
+        if (tok.kind_ == Token::k_end || tok.first_ >= last)
+            break;
+        switch (tok.kind_) {
+        case Token::k_dollar_ident:
+            ++tok.first_;
+            // fall through
+        case Token::k_ident:
+            f(token_to_symbol(Range<const char*>(
+                src.begin() + tok.first_, src.begin() + tok.last_)));
+            break;
+        case Token::k_dollar_paren:
+        case Token::k_dollar_bracket:
+        case Token::k_dollar_brace:
+            string_states.push_back(scanner.string_begin_);
+            scanner.string_begin_.kind_ = Token::k_missing;
+            break;
+        case Token::k_lparen:
+        case Token::k_lbracket:
+        case Token::k_lbrace:
+            string_states.push_back(Token());
+            break;
+        case Token::k_rparen:
+        case Token::k_rbracket:
+        case Token::k_rbrace:
+            if (!string_states.empty()) {
+                scanner.string_begin_ = string_states.back();
+                string_states.pop_back();
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+// Return the name defined by a definition phrase, or nullptr if it isn't
+// `name = ...` or a function definition like `name x y = ...`.
+const Identifier*
+definition_name(const Phrase& ph)
+{
+    auto def = dynamic_cast<const Recursive_Definition_Phrase*>(&ph);
+    if (def == nullptr)
+        return nullptr;
+    const Phrase* left = &*def->left_;
+    while (auto call = dynamic_cast<const Call_Phrase*>(left)) {
+        if (call->op_.kind_ != Token::k_missing)
+            return nullptr;
+        left = &*call->function_;
+    }
+    return dynamic_cast<const Identifier*>(left);
+}
+
+void
+put_u32(std::string& out, std::uint32_t n)
+{
+    out.append((const char*)&n, sizeof(n));
+}
+
+void
+put_u64(std::string& out, std::uint64_t n)
+{
+    out.append((const char*)&n, sizeof(n));
+}
+
+// Reads a serialized index, checking for truncation.
+struct Reader
+{
+    const std::string& data_;
+    size_t pos_ = 0;
+    bool ok_ = true;
+
+    Reader(const std::string& data) : data_(data) {}
+
+    template <class T> T get()
+    {
+        T n = 0;
+        if (pos_ + sizeof(T) > data_.size())
+            ok_ = false;
+        else {
+            memcpy(&n, data_.data() + pos_, sizeof(T));
+            pos_ += sizeof(T);
+        }
+        return n;
+    }
+    std::string get_string(std::uint32_t len)
+    {
+        if (pos_ + len > data_.size()) {
+            ok_ = false;
+            return {};
+        }
+        std::string s = data_.substr(pos_, len);
+        pos_ += len;
+        return s;
+    }
+};
+
+const char magic[8] = {'C','u','r','v','L','i','b','X'};
+
+// A view of a library's source text that ends at the end of a group.
+// Scanning starts at the beginning of the group, so locations in error
+// messages refer to the original source file.
+struct Group_Source : public Source
+{
+    Shared<const String> text_;
+
+    Group_Source(Shared<const String> name, Shared<const String> text, unsigned size)
+    :
+        Source(std::move(name), text->data(), text->data() + size),
+        text_(std::move(text))
+    {
+        text_->publish();
+    }
+};
+
+struct Library_Builtin : public Builtin
+{
+    Library& library_;
+    unsigned index_;
+    Library_Builtin(Library& lib, unsigned i) : library_(lib), index_(i) {}
+    virtual Shared<Meaning> to_meaning(const Identifier& id) const override
+    {
+        return make<Constant>(share(id), library_.value(index_));
+    }
+};
+
+} // namespace
+
+std::unique_ptr<Library_Index>
+Library_Index::make(const Source& src, System& sys)
+{
+    std::unique_ptr<Library_Index> index{new Library_Index()};
+    index->hash_ = source_hash(src);
+    index->size_ = src.size();
+
+    Scanner scanner(share(src), sys);
+    auto program = parse_program(scanner);
+    auto braces = cast<const Brace_Phrase>(program->body_);
+    if (braces == nullptr)
+        return index;
+    std::vector<Separator_Phrase::Arg> items;
+    if (auto semis = cast<const Semicolon_Phrase>(braces->body_))
+        items = semis->args_;
+    else
+        items.emplace_back(braces->body_, Token());
+
+    // Find the names and byte ranges of the definitions.
+    std::vector<Span> defs;
+    Symbol_Map<unsigned> def_of_name;
+    for (auto& item : items) {
+        if (cast<const Empty_Phrase>(item.expr_))
+            continue;
+        auto name = definition_name(*item.expr_);
+        if (name == nullptr || def_of_name.count(name->symbol_)) {
+            index->names_.clear();
+            return index;
+        }
+        Token tok = item.expr_->location().token();
+        Span r{tok.first_, tok.last_};
+        if (item.separator_.kind_ != Token::k_missing)
+            r.last_ = item.separator_.last_;
+        def_of_name[name->symbol_] = defs.size();
+        index->names_.push_back(Name{
+            std::string(name->symbol_.c_str(), name->symbol_.size()), 0});
+        defs.push_back(r);
+    }
+
+    // The references from each definition to other definitions.
+    // Any identifier that is spelled the same as a definition counts, even if
+    // it is a local variable or a field name, which only makes a group larger.
+    std::vector<std::vector<unsigned>> refs(defs.size());
+    for (unsigned d = 0; d < defs.size(); ++d) {
+        for_each_identifier(src, sys, defs[d].first_, defs[d].last_,
+            [&](Symbol_Ref sym) -> void {
+                auto i = def_of_name.find(sym);
+                if (i != def_of_name.end())
+                    refs[d].push_back(i->second);
+            });
+    }
+
+    // Tarjan's algorithm for strongly connected components.
+    const unsigned unvisited = ~0u;
+    std::vector<unsigned> order(defs.size(), unvisited);
+    std::vector<unsigned> low(defs.size(), 0);
+    std::vector<bool> on_stack(defs.size(), false);
+    std::vector<unsigned> stack;
+    unsigned counter = 0;
+    std::function<void(unsigned)> visit = [&](unsigned d) -> void {
+        order[d] = low[d] = counter++;
+        stack.push_back(d);
+        on_stack[d] = true;
+        for (unsigned r : refs[d]) {
+            if (order[r] == unvisited) {
+                visit(r);
+                low[d] = std::min(low[d], low[r]);
+            } else if (on_stack[r])
+                low[d] = std::min(low[d], order[r]);
+        }
+        if (low[d] == order[d]) {
+            Group group;
+            unsigned g = index->groups_.size();
+            unsigned member;
+            do {
+                member = stack.back();
+                stack.pop_back();
+                on_stack[member] = false;
+                group.defs_.push_back(defs[member]);
+                index->names_[member].group_ = g;
+            } while (member != d);
+            std::sort(group.defs_.begin(), group.defs_.end(),
+                [](const Span& a, const Span& b) -> bool
+                { return a.first_ < b.first_; });
+            index->groups_.push_back(std::move(group));
+        }
+    };
+    for (unsigned d = 0; d < defs.size(); ++d)
+        if (order[d] == unvisited)
+            visit(d);
+
+    index->lazy_ = true;
+    return index;
+}
+
+std::string
+Library_Index::serialize() const
+{
+    std::string out(magic, sizeof(magic));
+    put_u32(out, version);
+    put_u64(out, hash_);
+    put_u64(out, size_);
+    put_u32(out, lazy_);
+    put_u32(out, groups_.size());
+    for (auto& g : groups_) {
+        put_u32(out, g.defs_.size());
+        for (auto& r : g.defs_) {
+            put_u32(out, r.first_);
+            put_u32(out, r.last_);
+        }
+    }
+    put_u32(out, names_.size());
+    for (auto& n : names_) {
+        put_u32(out, n.group_);
+        put_u32(out, n.name_.size());
+        out += n.name_;
+    }
+    return out;
+}
+
+std::unique_ptr<Library_Index>
+Library_Index::deserialize(const std::string& data)
+{
+    if (data.size() < sizeof(magic)
+        || memcmp(data.data(), magic, sizeof(magic)) != 0)
+    {
+        return nullptr;
+    }
+    Reader in(data);
+    in.pos_ = sizeof(magic);
+    if (in.get<std::uint32_t>() != version)
+        return nullptr;
+    std::unique_ptr<Library_Index> index{new Library_Index()};
+    index->hash_ = in.get<std::uint64_t>();
+    index->size_ = in.get<std::uint64_t>();
+    index->lazy_ = in.get<std::uint32_t>() != 0;
+    std::uint32_t ngroups = in.get<std::uint32_t>();
+    for (std::uint32_t g = 0; in.ok_ && g < ngroups; ++g) {
+        Group group;
+        std::uint32_t ndefs = in.get<std::uint32_t>();
+        for (std::uint32_t d = 0; in.ok_ && d < ndefs; ++d) {
+            Span r;
+            r.first_ = in.get<std::uint32_t>();
+            r.last_ = in.get<std::uint32_t>();
+            if (r.first_ > r.last_ || r.last_ > index->size_)
+                return nullptr;
+            group.defs_.push_back(r);
+        }
+        if (group.defs_.empty())
+            return nullptr;
+        index->groups_.push_back(std::move(group));
+    }
+    std::uint32_t nnames = in.get<std::uint32_t>();
+    for (std::uint32_t i = 0; in.ok_ && i < nnames; ++i) {
+        Name n;
+        n.group_ = in.get<std::uint32_t>();
+        n.name_ = in.get_string(in.get<std::uint32_t>());
+        if (n.group_ >= ngroups)
+            return nullptr;
+        index->names_.push_back(std::move(n));
+    }
+    if (!in.ok_ || in.pos_ != data.size())
+        return nullptr;
+    return index;
+}
+
+std::unique_ptr<Library_Index>
+Library_Index::get(const Source& src, System& sys, bool& cached)
+{
+    cached = false;
+    fs::path dir = cache_dir("lib");
+    fs::path file;
+    std::uint64_t hash = source_hash(src);
+    if (!dir.empty()) {
+        char key[17];
+        snprintf(key, sizeof(key), "%016llx", (unsigned long long)hash);
+        file = dir / (std::string(key) + ".idx");
+        std::ifstream in(file.c_str(), std::ios::binary);
+        if (in) {
+            std::stringstream buf;
+            buf << in.rdbuf();
+            auto index = deserialize(buf.str());
+            if (index && index->hash_ == hash && index->size_ == src.size()) {
+                cached = true;
+                return index;
+            }
+        }
+    }
+
+    // The index is missing or stale, so rebuild it from the source.
+    auto index = make(src, sys);
+    if (!file.empty()) {
+        // Write to a temporary name, then rename, so that concurrent curv
+        // processes never see a partially written index.
+        std::ostringstream tmpname;
+        tmpname << file.string() << ".tmp" << getpid();
+        fs::path tmp = tmpname.str();
+        boost::system::error_code ec;
+        {
+            std::ofstream out(tmp.c_str(), std::ios::binary);
+            out << index->serialize();
+            if (!out) {
+                fs::remove(tmp, ec);
+                return index;
+            }
+        }
+        fs::rename(tmp, file, ec);
+        if (ec)
+            fs::remove(tmp, ec);
+    }
+    return index;
+}
+
+Library::Library(
+    Shared<const String_Source> source,
+    System& sys,
+    std::unique_ptr<Library_Index> index,
+    Namespace& names)
+:
+    source_(std::move(source)),
+    system_(sys),
+    index_(std::move(index)),
+    names_(names),
+    values_(index_->names_.size()),
+    busy_(index_->groups_.size(), false)
+{
+    for (unsigned i = 0; i < index_->names_.size(); ++i) {
+        auto sym = make_symbol(index_->names_[i].name_);
+        symbols_.push_back(sym);
+        auto b = make<Library_Builtin>(*this, i);
+        names_[sym] = b;
+        names[sym] = b;
+    }
+    system_.library_stats_.groups_ += index_->groups_.size();
+}
+
+Value
+Library::value(unsigned i)
+{
+    // A library definition may be referenced for the first time by a program
+    // that is compiled while a list comprehension is being evaluated on
+    // several threads.
+    static std::recursive_mutex mutex;
+    std::lock_guard<std::recursive_mutex> lock(mutex);
+    if (values_[i].is_missing())
+        load_group(index_->names_[i].group_);
+    return values_[i];
+}
+
+void
+Library::load_group(unsigned g)
+{
+    auto& defs = index_->groups_[g].defs_;
+    if (busy_[g]) {
+        // The index doesn't match the source.
+        throw Exception(At_System(system_), stringify(
+            source_->name_, ": library index is inconsistent"));
+    }
+    busy_[g] = true;
+    struct Busy {
+        std::vector<bool>& busy_; unsigned g_;
+        ~Busy() { busy_[g_] = false; }
+    } busy{busy_, g};
+
+    // Nested group loads are included in the time of the outermost one.
+    static unsigned depth = 0;
+    ++depth;
+    auto start = std::chrono::steady_clock::now();
+    struct Timer {
+        Library_Stats& stats_;
+        std::chrono::steady_clock::time_point start_;
+        ~Timer() {
+            if (--depth == 0) {
+                std::chrono::duration<double> t =
+                    std::chrono::steady_clock::now() - start_;
+                stats_.load_seconds_ += t.count();
+            }
+        }
+    } timer{system_.library_stats_, start};
+
+    // The source of the group begins at its first definition, and ends at
+    // its last definition. Definitions in between that belong to other
+    // groups are blanked out, preserving line breaks.
+    unsigned first = defs.front().first_;
+    unsigned last = defs.back().last_;
+    Shared<const String> text = source_->text_;
+    if (defs.size() > 1) {
+        std::string str(source_->begin(), last);
+        for (size_t d = 1; d < defs.size(); ++d) {
+            for (unsigned p = defs[d-1].last_; p < defs[d].first_; ++p)
+                if (str[p] != '\n')
+                    str[p] = ' ';
+        }
+        text = make_string(str);
+    }
+    Program prog{make<Group_Source>(source_->name_, text, last), system_,
+        Program_Opts().skip_prefix(first)};
+    prog.compile(&names_);
+    if (prog.module_ == nullptr)
+        throw Exception(At_Program(prog), "definition expected");
+    auto module = prog.module_->eval_module(*prog.frame_);
+    for (unsigned i = 0; i < index_->names_.size(); ++i) {
+        if (index_->names_[i].group_ != g)
+            continue;
+        auto slot = module->dictionary_->find(symbols_[i]);
+        if (slot == module->dictionary_->end())
+            throw Exception(At_Program(prog), stringify(
+                symbols_[i], ": definition not found"));
+        Value val = module->get(slot->second);
+        val.publish();
+        values_[i] = val;
+    }
+    ++system_.library_stats_.groups_loaded_;
+}
+
+} // namespace curv
@@ -0,0 +1,91 @@
+// Copyright 2016-2019 Doug Moen
+// Licensed under the Apache License, version 2.0
+// See accompanying file LICENSE or https://www.apache.org/licenses/LICENSE-2.0
+
+#ifndef LIBCURV_LIBRARY_H
+#define LIBCURV_LIBRARY_H
+
+#include <libcurv/builtin.h>
+#include <libcurv/source.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace curv {
+
+struct System;
+
+// An index of a library source file, such as std.curv, whose contents are
+// a record literal containing only named definitions. It lists the byte range
+// of each definition, and partitions the definitions into groups, which are
+// the strongly connected components of the graph of references between
+// definitions. Mutually recursive definitions are in the same group.
+//
+// A Library_Index is cached on disk in $XDG_CACHE_HOME/curv/lib (or
+// ~/.cache/curv/lib), keyed by a hash of the source text, so that an
+// unchanged library isn't parsed at startup. Cache failures are never fatal.
+struct Library_Index
+{
+    // The index format changes if this number changes.
+    static constexpr std::uint32_t version = 1;
+
+    struct Span { std::uint32_t first_, last_; };
+    struct Group { std::vector<Span> defs_; };
+    struct Name { std::string name_; std::uint32_t group_; };
+
+    std::uint64_t hash_ = 0;    // hash of the source text
+    std::uint64_t size_ = 0;    // size of the source text
+    // False if the library is not a record literal containing only named
+    // definitions. Then it has no groups, and must be loaded eagerly.
+    bool lazy_ = false;
+    std::vector<Group> groups_;
+    std::vector<Name> names_;   // in source order
+
+    // Index a library by parsing it.
+    static std::unique_ptr<Library_Index> make(const Source&, System&);
+
+    // The serialized form, in the native byte order.
+    std::string serialize() const;
+    static std::unique_ptr<Library_Index> deserialize(const std::string&);
+
+    // Return the index of a library, from the cache if possible.
+    // `cached` is set to true on a cache hit.
+    static std::unique_ptr<Library_Index> get(
+        const Source&, System&, bool& cached);
+};
+
+// A library whose definitions are compiled and evaluated on demand, the
+// first time that each name is referenced by a program, one group at a time.
+struct Library
+{
+    Shared<const String_Source> source_;
+    System& system_;
+    std::unique_ptr<Library_Index> index_;
+
+    // The names visible within the library: the namespace it was loaded into,
+    // followed by the library's own definitions.
+    Namespace names_;
+
+    // The symbol and value of each name in index_->names_.
+    // A value is missing until its group is evaluated.
+    std::vector<Symbol_Ref> symbols_;
+    std::vector<Value> values_;
+
+    // True for each group that is being compiled.
+    std::vector<bool> busy_;
+
+    // Add the library's definitions to `names`. Lookups of these names are
+    // resolved by this Library, which must outlive `names`.
+    Library(
+        Shared<const String_Source>, System&, std::unique_ptr<Library_Index>,
+        Namespace& names);
+
+    // Return the value of the i'th name in the index.
+    Value value(unsigned i);
+private:
+    void load_group(unsigned g);
+};
+
+} // namespace curv
+#endif // header guard
@@ -41,10 +41,32 @@ auto List_Base::equal(const List_Base& list, const Context& cx) const
     return true;
 }
 
+void List_Builder::regrow(size_t capacity)
+{
+    // A Value is a NaN-boxed 64 bit word, which realloc can relocate.
+    if (list_ == nullptr)
+        list_ = List::make_empty(capacity);
+    else
+        List::regrow(list_, capacity);
+    capacity_ = capacity;
+}
+
 auto List_Builder::get_list()
 -> Shared<List>
 {
-    return List::make_elements(*this);
+    if (list_ == nullptr)
+        return List::make(0);
+    // Return unused capacity. Usually, realloc shrinks the block in place.
+    if (capacity_ > list_->size())
+        List::regrow(list_, list_->size());
+    capacity_ = 0;
+    return {std::move(list_)};
+}
+
+void List_Base::publish_children() const
+{
+    for (auto& v : *this)
+        v.publish();
 }
 
 Shared<List> List_Base::clone() const
@@ -52,11 +74,138 @@ Shared<List> List_Base::clone() const
     return List::make_copy(array_, size_);
 }
 
+auto List_Builder::get_value()
+-> Value
+{
+    if (size() >= Packed_List::min_size) {
+        const List& elems = *list_;
+        bool numeric = true;
+        for (auto& v : elems)
+            numeric &= v.is_num();
+        if (numeric) {
+            Shared<Packed_List> list = Packed_List::make(elems.size());
+            for (size_t i = 0; i < elems.size(); ++i)
+                list->data()[i] = elems[i].to_num_unsafe();
+            list_ = nullptr;
+            capacity_ = 0;
+            return {list};
+        }
+    }
+    return {get_list()};
+}
+
+const char Range_Value::name[] = "list";
+
+void
+Range_Value::assert_size(size_t sz, const Context& cx)
+const
+{
+    if (count_ != sz)
+        throw Exception(cx,
+            stringify("list ",Value{share(*this)}," does not have ",sz," elements"));
+}
+
+Shared<List> Range_Value::get_list() const
+{
+    Shared<List> list = List::make(count_);
+    for (size_t i = 0; i < count_; ++i)
+        (*list)[i] = (*this)[i];
+    return list;
+}
+
+void
+Range_Value::print(std::ostream& out) const
+{
+    out << "[";
+    for (size_t i = 0; i < count_; ++i) {
+        if (i > 0) out << ",";
+        (*this)[i].print(out);
+    }
+    out << "]";
+}
+
+const char Packed_List_Base::name[] = "list";
+
+void
+Packed_List_Base::assert_size(size_t sz, const Context& cx)
+const
+{
+    if (size_ != sz)
+        throw Exception(cx,
+            stringify("list ",Value{share(*this)}," does not have ",sz," elements"));
+}
+
+Shared<List> Packed_List_Base::get_list() const
+{
+    Shared<List> list = List::make(size_);
+    for (size_t i = 0; i < size_; ++i)
+        (*list)[i] = Value{array_[i]};
+    return list;
+}
+
+void
+Packed_List_Base::print(std::ostream& out) const
+{
+    out << "[";
+    for (size_t i = 0; i < size_; ++i) {
+        if (i > 0) out << ",";
+        Value{array_[i]}.print(out);
+    }
+    out << "]";
+}
+
+Shared<List> to_list(Value val, const Context& cx)
+{
+    if (is_list(val)) {
+        Ref_Value& r = val.to_ref_unsafe();
+        if (r.subtype_ == Ref_Value::ty_list)
+            return share((List&)r);
+        try {
+            if (r.subtype_ == Ref_Value::sty_range)
+                return ((Range_Value&)r).get_list();
+            return ((Packed_List&)r).get_list();
+        } catch (std::bad_alloc&) {
+            throw Exception(cx, stringify(
+                "out of memory: can't allocate a list of ",
+                visit_list(r, [](const auto& list) { return list.size(); }),
+                " elements"));
+        }
+    }
+    val.to_abort(cx, List::name);
+}
+
+template<>
+Shared<List> Value::dycast<List>() const noexcept
+{
+    if (is_ref()) {
+        Ref_Value& r = to_ref_unsafe();
+        if (r.type_ == Ref_Value::ty_list && r.subtype_ == Ref_Value::ty_list)
+            return share((List&)r);
+    }
+    return nullptr;
+}
+template<>
+Shared<const List> Value::dycast<const List>() const noexcept
+{
+    return dycast<List>();
+}
+template<>
+Shared<List> Value::to<List>(const Context& cx) const
+{
+    return to_list(*this, cx);
+}
+template<>
+Shared<const List> Value::to<const List>(const Context& cx) const
+{
+    return to_list(*this, cx);
+}
+
 Value* List_Base::ref_element(Value index, bool need_value, const Context& cx)
 {
-    auto index_list = index.to<List>(cx);
-    index_list->assert_size(1, cx);
-    int i = index_list->at(0).to_int(0, int(size_)-1, cx);
+    int i = visit_list(index, cx, [&](const auto& index_list) {
+        index_list.assert_size(1, cx);
+        return index_list.at(0).to_int(0, int(size_)-1, cx);
+    });
     (void)need_value;
     return &array_[i];
 }
@@ -8,6 +8,9 @@
 #include <libcurv/value.h>
 #include <libcurv/tail_array.h>
 #include <libcurv/array_mixin.h>
+#include <algorithm>
+#include <memory>
+#include <utility>
 #include <vector>
 
 namespace curv {
@@ -33,9 +36,14 @@ struct List_Base : public Ref_Value
     Value* ref_element(Value, bool need_value, const Context&);
 
     static const char name[];
+protected:
+    virtual void publish_children() const override;
     TAIL_ARRAY_MEMBERS(Value)
 };
 
+REF_TAG(List_Base, ty_list, ty_list);
+REF_TAG(List, ty_list, ty_list);
+
 inline std::ostream&
 operator<<(std::ostream& out, const List_Base& list)
 {
@@ -49,13 +57,179 @@ inline Shared<List> make_list(size_t size)
     return {std::move(list)};
 }
 
+/// A lazy list of numbers: the value of a range expression like `a..b by s`.
+///
+/// A Range stores first, step and count, instead of a boxed Value for each
+/// element, so `for (i in 0..<10000000)` runs in constant memory.
+/// It has type ty_list and subtype sty_range. `for` loops, indexing, `count`
+/// and the array operations understand it natively, using `visit_list`.
+/// Code that needs a boxed List calls `to_list`, which materializes one.
+/// `Value::dycast<List>` never allocates, so it returns nullptr for a range.
+struct Range_Value final : public Ref_Value
+{
+    double first_;
+    double step_;
+    size_t count_;
+
+    Range_Value(double first, double step, size_t count)
+    :
+        Ref_Value(ty_list, sty_range),
+        first_(first),
+        step_(step),
+        count_(count)
+    {}
+
+    size_t size() const noexcept { return count_; }
+    bool empty() const noexcept { return count_ == 0; }
+    Value operator[](size_t i) const { return Value{first_ + step_*i}; }
+    Value at(size_t i) const { return (*this)[i]; }
+    void assert_size(size_t sz, const Context& cx) const;
+
+    /// Convert to a concrete List, allocating a Value for each element.
+    Shared<List> get_list() const;
+
+    virtual void print(std::ostream&) const override;
+    static const char name[];
+};
+REF_TAG(Range_Value, sty_range, sty_range);
+
+struct Packed_List_Base;
+
+/// A list of numbers, stored as an array of unboxed doubles.
+///
+/// It has type ty_list and subtype sty_packed_list. Array operations on
+/// packed lists run tight loops over contiguous memory, without checking the
+/// type of each element, and produce packed results. Like a Range_Value, it is
+/// read in place by code that uses `visit_list`, and converted to a boxed
+/// List by `to_list`, for example when a non-number is stored into it.
+///
+/// Packed lists are created by List_Builder::get_value, for numeric lists
+/// with at least `min_size` elements. Smaller lists, like a vec3, stay boxed.
+/// A matrix is a list of rows, so it is packed if its rows are large.
+using Packed_List = Tail_Array<Packed_List_Base>;
+
+struct Packed_List_Base : public Ref_Value
+{
+    Packed_List_Base() : Ref_Value(ty_list, sty_packed_list) {}
+
+    static constexpr size_t min_size = 16;
+
+    size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+    Value operator[](size_t i) const { return Value{array_[i]}; }
+    Value at(size_t i) const { return (*this)[i]; }
+    void assert_size(size_t sz, const Context& cx) const;
+    double* data() noexcept { return array_; }
+    const double* data() const noexcept { return array_; }
+
+    /// Convert to a boxed List.
+    Shared<List> get_list() const;
+
+    virtual void print(std::ostream&) const override;
+    static const char name[];
+
+protected:
+    // interface used by Tail_Array. Must be declared last.
+    using value_type = double;
+    size_t size_;
+    double array_[0];
+};
+REF_TAG(Packed_List_Base, sty_packed_list, sty_packed_list);
+REF_TAG(Packed_List, sty_packed_list, sty_packed_list);
+
+/// If `v` is a Packed_List, return it, otherwise nullptr.
+inline Packed_List* packed_list(const Value& v)
+{
+    return v.is_ref() ? ref_cast<Packed_List>(v.to_ref_unsafe()) : nullptr;
+}
+
+/// True if `val` is a List, a Range_Value or a Packed_List.
+/// Unlike `val.dycast<List>()`, this succeeds for a Range_Value.
+inline bool is_list(Value val)
+{
+    return val.is_ref() && val.to_ref_unsafe().type_ == Ref_Value::ty_list;
+}
+
+/// Call `f(list)`, where `list` is a `const List&`, `const Range_Value&`
+/// or `const Packed_List&`, depending on the subtype of `r`,
+/// which must have type ty_list. This lets generic code iterate over a
+/// Range_Value or Packed_List without converting it to a List.
+template <class F>
+inline auto visit_list(const Ref_Value& r, F f)
+-> decltype(f(std::declval<const List&>()))
+{
+    if (r.subtype_ == Ref_Value::sty_range)
+        return f((const Range_Value&)r);
+    if (r.subtype_ == Ref_Value::sty_packed_list)
+        return f((const Packed_List&)r);
+    return f((const List&)r);
+}
+
+/// Like visit_list, but `val` may be any value: if it isn't a list of some
+/// subtype, throw an exception. Use this instead of `val.to<List>(cx)` to
+/// read a list without boxing a Range_Value or Packed_List.
+template <class F>
+inline auto visit_list(Value val, const Context& cx, F f)
+-> decltype(f(std::declval<const List&>()))
+{
+    if (!is_list(val))
+        val.to_abort(cx, List_Base::name);
+    return visit_list(val.to_ref_unsafe(), f);
+}
+
+/// Return `val` as a boxed List, or throw an exception if it isn't a list.
+/// A Range_Value or Packed_List is copied into a new List, which costs
+/// O(n) time and memory, so prefer `visit_list` on hot paths.
+Shared<List> to_list(Value val, const Context& cx);
+
+// These specializations succeed only for a boxed List, and never allocate:
+// they return nullptr for a Range_Value or Packed_List, so use `is_list`
+// to test for a list. They don't use dynamic_cast, since the type code
+// identifies a list. `to<List>` is the same as `to_list`.
+template<> Shared<List> Value::dycast<List>() const noexcept;
+template<> Shared<const List> Value::dycast<const List>() const noexcept;
+template<> Shared<List> Value::to<List>(const Context&) const;
+template<> Shared<const List> Value::to<const List>(const Context&) const;
+
 /// Factory class for building a curv::List.
-struct List_Builder : public std::vector<Value>
+///
+/// The elements are stored directly into the array of a List, which is grown
+/// using realloc, and get_list() hands off that List without copying it.
+struct List_Builder
 {
-    // An optimized version of this class would use a curv::List
-    // as the internal buffer.
+    List_Builder() {}
+    List_Builder(const List_Builder&) = delete;
+    List_Builder& operator=(const List_Builder&) = delete;
+
+    size_t size() const noexcept { return list_ ? list_->size() : 0; }
+    bool empty() const noexcept { return size() == 0; }
+    Value& operator[](size_t i) { return (*list_)[i]; }
+    const Value& operator[](size_t i) const { return (*list_)[i]; }
+
+    void reserve(size_t n)
+    {
+        if (n > capacity_)
+            regrow(n);
+    }
+    void push_back(Value val)
+    {
+        size_t n = size();
+        if (n == capacity_)
+            regrow(std::max(2*n, size_t(4)));
+        list_->push_back_unchecked(std::move(val));
+    }
 
+    /// Return the elements as a List, and reset the builder to empty.
     Shared<List> get_list();
+
+    /// Like get_list, but returns a Packed_List if all of the elements
+    /// are numbers, and there are at least Packed_List::min_size of them.
+    Value get_value();
+
+private:
+    std::unique_ptr<List> list_;
+    size_t capacity_ = 0;
+    void regrow(size_t capacity);
 };
 
 } // namespace curv
@@ -33,7 +33,7 @@ bool issymbol(Value a)
 
 bool islist(Value a)
 {
-    if (a.dycast<List>())
+    if (is_list(a))
         return true;
     if (auto r = a.dycast<Reactive_Value>())
         return r->sctype_.is_list();
@@ -58,7 +58,7 @@ Value multiply(Value a, Value b, const At_Syntax& cx)
         Scalar_Op(const At_Syntax& as) : cx(as) {}
     };
     static Binary_Numeric_Array_Op<Scalar_Op> array_op;
-    return array_op.op(Scalar_Op(cx), a, b);
+    return array_op.op(Scalar_Op(cx), std::move(a), std::move(b));
 }
 
 // Generalized dot product that includes vector dot product and matrix product.
@@ -70,23 +70,39 @@ Value multiply(Value a, Value b, const At_Syntax& cx)
 //      sum(a*b)                     // vector*...
 Value dot(Value a, Value b, const At_Syntax& cx)
 {
-    auto av = a.to<List>(cx);
-    auto bv = b.to<List>(cx);
-    if (av->size() > 0 && av->at(0).dycast<List>()) {
-        Shared<List> result = List::make(av->size());
-        for (size_t i = 0; i < av->size(); ++i) {
-            result->at(i) = dot(av->at(i), b, cx);
-        }
-        return {result};
-    } else {
-        if (av->size() != bv->size())
-            throw Exception(cx, stringify("list of size ",av->size(),
-                " can't be multiplied by list of size ",bv->size()));
-        Value result = {0.0};
-        for (size_t i = 0; i < av->size(); ++i)
-            result = add(result, multiply(av->at(i), bv->at(i), cx), cx);
-        return result;
+    // Fast path: the vector dot product of two packed lists.
+    auto ap = packed_list(a);
+    auto bp = packed_list(b);
+    if (ap && bp && ap->size() == bp->size()) {
+        const double* x = ap->data();
+        const double* y = bp->data();
+        double sum = 0.0;
+        for (size_t i = 0; i < ap->size(); ++i)
+            sum += x[i] * y[i];
+        if (sum == sum)
+            return {sum};
     }
+
+    // Otherwise, read the lists in place, without boxing packed lists.
+    return visit_list(a, cx, [&](const auto& av) -> Value {
+        return visit_list(b, cx, [&](const auto& bv) -> Value {
+            if (av.size() > 0 && is_list(av[0])) {
+                Shared<List> result = List::make(av.size());
+                for (size_t i = 0; i < av.size(); ++i) {
+                    result->at(i) = dot(av[i], b, cx);
+                }
+                return {result};
+            } else {
+                if (av.size() != bv.size())
+                    throw Exception(cx, stringify("list of size ",av.size(),
+                        " can't be multiplied by list of size ",bv.size()));
+                Value result = {0.0};
+                for (size_t i = 0; i < av.size(); ++i)
+                    result = add(result, multiply(av[i], bv[i], cx), cx);
+                return result;
+            }
+        });
+    });
 }
 
 } // namespace curv
@@ -36,7 +36,7 @@ struct Lambda;
 // PROPOSAL: Make Curv homoiconic, so that Operations are values.
 // A Metafunction becomes a tagged record value, and there are user defined
 // metafunctions.
-struct Meaning : public Shared_Base
+struct Meaning : public Shared_Published_Base
 {
     // The original syntax tree for this meaning.
     //
@@ -194,6 +194,9 @@ struct Constant : public Just_Expression
         // Reactive_Expression values, which encapsulate an unevaluated
         // expression, which is required to be pure.
         pure_ = true;
+        // Like the rest of the compiled code, the value is shared by
+        // every thread that evaluates it.
+        value_.publish();
     }
 
     virtual Value eval(Frame&) const override;
@@ -213,6 +216,7 @@ struct Null_Action : public Operation
 struct Symbolic_Ref : public Just_Expression
 {
     Symbol_Ref name_;
+    Field_Cache cache_;
 
     Symbolic_Ref(Shared<const Identifier> id)
     :
@@ -258,7 +262,7 @@ struct Nonlocal_Data_Ref : public Just_Expression
 //  2. During IR tree generation, when the variable definition is processed,
 //     if the variable has an initialization expression (an IR_Expr), then it
 //     is stored in ir_init_value_.
-struct Scoped_Variable : public Shared_Base
+struct Scoped_Variable : public Shared_Published_Base
 {
     bool is_mutable_ = false;
     // Shared<const IR_Expr> ir_init_value_ = nullptr;
@@ -497,6 +501,7 @@ struct List_Expr_Base : public Just_Expression
     void init(); // call after construction & initialization of array elements
     virtual Value eval(Frame&) const override;
     Shared<List> eval_list(Frame&) const;
+    void exec_elements(Frame&, List_Builder&) const;
     virtual SC_Value sc_eval(SC_Frame&) const override;
     virtual size_t hash() const noexcept override;
     virtual bool hash_eq(const Operation&) const noexcept override;
@@ -554,7 +559,9 @@ struct Const_Module_Expr final : public Module_Expr
     :
         Module_Expr(syntax),
         value_(value)
-    {}
+    {
+        value_->publish();
+    }
 
     virtual Shared<Module> eval_module(Frame&) const override
     {
@@ -664,7 +671,7 @@ struct Include_Setter_Base : public Operation
     struct Element {
         slot_t slot_;
         Value value_;
-        Element(slot_t s, Value v) : slot_(s), value_(v) {}
+        Element(slot_t s, Value v) : slot_(s), value_(v) { value_.publish(); }
         Element() noexcept {}
     };
     TAIL_ARRAY_MEMBERS(Element)
@@ -733,6 +740,12 @@ struct For_Op : public Operation
     Shared<const Operation> cond_;
     Shared<const Operation> body_;
 
+    // True if the iterations are independent of one another, because the
+    // condition and body don't assign variables defined outside the loop.
+    // Then a list comprehension may be run on several threads, see
+    // System::jobs_.
+    bool parallel_ = false;
+
     For_Op(
         Shared<const Phrase> syntax,
         Shared<const Pattern> pattern,
@@ -845,7 +858,7 @@ struct Lambda_Expr : public Just_Expression
     virtual Value eval(Frame&) const override;
 };
 
-struct Segment : public Shared_Base
+struct Segment : public Shared_Published_Base
 {
     Shared<const Segment_Phrase> syntax_;
     Segment(Shared<const Segment_Phrase> syntax) : syntax_(std::move(syntax)) {}
@@ -855,7 +868,7 @@ struct Literal_Segment : public Segment
 {
     Shared<const String> data_;
     Literal_Segment(Shared<const Segment_Phrase> syntax, Shared<const String> data)
-    : Segment(std::move(syntax)), data_(std::move(data)) {}
+    : Segment(std::move(syntax)), data_(std::move(data)) { data_->publish(); }
     virtual void generate(Frame&, String_Builder&) const;
 };
 struct Ident_Segment : public Segment
@@ -917,6 +930,7 @@ struct Dot_Expr : public Just_Expression
 {
     Shared<Operation> base_;
     Symbol_Expr selector_;
+    Field_Cache cache_; // used if selector_ is an identifier
 
     Dot_Expr(
         Shared<const Phrase> syntax,
@@ -977,7 +991,7 @@ struct Recursive_Definition_Op : public Operation
 };
 
 // A Locative is the phrase on the left side of an assignment statement.
-struct Locative : public Shared_Base
+struct Locative : public Shared_Published_Base
 {
     Shared<const Phrase> syntax_;
     Locative(Shared<const Phrase> syntax)
@@ -990,6 +1004,8 @@ struct Locative : public Shared_Base
     virtual Shared<Locative> get_element(
         Environ&, Shared<const Phrase>, Shared<Operation>) = 0;
     virtual void sc_print(SC_Frame& f) const;
+    // Generate code for 'locative := val'.
+    virtual void sc_assign(SC_Frame& f, SC_Value val) const;
 };
 
 // A Boxed Locative represents its state as a mutable object of type Value.
@@ -1018,6 +1034,7 @@ struct Local_Locative : public Boxed_Locative
     {}
     slot_t slot_;
     virtual void sc_print(SC_Frame& f) const override;
+    virtual void sc_assign(SC_Frame& f, SC_Value val) const override;
     virtual Value* reference(Frame&,bool) const override;
 };
 
@@ -1026,6 +1043,7 @@ struct Dot_Locative : public Boxed_Locative
 {
     Shared<Boxed_Locative> base_;
     Symbol_Expr selector_;
+    Field_Cache cache_; // used if selector_ is an identifier
 
     Dot_Locative(
         Shared<const Phrase> syntax,
@@ -1056,8 +1074,12 @@ struct Indexed_Locative : public Boxed_Locative
         index_(std::move(index))
     {}
 
+    virtual void store(Frame& f, const Operation&) const override;
     virtual Value* reference(Frame&,bool) const override;
+    Value* element(Value* base, Frame&, bool need_value) const;
     virtual void sc_print(SC_Frame& f) const override;
+    virtual void sc_assign(SC_Frame& f, SC_Value val) const override;
+    unsigned sc_index(SC_Frame& f) const;
 };
 
 // 'locative := expression'
@@ -6,10 +6,89 @@
 #include <libcurv/function.h>
 #include <libcurv/exception.h>
 
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
 namespace curv {
 
 const char Module_Base::name[] = "module";
 
+std::uint64_t
+Module_Base::Dictionary::next_id()
+{
+    static std::atomic<std::uint64_t> last_id{0};
+    return ++last_id;
+}
+
+namespace {
+// The Counters of each live thread, and the sum of the counts
+// from threads that have exited.
+struct Field_Cache_Registry
+{
+    std::mutex mutex_;
+    std::vector<const void*> live_;
+    unsigned long hits_ = 0;
+    unsigned long misses_ = 0;
+};
+Field_Cache_Registry&
+registry()
+{
+    // Never destroyed, since threads may exit during static destruction.
+    static auto r = new Field_Cache_Registry;
+    return *r;
+}
+}
+
+Field_Cache::Counters::Counters()
+{
+    auto& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex_);
+    r.live_.push_back(this);
+}
+
+Field_Cache::Counters::~Counters()
+{
+    auto& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex_);
+    r.hits_ += hits_.load(std::memory_order_relaxed);
+    r.misses_ += misses_.load(std::memory_order_relaxed);
+    r.live_.erase(std::find(r.live_.begin(), r.live_.end(), this));
+}
+
+auto
+Field_Cache::stats() -> Stats
+{
+    auto& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex_);
+    Stats s;
+    s.hits_ = r.hits_;
+    s.misses_ = r.misses_;
+    for (auto p : r.live_) {
+        auto c = static_cast<const Counters*>(p);
+        s.hits_ += c->hits_.load(std::memory_order_relaxed);
+        s.misses_ += c->misses_.load(std::memory_order_relaxed);
+    }
+    return s;
+}
+
+bool
+Field_Cache::miss(
+    const Module_Base::Dictionary& dict, Symbol_Ref name, slot_t& slot) const
+{
+    count(counters().misses_);
+    auto b = dict.find(name);
+    if (b == dict.end())
+        return false;
+    slot = b->second;
+    // Dictionary ids that don't fit in id_bits, and huge slot indexes,
+    // are not cached.
+    if (dict.id_ <= id_mask && slot < (slot_t(1) << (64 - id_bits)))
+        entry_.store(dict.id_ | (std::uint64_t(slot) << id_bits),
+            std::memory_order_relaxed);
+    return true;
+}
+
 void
 Module_Base::print(std::ostream& out) const
 {
@@ -24,6 +103,14 @@ Module_Base::print(std::ostream& out) const
     out << "}";
 }
 
+void
+Module_Base::publish_children() const
+{
+    // The dictionary is compiled code, which is always published.
+    for (size_t i = 0; i < size_; ++i)
+        array_[i].publish();
+}
+
 Value
 Module_Base::get(slot_t i) const
 {
@@ -10,6 +10,8 @@
 #include <libcurv/shared.h>
 #include <libcurv/list.h>
 #include <libcurv/slot.h>
+#include <atomic>
+#include <cstdint>
 
 namespace curv {
 
@@ -27,9 +29,14 @@ struct Module_Base : public Record
     /// TODO: This might be more efficient as a sorted array of field names.
     /// The index of the field name would be interpreted as the slot index.
     /// (Reimplementing `Symbol_Map` using hash trees is another proposal.)
-    struct Dictionary : public Shared_Base, public Symbol_Map<slot_t>
+    struct Dictionary : public Shared_Published_Base, public Symbol_Map<slot_t>
     {
-        Dictionary() : Shared_Base(), Symbol_Map<slot_t>() {}
+        /// A unique, nonzero id. Unlike the address of a dictionary,
+        /// the id is never reused, so it can be used as an inline cache key.
+        const std::uint64_t id_;
+
+        Dictionary() : Shared_Published_Base(), Symbol_Map<slot_t>(), id_(next_id()) {}
+        static std::uint64_t next_id();
     };
 
     /// The `dictionary` maps field names onto slot indexes.
@@ -137,6 +144,8 @@ struct Module_Base : public Record
     }
 
 protected:
+    virtual void publish_children() const override;
+
     // interface used by Tail_Array. Must be declared last.
     using value_type = Value;
     size_t size_;
@@ -144,6 +153,74 @@ protected:
 };
 
 using Module = Tail_Array<Module_Base>;
+REF_TAG(Module_Base, sty_module, sty_module);
+REF_TAG(Module, sty_module, sty_module);
+
+/// A monomorphic inline cache for looking up a field name in a module
+/// dictionary, embedded in an Operation that does such a lookup
+/// (Dot_Expr, Symbolic_Ref, Dot_Locative).
+///
+/// The modules seen by a given call site are usually all constructed from the
+/// same module literal, and so share the same dictionary. The cache remembers
+/// the last (dictionary id, slot index) pair, and a hit costs one compare.
+/// The pair is packed into a single atomic word, so that a cache may be used
+/// by multiple threads.
+struct Field_Cache
+{
+    /// Hit and miss counts for all field caches, printed by `curv -v`.
+    struct Stats
+    {
+        unsigned long hits_ = 0;
+        unsigned long misses_ = 0;
+    };
+    /// Sum the counts from all threads, including threads that have exited.
+    static Stats stats();
+
+    /// Look up `name` in `dict`, which must be the same for each call,
+    /// and store its slot index in `slot`. Return false if not found.
+    bool find(const Module_Base::Dictionary& dict, Symbol_Ref name,
+        slot_t& slot) const
+    {
+        std::uint64_t e = entry_.load(std::memory_order_relaxed);
+        if ((e & id_mask) == dict.id_) {
+            count(counters().hits_);
+            slot = slot_t(e >> id_bits);
+            return true;
+        }
+        return miss(dict, name, slot);
+    }
+
+private:
+    // The low id_bits of entry_ contain a dictionary id, and the high bits
+    // contain a slot index. 0 means empty, since dictionary ids are nonzero.
+    static constexpr unsigned id_bits = 40;
+    static constexpr std::uint64_t id_mask = (std::uint64_t(1) << id_bits) - 1;
+    mutable std::atomic<std::uint64_t> entry_{0};
+
+    bool miss(const Module_Base::Dictionary&, Symbol_Ref, slot_t&) const;
+
+    // Each thread counts into its own Counters, so that threads evaluating
+    // in parallel don't share a cache line on every field reference.
+    // A counter has one writer, and is atomic only so that stats() can read
+    // it from another thread, so an increment needs no locked instruction.
+    struct Counters
+    {
+        std::atomic<unsigned long> hits_{0};
+        std::atomic<unsigned long> misses_{0};
+        Counters();
+        ~Counters();
+    };
+    static Counters& counters()
+    {
+        static thread_local Counters c;
+        return c;
+    }
+    static void count(std::atomic<unsigned long>& n)
+    {
+        n.store(n.load(std::memory_order_relaxed) + 1,
+            std::memory_order_relaxed);
+    }
+};
 
 } // namespace curv
 #endif // header guard
@@ -85,7 +85,7 @@ struct Id_Pattern : public Pattern
             // If I do support mutable array variables, I'll need to use
             // memcpy() for the C++ case.
             SC_Value var = caller.sc_.newvalue(val.type);
-            caller.sc_.out() << "  "<<var.type<<" "<<var<<"="<<val<<";\n";
+            caller.sc_.emit_var(var, val);
             callee[slot_] = var;
         } else {
             // Immutable variable.
@@ -102,7 +102,9 @@ struct Const_Pattern : public Pattern
     :
         Pattern(src),
         value_(val)
-    {}
+    {
+        value_.publish();
+    }
 
     virtual void analyse(Environ& env) override
     {
@@ -214,23 +216,25 @@ struct List_Pattern : public Pattern
     virtual void exec(Value* slots, Value val, const Context& valcx, Frame& f)
     const override
     {
-        auto list = val.to<List>(valcx);
-        list->assert_size(items_.size(), valcx);
-        for (size_t i = 0; i < items_.size(); ++i)
-            items_[i]->exec(slots, list->at(i), At_Index(i, valcx), f);
+        visit_list(val, valcx, [&](const auto& list) {
+            list.assert_size(items_.size(), valcx);
+            for (size_t i = 0; i < items_.size(); ++i)
+                items_[i]->exec(slots, list.at(i), At_Index(i, valcx), f);
+        });
     }
     virtual bool try_exec(Value* slots, Value val, const Context& cx, Frame& f)
     const override
     {
-        auto list = val.dycast<List>();
-        if (list == nullptr)
+        if (!is_list(val))
             return false;
-        if (list->size() != items_.size())
-            return false;
-        for (size_t i = 0; i < items_.size(); ++i)
-            if (!items_[i]->try_exec(slots, list->at(i), cx, f))
+        return visit_list(val.to_ref_unsafe(), [&](const auto& list) {
+            if (list.size() != items_.size())
                 return false;
-        return true;
+            for (size_t i = 0; i < items_.size(); ++i)
+                if (!items_[i]->try_exec(slots, list.at(i), cx, f))
+                    return false;
+            return true;
+        });
     }
     virtual void sc_exec(Operation& expr, SC_Frame& caller, SC_Frame& callee)
     const override
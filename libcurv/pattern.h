@@ -19,13 +19,13 @@ struct Record;
 struct Closure;
 struct Operation;
 
-struct Pattern : public Shared_Base
+struct Pattern : public Shared_Published_Base
 {
     Shared<const Phrase> syntax_;
 
     Pattern(Shared<const Phrase> s)
     :
-        Shared_Base(),
+        Shared_Published_Base(),
         syntax_(std::move(s))
     {}
 
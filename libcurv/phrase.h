@@ -33,7 +33,7 @@ struct Environ;
 ///   the original tokens and white space. So a syntax tree can be used for any
 ///   purpose, including upgrading source code from an earlier version of the
 ///   language to a newer version.
-struct Phrase : public Shared_Base
+struct Phrase : public Shared_Published_Base
 {
     virtual ~Phrase() {}
     virtual Location location() const = 0;
@@ -71,7 +71,7 @@ struct Numeral final : public Token_Phrase
     virtual Shared<Meaning> analyse(Environ&, unsigned) const override;
 };
 
-struct Segment_Phrase : public Shared_Base
+struct Segment_Phrase : public Shared_Published_Base
 {
     virtual Location location() const = 0;
     virtual Shared<Segment> analyse(Environ&, unsigned) const = 0;
@@ -63,6 +63,7 @@ struct Uniform_Variable : public Reactive_Value
     Uniform_Variable(Symbol_Ref name, std::string id, SC_Type);
     virtual void print(std::ostream&) const override;
 };
+REF_TAG(Uniform_Variable, sty_uniform_variable, sty_uniform_variable);
 
 } // namespace curv
 #endif // header guard
@@ -51,4 +51,24 @@ progdir(const char *argv0)
         ": can't find ", argv0, " in $PATH"));
 }
 
+fs::path
+cache_dir(const char* name)
+{
+    fs::path dir;
+    const char* xdg = getenv("XDG_CACHE_HOME");
+    const char* home = getenv("HOME");
+    if (xdg != nullptr && xdg[0] == '/')
+        dir = fs::path(xdg);
+    else if (home != nullptr && home[0] != '\0')
+        dir = fs::path(home) / ".cache";
+    else
+        return fs::path();
+    dir = dir / "curv" / name;
+    boost::system::error_code ec;
+    fs::create_directories(dir, ec);
+    if (ec)
+        return fs::path();
+    return dir;
+}
+
 }
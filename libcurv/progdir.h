@@ -11,5 +11,10 @@ namespace curv {
 
 boost::filesystem::path progdir(const char* argv0);
 
+// Return the cache directory $XDG_CACHE_HOME/curv/<name>, or
+// ~/.cache/curv/<name>, creating it if necessary.
+// Return an empty path if it can't be created.
+boost::filesystem::path cache_dir(const char* name);
+
 }
 #endif // header guard
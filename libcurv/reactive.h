@@ -27,6 +27,7 @@ struct Reactive_Value : public Ref_Value
     virtual void print(std::ostream&) const override;
     virtual Shared<Operation> expr(const Phrase&);
 };
+REF_TAG(Reactive_Value, ty_reactive, sty_reactive_expression);
 
 // An expression over one or more reactive variables. Essentially, this is a
 // lazy evaluation thunk. Reactive expressions can only be evaluated in a
@@ -50,6 +51,7 @@ struct Reactive_Expression : public Reactive_Value
         return expr_->hash_eq(*re.expr_);
     }
 };
+REF_TAG(Reactive_Expression, sty_reactive_expression, sty_reactive_expression);
 
 } // namespace curv
 #endif // header guard
@@ -97,6 +97,13 @@ DRecord::hasfield(Symbol_Ref name) const
     return (fp != fields_.end());
 }
 
+void
+DRecord::publish_children() const
+{
+    for (auto& f : fields_)
+        f.second.publish();
+}
+
 Shared<Record>
 DRecord::clone() const
 {
@@ -69,6 +69,7 @@ struct Record : public Ref_Value
     };
     virtual std::unique_ptr<Iter> iter() const = 0;
 };
+REF_TAG(Record, ty_record, sty_dir_record);
 
 std::pair<Symbol_Ref, Value> value_to_variant(Value, const Context& cx);
 
@@ -133,7 +134,10 @@ struct DRecord : public Record
     {
         return std::make_unique<Iter>(*this);
     }
+protected:
+    virtual void publish_children() const override;
 };
+REF_TAG(DRecord, sty_drecord, sty_drecord);
 
 } // namespace curv
 #endif // header guard
@@ -13,6 +13,7 @@
 #include <libcurv/function.h>
 #include <libcurv/sc_compiler.h>
 #include <libcurv/sc_context.h>
+#include <libcurv/sc_vm.h>
 #include <libcurv/math.h>
 #include <libcurv/meaning.h>
 #include <libcurv/optimizer.h>
@@ -56,37 +57,15 @@ SC_Compiler::define_function(
     const Context& cx)
 {
     begin_function();
+    std::vector<SC_Value> params;
+    for (auto& ty : param_types)
+        params.push_back(newvalue(ty));
 
     // function prologue
-    if (target_ == SC_Target::cpp)
-        out_ << "extern \"C\" void " << name << "(";
+    if (target_ == SC_Target::vm)
+        vm_->gen_begin(params, cx);
     else
-        out_ << result_type << " " << name << "(";
-    bool first = true;
-    std::vector<SC_Value> params;
-    int n = 0;
-    for (auto& ty : param_types) {
-        params.push_back(newvalue(ty));
-        if (!first) out_ << ", ";
-        first = false;
-        if (target_ == SC_Target::cpp)
-            out_ << "const " << ty << "* param" << n++;
-        else
-            out_ << ty << " " << params.back();
-    }
-    if (target_ == SC_Target::cpp) {
-        if (!first) out_ << ", ";
-        out_ << result_type << "* result)\n";
-    } else
-        out_ << ")\n";
-    out_ << "{\n";
-    if (target_ == SC_Target::cpp) {
-        n = 0;
-        for (unsigned i = 0; i < params.size(); ++i) {
-            out_ << "  " << param_types[i] << " " << params[i]
-                 << " = *param" << n++ << ";\n";
-        }
-    }
+        put_prologue(name, params, result_type);
 
     // function body
     auto f = SC_Frame::make(0, *this, &cx, nullptr, nullptr);
@@ -104,15 +83,111 @@ SC_Compiler::define_function(
     if (result.type != result_type) {
         throw Exception(cx, stringify(name," function returns ",result.type));
     }
+
+    if (target_ == SC_Target::vm) {
+        // Code that was written as text uses features the VM lacks.
+        std::string text = constants_.str() + body_.str();
+        if (!text.empty()) {
+            auto begin = text.find_first_not_of(' ');
+            auto end = text.find('\n');
+            throw Exception(cx, stringify("SubCurv VM: unsupported: ",
+                text.substr(begin, end - begin)));
+        }
+        vm_->gen_end(result, valcount_);
+        return;
+    }
     end_function();
 
     // function epilogue
-    if (target_ == SC_Target::cpp) {
+    if (target_ != SC_Target::glsl) {
         out_ << "  *result = " << result << ";\n";
     } else {
         out_ << "  return " << result << ";\n";
     }
     out_ << "}\n";
+
+    if (target_ == SC_Target::cpp
+        && param_types.size() == 1
+        && param_types[0].is_num_or_vec()
+        && result_type.is_num_or_vec())
+    {
+        define_batch_function(name, param_types[0], result_type);
+    }
+}
+
+// Write the GLSL/C++ function header, and for C++, copy the parameters
+// into SSA variables.
+void
+SC_Compiler::put_prologue(
+    const char* name, const std::vector<SC_Value>& params, SC_Type result_type)
+{
+    if (target_ != SC_Target::glsl)
+        out_ << "extern \"C\" void " << name << "(";
+    else
+        out_ << result_type << " " << name << "(";
+    bool first = true;
+    int n = 0;
+    for (auto& p : params) {
+        auto& ty = p.type;
+        if (!first) out_ << ", ";
+        first = false;
+        if (target_ != SC_Target::glsl)
+            out_ << "const " << ty << "* param" << n++;
+        else
+            out_ << ty << " " << p;
+    }
+    if (target_ != SC_Target::glsl) {
+        if (!first) out_ << ", ";
+        out_ << result_type << "* result)\n";
+    } else
+        out_ << ")\n";
+    out_ << "{\n";
+    if (target_ != SC_Target::glsl) {
+        n = 0;
+        for (auto& p : params) {
+            out_ << "  " << p.type << " " << p
+                 << " = *param" << n++ << ";\n";
+        }
+    }
+}
+
+// Define a C++ function named `<name>_batch` that calls the scalar
+// function `name` on a batch of N arguments. Arguments and results are
+// stored in structure-of-arrays layout, one float array per vector component:
+//   extern "C" void <name>_batch(
+//       unsigned n, const float* const* in, float* const* out);
+// The scalar function is visible in the same translation unit, so it is
+// inlined into the loop, and a straight line body can be vectorized.
+void
+SC_Compiler::define_batch_function(
+    const char* name, SC_Type param_type, SC_Type result_type)
+{
+    unsigned pcount = param_type.count();
+    unsigned rcount = result_type.count();
+    out_ << "extern \"C\" void " << name << "_batch("
+         << "unsigned n, const float* const* in, float* const* out)\n"
+         << "{\n";
+    for (unsigned i = 0; i < pcount; ++i)
+        out_ << "  const float* __restrict in" << i << " = in[" << i << "];\n";
+    for (unsigned i = 0; i < rcount; ++i)
+        out_ << "  float* __restrict out" << i << " = out[" << i << "];\n";
+    out_ << "  for (unsigned i = 0; i < n; ++i) {\n"
+         << "    " << param_type << " arg(";
+    for (unsigned i = 0; i < pcount; ++i) {
+        if (i > 0) out_ << ", ";
+        out_ << "in" << i << "[i]";
+    }
+    out_ << ");\n"
+         << "    " << result_type << " result;\n"
+         << "    " << name << "(&arg, &result);\n";
+    if (rcount == 1)
+        out_ << "    out0[i] = result;\n";
+    else {
+        for (unsigned i = 0; i < rcount; ++i)
+            out_ << "    out" << i << "[i] = result[" << i << "];\n";
+    }
+    out_ << "  }\n"
+         << "}\n";
 }
 
 void
@@ -135,6 +210,250 @@ SC_Compiler::end_function()
     out_ << body_.str();
 }
 
+SC_VM&
+SC_Compiler::vm()
+{
+    vm_->in_constants_ = in_constants_;
+    return *vm_;
+}
+
+void
+SC_Compiler::emit_call(SC_Value result, const char* fn,
+    std::initializer_list<SC_Value> args)
+{
+    if (target_ == SC_Target::vm) {
+        vm().gen_call(result, fn, args.begin(), args.size());
+        return;
+    }
+    out() << "  " << result.type << " " << result << " = " << fn << "(";
+    bool first = true;
+    for (auto a : args) {
+        if (!first) out() << ",";
+        first = false;
+        out() << a;
+    }
+    out() << ");\n";
+}
+
+void
+SC_Compiler::emit_construct(SC_Value result, const SC_Value* args, unsigned n)
+{
+    if (target_ == SC_Target::vm) {
+        vm().gen_construct(result, args, n);
+        return;
+    }
+    out() << "  " << result.type << " " << result << " = "
+          << result.type << "(";
+    for (unsigned i = 0; i < n; ++i) {
+        if (i > 0) out() << ",";
+        out() << args[i];
+    }
+    out() << ");\n";
+}
+
+void
+SC_Compiler::emit_unop(SC_Value result, const char* op, SC_Value x)
+{
+    if (target_ == SC_Target::vm) {
+        vm().gen_unop(result, op, x);
+        return;
+    }
+    out() << "  " << result.type << " " << result << " = " << op << x << ";\n";
+}
+
+void
+SC_Compiler::emit_binop(SC_Value result, SC_Value x, const char* op, SC_Value y)
+{
+    if (target_ == SC_Target::vm) {
+        vm().gen_binop(result, x, op, y);
+        return;
+    }
+    out() << "  " << result.type << " " << result << " =("
+          << x << " " << op << " " << y << ");\n";
+}
+
+void
+SC_Compiler::emit_select(SC_Value result, SC_Value cond, SC_Value x, SC_Value y)
+{
+    if (target_ == SC_Target::vm) {
+        vm().gen_select(result, cond, x, y);
+        return;
+    }
+    out() << "  " << result.type << " " << result << " =("
+          << cond << " ? " << x << " : " << y << ");\n";
+}
+
+void
+SC_Compiler::emit_element(SC_Value result, SC_Value vec, unsigned i)
+{
+    if (target_ == SC_Target::vm) {
+        vm().gen_element(result, vec, i);
+        return;
+    }
+    out() << "  " << result.type << " " << result << " = "
+          << vec << "[" << i << "];\n";
+}
+
+void
+SC_Compiler::emit_swizzle(SC_Value result, SC_Value vec, const char* swizzle)
+{
+    if (target_ == SC_Target::vm) {
+        vm().gen_swizzle(result, vec, swizzle);
+        return;
+    }
+    out() << "  " << result.type << " " << result << " = ";
+    if (target_ == SC_Target::glsl) {
+        // use GLSL swizzle syntax: v.xyz
+        out() << vec << "." << swizzle;
+    } else {
+        // fall back to a vector constructor: vec3(v.x,v.y,v.z)
+        out() << result.type << "(";
+        for (const char* p = swizzle; *p != '\0'; ++p) {
+            if (p != swizzle) out() << ",";
+            out() << vec << "." << *p;
+        }
+        out() << ")";
+    }
+    out() << ";\n";
+}
+
+void
+SC_Compiler::emit_num(SC_Value result, double num)
+{
+    if (target_ == SC_Target::vm) {
+        vm().gen_num(result, num);
+        return;
+    }
+    out() << "  " << result.type << " " << result << " = ";
+    if (num != num)
+        out() << "-0.0/0.0";
+    else
+        out() << dfmt(num, dfmt::EXPR);
+    out() << ";\n";
+}
+
+void sc_put_value(Value, SC_Type, const At_SC_Phrase&, std::ostream&);
+
+void
+SC_Compiler::emit_const(SC_Value result, Value val, const At_SC_Phrase& cx)
+{
+    if (target_ == SC_Target::vm) {
+        vm().gen_const(result, val, cx);
+        return;
+    }
+    SC_Type ty = result.type;
+    String_Builder init;
+    sc_put_value(val, ty, cx, init);
+    auto initstr = init.get_string();
+    if (ty.rank_ == 0) {
+        out() << "  " << ty << " " << result << " = " << *initstr << ";\n";
+    } else {
+        SC_Type ety = ty;
+        ety.rank_ = 0;
+        if (target_ != SC_Target::glsl) {
+            out() << "  " << ety << " " << result << "[] = {"
+                << *initstr << "};\n";
+        } else {
+            out() << "  " << ty << " " << result << " = " << ty << "("
+                << *initstr << ");\n";
+        }
+    }
+}
+
+void
+SC_Compiler::emit_var(SC_Value var, SC_Value val)
+{
+    if (target_ == SC_Target::vm) {
+        vm().gen_assign(var, val);
+        return;
+    }
+    out() << "  " << var.type << " " << var << "=" << val << ";\n";
+}
+
+void
+SC_Compiler::emit_assign(SC_Value var, SC_Value val)
+{
+    if (target_ == SC_Target::vm) {
+        vm().gen_assign(var, val);
+        return;
+    }
+    out() << "  " << var << "=" << val << ";\n";
+}
+
+void
+SC_Compiler::emit_assign_element(SC_Value var, unsigned i, SC_Value val)
+{
+    if (target_ == SC_Target::vm) {
+        vm().gen_assign_element(var, i, val);
+        return;
+    }
+    out() << "  " << var << "[" << i << "]=" << val << ";\n";
+}
+
+void
+SC_Compiler::emit_if(SC_Value cond)
+{
+    if (target_ == SC_Target::vm) {
+        vm().gen_if(cond);
+        return;
+    }
+    out() << "  if (" << cond << ") {\n";
+}
+
+void
+SC_Compiler::emit_else()
+{
+    if (target_ == SC_Target::vm) {
+        vm().gen_else();
+        return;
+    }
+    out() << "  } else {\n";
+}
+
+void
+SC_Compiler::emit_while()
+{
+    if (target_ == SC_Target::vm) {
+        vm().gen_while();
+        return;
+    }
+    out() << "  while (true) {\n";
+}
+
+void
+SC_Compiler::emit_for(SC_Value i, SC_Value first, bool half_open,
+    SC_Value last, SC_Value step)
+{
+    if (target_ == SC_Target::vm) {
+        vm().gen_for(i, first, half_open, last, step,
+            newvalue(SC_Type::Bool()));
+        return;
+    }
+    out() << "  for (float " << i << "=" << first << ";"
+          << i << (half_open ? "<" : "<=") << last << ";"
+          << i << "+=" << step << ") {\n";
+}
+
+void
+SC_Compiler::emit_break_unless(SC_Value cond)
+{
+    if (target_ == SC_Target::vm) {
+        vm().gen_break_unless(cond);
+        return;
+    }
+    out() << "  if (!" << cond << ") break;\n";
+}
+
+void
+SC_Compiler::emit_end()
+{
+    if (target_ == SC_Target::vm) {
+        vm().gen_end_block();
+        return;
+    }
+    out() << "  }\n";
+}
+
 SC_Value sc_call_unary_numeric(SC_Frame& f, const char* name)
 {
     auto arg = f[0];
@@ -142,7 +461,7 @@ SC_Value sc_call_unary_numeric(SC_Frame& f, const char* name)
         throw Exception(At_SC_Arg(0, f),
             stringify(name,": argument is not numeric"));
     auto result = f.sc_.newvalue(arg.type);
-    f.sc_.out()<<"  "<<arg.type<<" "<<result<<" = "<<name<<"("<<arg<<");\n";
+    f.sc_.emit_call(result, name, {arg});
     return result;
 }
 
@@ -300,25 +619,8 @@ SC_Value sc_eval_const(SC_Frame& f, Value val, const Phrase& syntax)
             stringify("value ",val," is not supported "));
     }
 
-    String_Builder init;
-    sc_put_value(val, ty, cx, init);
-    auto initstr = init.get_string();
     SC_Value result = f.sc_.newvalue(ty);
-    if (ty.rank_ == 0) {
-        f.sc_.out()
-            << "  " << ty << " " << result << " = "
-            << *initstr << ";\n";
-    } else {
-        SC_Type ety = ty;
-        ety.rank_ = 0;
-        if (f.sc_.target_ == SC_Target::cpp) {
-            f.sc_.out() << "  " << ety << " " << result << "[] = {"
-                << *initstr << "};\n";
-        } else {
-            f.sc_.out() << "  " << ty << " " << result << " = " << ty << "("
-                << *initstr << ");\n";
-        }
-    }
+    f.sc_.emit_const(result, val, cx);
 
     f.sc_.valcache_[val] = result;
     return result;
@@ -350,27 +652,24 @@ SC_Value Negative_Expr::sc_eval(SC_Frame& f) const
         throw Exception(At_SC_Phrase(arg_->syntax_, f),
             "argument not numeric");
     SC_Value result = f.sc_.newvalue(x.type);
-    f.sc_.out()<<"  "<<x.type<<" "<<result<<" = -"<<x<< ";\n";
+    f.sc_.emit_unop(result, "-", x);
     return result;
 }
 
-void sc_put_as(SC_Frame& f, SC_Value val, const Context& cx, SC_Type type)
+// Convert a number to a vector or matrix by replicating it.
+SC_Value sc_convert(SC_Frame& f, SC_Value val, const Context& cx, SC_Type type)
 {
-    if (val.type == type) {
-        f.sc_.out() << val;
-        return;
-    }
+    if (val.type == type)
+        return val;
     if (val.type == SC_Type::Num()) {
-        if (sc_type_count(type) > 1) {
-            f.sc_.out() << type << "(";
-            bool first = true;
-            for (unsigned i = 0; i < sc_type_count(type); ++i) {
-                if (!first) f.sc_.out() << ",";
-                f.sc_.out() << val;
-                first = false;
-            }
-            f.sc_.out() << ")";
-            return;
+        unsigned n = sc_type_count(type);
+        if (n > 1) {
+            SC_Value args[SC_Type::MAX_MAT_COUNT];
+            for (unsigned i = 0; i < n; ++i)
+                args[i] = val;
+            SC_Value result = f.sc_.newvalue(type);
+            f.sc_.emit_construct(result, args, type.is_mat() ? n : 1);
+            return result;
         }
     }
     throw Exception(cx, stringify("can't convert ",val.type," to ",type));
@@ -386,20 +685,19 @@ bool sc_try_broadcast(SC_Frame& f, SC_Value& val, SC_Type rtype)
 {
     if (!sc_try_extend(f, val, rtype.abase())) return false;
     SC_Value result = f.sc_.newvalue(rtype);
-    f.sc_.out() << "  "<<rtype<<" "<<result<<" = "<<rtype<<"(";
     if (rtype.is_bool32()) {
-        f.sc_.out() << "-int("<<val<<")";
+        f.sc_.out() << "  "<<rtype<<" "<<result<<" = "<<rtype<<"("
+            << "-int("<<val<<"));\n";
     } else if (rtype.is_any_vec()) {
-        f.sc_.out() << val;
+        f.sc_.emit_construct(result, &val, 1);
     } else if (rtype.is_mat()) {
+        SC_Value args[SC_Type::MAX_MAT_COUNT];
         unsigned n = rtype.count();
-        for (unsigned i = 0; i < n; ++i) {
-            if (i > 0) f.sc_.out() << ",";
-            f.sc_.out() << val;
-        }
+        for (unsigned i = 0; i < n; ++i)
+            args[i] = val;
+        f.sc_.emit_construct(result, args, n);
     } else
         die("sc_try_broadcast: unsupported list type");
-    f.sc_.out() << ");\n";
     val = result;
     return true;
 }
@@ -416,12 +714,7 @@ bool sc_try_elementwise(SC_Frame& f, SC_Value& a, SC_Type rtype)
             return false;
     }
     SC_Value result = f.sc_.newvalue(rtype);
-    f.sc_.out() << "  "<<rtype<<" "<<result<<" = "<<rtype<<"(";
-    for (unsigned i = 0; i < count; ++i) {
-        if (i > 0) f.sc_.out() << ",";
-        f.sc_.out() << elem[i];
-    }
-    f.sc_.out() << ");\n";
+    f.sc_.emit_construct(result, elem, count);
     a = result;
     return true;
 }
@@ -522,20 +815,16 @@ sc_arith_expr(SC_Frame& f, const Phrase& syntax,
         throw Exception(At_SC_Phrase(share(syntax), f),
             stringify("domain error: ",x.type,op,y.type));
 
-    SC_Value result = f.sc_.newvalue(rtype);
-    f.sc_.out() <<"  "<<rtype<<" "<<result<<" = ";
     if (isalpha(*op)) {
-        f.sc_.out() << op << "(";
-        sc_put_as(f, x, At_SC_Phrase(xexpr.syntax_, f), rtype);
-        f.sc_.out() << ",";
-        sc_put_as(f, y, At_SC_Phrase(yexpr.syntax_, f), rtype);
-        f.sc_.out() << ")";
-    } else {
-        sc_put_as(f, x, At_SC_Phrase(xexpr.syntax_, f), rtype);
-        f.sc_.out() << op;
-        sc_put_as(f, y, At_SC_Phrase(yexpr.syntax_, f), rtype);
+        // a GLSL function: the arguments must have the same type
+        x = sc_convert(f, x, At_SC_Phrase(xexpr.syntax_, f), rtype);
+        y = sc_convert(f, y, At_SC_Phrase(yexpr.syntax_, f), rtype);
+        SC_Value result = f.sc_.newvalue(rtype);
+        f.sc_.emit_call(result, op, {x, y});
+        return result;
     }
-    f.sc_.out() << ";\n";
+    SC_Value result = f.sc_.newvalue(rtype);
+    f.sc_.emit_binop(result, x, op, y);
     return result;
 }
 
@@ -655,12 +944,15 @@ Local_Locative::sc_print(SC_Frame& f) const
 }
 
 void
-Indexed_Locative::sc_print(SC_Frame& f) const
+Local_Locative::sc_assign(SC_Frame& f, SC_Value val) const
+{
+    f.sc_.emit_assign(f[slot_], val);
+}
+
+// convert index_ to a vector index
+unsigned
+Indexed_Locative::sc_index(SC_Frame& f) const
 {
-    // TODO: ensure that base_ is a vector
-    base_->sc_print(f);
-    int i = 0;
-    // convert index_ to i
     auto list = cast<List_Expr>(index_);
     if (list == nullptr || list->size() != 1)
         throw Exception(At_SC_Phrase(index_->syntax_, f),
@@ -668,8 +960,24 @@ Indexed_Locative::sc_print(SC_Frame& f) const
     // i = sc_eval_index_expr() might work if we had an SC_Value for base_
     // TODO: restrict range of i based on size of vector
     Value ival = sc_constify(*list->at(0), f);
-    i = ival.to_int(0, 3, At_SC_Phrase(index_->syntax_, f));
-    f.sc_.out() << '[' << i << ']';
+    return ival.to_int(0, 3, At_SC_Phrase(index_->syntax_, f));
+}
+
+void
+Indexed_Locative::sc_print(SC_Frame& f) const
+{
+    // TODO: ensure that base_ is a vector
+    base_->sc_print(f);
+    f.sc_.out() << '[' << sc_index(f) << ']';
+}
+
+void
+Indexed_Locative::sc_assign(SC_Frame& f, SC_Value val) const
+{
+    if (auto local = cast<const Local_Locative>(base_))
+        f.sc_.emit_assign_element(f[local->slot_], sc_index(f), val);
+    else
+        Locative::sc_assign(f, val);
 }
 
 void
@@ -679,13 +987,19 @@ Locative::sc_print(SC_Frame& f) const
 }
 
 void
-Assignment_Action::sc_exec(SC_Frame& f) const
+Locative::sc_assign(SC_Frame& f, SC_Value val) const
 {
-    SC_Value val = sc_eval_op(f, *expr_);
     f.sc_.out() << "  ";
-    locative_->sc_print(f);
+    sc_print(f);
     f.sc_.out() << "="<<val<<";\n";
 }
+
+void
+Assignment_Action::sc_exec(SC_Frame& f) const
+{
+    SC_Value val = sc_eval_op(f, *expr_);
+    locative_->sc_assign(f, val);
+}
 void
 Data_Setter::sc_exec(SC_Frame& f) const
 {
@@ -714,11 +1028,15 @@ SC_Value sc_eval_index_expr(SC_Value array, Operation& index, SC_Frame& f)
     Value k;
     if (array.type.is_any_vec() && sc_try_constify(index, f, k)) {
         // A vector with a constant index. Swizzling is supported.
-        if (auto list = k.dycast<List>()) {
-            if (list->size() < 2 || list->size() > 4) {
-                throw Exception(At_SC_Phrase(index.syntax_, f),
+        if (is_list(k)) {
+            At_SC_Phrase kcx(index.syntax_, f);
+            size_t n = visit_list(k.to_ref_unsafe(),
+                [](const auto& list) { return list.size(); });
+            if (n < 2 || n > 4) {
+                throw Exception(kcx,
                     "list index vector must have between 2 and 4 elements");
             }
+            auto list = to_list(k, kcx);
             char swizzle[5];
             memset(swizzle, 0, 5);
             for (size_t i = 0; i <list->size(); ++i) {
@@ -729,43 +1047,13 @@ SC_Value sc_eval_index_expr(SC_Value array, Operation& index, SC_Frame& f)
             SC_Value result =
                 f.sc_.newvalue(
                     SC_Type::Any_Vec(array.type.abase(), list->size()));
-            f.sc_.out() << "  " << result.type << " "<< result<<" = ";
-            if (f.sc_.target_ == SC_Target::glsl) {
-                // use GLSL swizzle syntax: v.xyz
-                f.sc_.out() <<array<<"."<<swizzle;
-            } else {
-                // fall back to a vector constructor: vec3(v.x,v.y,v.z)
-                f.sc_.out() << result.type << "(";
-                bool first = true;
-                for (size_t i = 0; i < list->size(); ++i) {
-                    if (!first)
-                        f.sc_.out() << ",";
-                    first = false;
-                    f.sc_.out() << array << "." << swizzle[i];
-                }
-                f.sc_.out() << ")";
-            }
-            f.sc_.out() <<";\n";
+            f.sc_.emit_swizzle(result, array, swizzle);
             return result;
         }
-        const char* arg2 = nullptr;
-        auto num = k.to_num_or_nan();
-        if (num == 0.0)
-            arg2 = ".x";
-        else if (num == 1.0)
-            arg2 = ".y";
-        else if (num == 2.0 && array.type.count() > 2)
-            arg2 = ".z";
-        else if (num == 3.0 && array.type.count() > 3)
-            arg2 = ".w";
-        if (arg2 == nullptr)
-            throw Exception(At_SC_Phrase(index.syntax_, f),
-                stringify("got ",k,", expected 0..",
-                    array.type.count()-1));
-
+        char letter = gl_index_letter(k, array.type.count(),
+            At_SC_Phrase(index.syntax_, f));
         SC_Value result = f.sc_.newvalue(array.type.abase());
-        f.sc_.out() << "  " << result.type << " " << result << " = "
-            << array << arg2 <<";\n";
+        f.sc_.emit_element(result, array, letter == 'w' ? 3 : letter - 'x');
         return result;
     }
     // An array of numbers, indexed with a number.
@@ -909,14 +1197,7 @@ SC_Value List_Expr_Base::sc_eval(SC_Frame& f) const
         }
         SC_Type atype = SC_Type::List(elem[0].type, this->size());
         SC_Value result = f.sc_.newvalue(atype);
-        f.sc_.out() << "  " << atype << " " << result << " = " << atype << "(";
-        bool first = true;
-        for (unsigned i = 0; i < this->size(); ++i) {
-            if (!first) f.sc_.out() << ",";
-            first = false;
-            f.sc_.out() << elem[i];
-        }
-        f.sc_.out() << ");\n";
+        f.sc_.emit_construct(result, elem, this->size());
         return result;
     }
     Value val = sc_constify(*this, f);
@@ -927,14 +1208,13 @@ SC_Value Not_Expr::sc_eval(SC_Frame& f) const
 {
     auto arg = sc_eval_bool_struc(f, *arg_);
     SC_Value result = f.sc_.newvalue(arg.type);
-    f.sc_.out() << "  " << arg.type << " " << result << " = ";
     if (arg.type.is_bool())
-        f.sc_.out() << "!" << arg;
+        f.sc_.emit_unop(result, "!", arg);
     else if (arg.type.is_bool_or_vec())
-        f.sc_.out() << "not(" << arg << ")";
+        f.sc_.emit_call(result, "not", {arg});
     else
-        f.sc_.out() << "~" << arg;
-    f.sc_.out() << ";\n";
+        f.sc_.out() << "  " << arg.type << " " << result << " = ~"
+            << arg << ";\n";
     return result;
 }
 SC_Value Or_Expr::sc_eval(SC_Frame& f) const
@@ -943,7 +1223,7 @@ SC_Value Or_Expr::sc_eval(SC_Frame& f) const
     auto arg1 = sc_eval_expr(f, *arg1_, SC_Type::Bool());
     auto arg2 = sc_eval_expr(f, *arg2_, SC_Type::Bool());
     SC_Value result = f.sc_.newvalue(SC_Type::Bool());
-    f.sc_.out() <<"  bool "<<result<<" =("<<arg1<<" || "<<arg2<<");\n";
+    f.sc_.emit_binop(result, arg1, "||", arg2);
     return result;
 }
 SC_Value And_Expr::sc_eval(SC_Frame& f) const
@@ -952,7 +1232,7 @@ SC_Value And_Expr::sc_eval(SC_Frame& f) const
     auto arg1 = sc_eval_expr(f, *arg1_, SC_Type::Bool());
     auto arg2 = sc_eval_expr(f, *arg2_, SC_Type::Bool());
     SC_Value result = f.sc_.newvalue(SC_Type::Bool());
-    f.sc_.out() <<"  bool "<<result<<" =("<<arg1<<" && "<<arg2<<");\n";
+    f.sc_.emit_binop(result, arg1, "&&", arg2);
     return result;
 }
 SC_Value If_Else_Op::sc_eval(SC_Frame& f) const
@@ -967,87 +1247,64 @@ SC_Value If_Else_Op::sc_eval(SC_Frame& f) const
             arg2.type, ",", arg3.type, ")"));
     }
     SC_Value result = f.sc_.newvalue(arg2.type);
-    f.sc_.out() <<"  "<<arg2.type<<" "<<result
-             <<" =("<<arg1<<" ? "<<arg2<<" : "<<arg3<<");\n";
+    f.sc_.emit_select(result, arg1, arg2, arg3);
     return result;
 }
 void If_Else_Op::sc_exec(SC_Frame& f) const
 {
     auto arg1 = sc_eval_expr(f, *arg1_, SC_Type::Bool());
-    f.sc_.out() << "  if ("<<arg1<<") {\n";
+    f.sc_.emit_if(arg1);
     arg2_->sc_exec(f);
-    f.sc_.out() << "  } else {\n";
+    f.sc_.emit_else();
     arg3_->sc_exec(f);
-    f.sc_.out() << "  }\n";
+    f.sc_.emit_end();
 }
 void If_Op::sc_exec(SC_Frame& f) const
 {
     auto arg1 = sc_eval_expr(f, *arg1_, SC_Type::Bool());
-    f.sc_.out() << "  if ("<<arg1<<") {\n";
+    f.sc_.emit_if(arg1);
     arg2_->sc_exec(f);
-    f.sc_.out() << "  }\n";
+    f.sc_.emit_end();
 }
 void While_Op::sc_exec(SC_Frame& f) const
 {
     f.sc_.opcaches_.emplace_back(Op_Cache{});
-    f.sc_.out() << "  while (true) {\n";
+    f.sc_.emit_while();
     auto cond = sc_eval_expr(f, *cond_, SC_Type::Bool());
-    f.sc_.out() << "  if (!"<<cond<<") break;\n";
+    f.sc_.emit_break_unless(cond);
     body_->sc_exec(f);
-    f.sc_.out() << "  }\n";
+    f.sc_.emit_end();
     f.sc_.opcaches_.pop_back();
 }
 void For_Op::sc_exec(SC_Frame& f) const
 {
-  #define RANGE_EXPRESSIONS 1
     auto range = cast<const Range_Expr>(list_);
     if (range == nullptr)
         throw Exception(At_SC_Phrase(list_->syntax_, f),
             "not a range");
-  #if RANGE_EXPRESSIONS
     // range arguments are general expressions
     auto first = sc_eval_expr(f, *range->arg1_, SC_Type::Num());
     auto last = sc_eval_expr(f, *range->arg2_, SC_Type::Num());
     auto step = range->arg3_ != nullptr
         ? sc_eval_expr(f, *range->arg3_, SC_Type::Num())
         : sc_eval_const(f, Value{1.0}, *syntax_);
-  #else
-    // range arguments are constants
-    double first = sc_constify(*range->arg1_, f)
-        .to_num(At_SC_Phrase(range->arg1_->syntax_, f));
-    double last = sc_constify(*range->arg2_, f)
-        .to_num(At_SC_Phrase(range->arg2_->syntax_, f));
-    double step = range->arg3_ != nullptr
-        ? sc_constify(*range->arg3_, f)
-          .to_num(At_SC_Phrase(range->arg3_->syntax_, f))
-        : 1.0;
-  #endif
     auto i = f.sc_.newvalue(SC_Type::Num());
     f.sc_.opcaches_.emplace_back(Op_Cache{});
-  #if RANGE_EXPRESSIONS
-    f.sc_.out() << "  for (float " << i << "=" << first << ";"
-             << i << (range->half_open_ ? "<" : "<=") << last << ";"
-             << i << "+=" << step << ") {\n";
-  #else
-    f.sc_.out() << "  for (float " << i << "=" << dfmt(first, dfmt::EXPR) << ";"
-             << i << (range->half_open_ ? "<" : "<=") << dfmt(last, dfmt::EXPR) << ";"
-             << i << "+=" << dfmt(step, dfmt::EXPR) << ") {\n";
-  #endif
+    f.sc_.emit_for(i, first, range->half_open_, last, step);
     pattern_->sc_exec(i, At_SC_Phrase(list_->syntax_, f), f);
     if (cond_) {
         auto cond = sc_eval_expr(f, *cond_, SC_Type::Bool());
-        f.sc_.out() << "  if (!"<<cond<<") break;\n";
+        f.sc_.emit_break_unless(cond);
     }
     body_->sc_exec(f);
-    f.sc_.out() << "  }\n";
+    f.sc_.emit_end();
     f.sc_.opcaches_.pop_back();
 }
 
 SC_Value sc_vec_element(SC_Frame& f, SC_Value vec, int i)
 {
     SC_Value r = f.sc_.newvalue(vec.type.abase());
-    f.sc_.out() << "  " << r.type << " " << r << " = "
-        << vec << "[" << i << "];\n";
+    f.sc_.emit_element(r, vec, i);
     return r;
 }
 
@@ -1055,8 +1312,7 @@ SC_Value sc_binop(
     SC_Frame& f, SC_Type rtype, SC_Value x, const char* op, SC_Value y)
 {
     auto result = f.sc_.newvalue(rtype);
-    f.sc_.out() << "  " << rtype << " " << result << " = "
-        << x << op << y << ";\n";
+    f.sc_.emit_binop(result, x, op, y);
     return result;
 }
 
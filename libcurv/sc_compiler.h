@@ -12,13 +12,16 @@
 
 namespace curv {
 
+struct At_SC_Phrase;
 struct Context;
 struct Function;
+struct SC_VM;
 struct System;
 
 /// SubCurv is a low level, strongly-typed subset of Curv
 /// that can be efficiently translated into a low level language (currently
-/// C++ or GLSL), for fast evaluation on a CPU or GPU.
+/// C++ or GLSL, or bytecode for the SubCurv VM), for fast evaluation on a
+/// CPU or GPU.
 ///
 /// SubCurv is a set of types and operations on those types. It is a statically
 /// typed subset of Curv which is also a subset of GLSL (but with different
@@ -36,7 +39,8 @@ struct System;
 enum class SC_Target
 {
     glsl,   // output GLSL code
-    cpp     // output C++ code using GLM library
+    cpp,    // output C++ code using GLM library
+    vm      // generate bytecode for SC_VM
 };
 
 struct Op_Hash
@@ -66,6 +70,7 @@ struct SC_Compiler
     std::stringstream body_{};
     bool in_constants_ = false;
     SC_Target target_;
+    SC_VM* vm_;
     unsigned valcount_;
     System &system_;
     std::unordered_map<Value, SC_Value, Value::Hash, Value::Hash_Eq>
@@ -74,10 +79,21 @@ struct SC_Compiler
 
     SC_Compiler(std::ostream& s, SC_Target t, System& sys)
     :
-        out_(s), target_(t), valcount_(0), system_(sys)
+        out_(s), target_(t), vm_(nullptr), valcount_(0), system_(sys)
     {
     }
 
+    // Generate code for the SubCurv VM. Nothing is written to `s`.
+    SC_Compiler(std::ostream& s, SC_VM& vm, System& sys)
+    :
+        out_(s), target_(SC_Target::vm), vm_(&vm), valcount_(0), system_(sys)
+    {
+    }
+
+    // Statements are normally generated by the emit_* functions below.
+    // GLSL/C++ code for types and operations that the SubCurv VM doesn't
+    // support (arrays, matrices, Bool32) is written directly to out().
+    // For the VM target, a function containing such code is rejected.
     std::ostream& out()
     {
         if (in_constants_)
@@ -86,6 +102,9 @@ struct SC_Compiler
             return body_;
     }
 
+    // The VM code generator, for SC_Target::vm.
+    SC_VM& vm();
+
     // This is the main entry point to the Shape Compiler.
     void define_function(
         const char* name, SC_Type param_type, SC_Type result_type,
@@ -97,6 +116,11 @@ struct SC_Compiler
         Shared<const Function> func,
         const Context& cx);
 
+    void put_prologue(const char* name,
+        const std::vector<SC_Value>& params, SC_Type result_type);
+    void define_batch_function(
+        const char* name, SC_Type param_type, SC_Type result_type);
+
     void begin_function();
     void end_function();
 
@@ -105,27 +129,54 @@ struct SC_Compiler
         return SC_Value(valcount_++, type);
     }
 
-    // TODO: maybe add a member function for each operation that we support.
-    // Maybe these can later be virtual functions, so that this interface
-    // becomes generic for SPIR-V and LLVM code generation. Eg,
-    // SC_Value add(SC_Value x, SC_Value y)
-    // {
-    //     assert(x.type == SC_Type::num);
-    //     assert(y.type == SC_Type::num);
-    //     auto result = newvalue(SC_Type::num);
-    //     out << result << "=" << x << "+" << y << ";\n";
-    //     return result;
-    // }
-    //
-    // This API looks handy for code generation for built-in shapes
-    // with built-in dist functions. You can nest these function calls,
-    // it would look Lispy. sc.sqrt(sc.add(sc.square(x), sc.square(y)))
-    //
-    // The caller is responsible for passing arguments (to `add`) of the
-    // correct type. (Otherwise, there is an assertion failure.)
-    // Only the caller has enough context to arrange for expressive exceptions
-    // to report a shape argument of the wrong type, or a failure of static
-    // type checking within a user-defined dist function.
+    // Code generation. Each function emits one SSA statement, either as
+    // GLSL/C++ code or as SubCurv VM code. `result` is a new SSA variable,
+    // created by newvalue(). The caller is responsible for passing arguments
+    // of the correct type: only the caller has enough context to report
+    // a type error.
+
+    // result = fn(args), where fn is a GLSL builtin function
+    void emit_call(SC_Value result, const char* fn,
+        std::initializer_list<SC_Value> args);
+    // result = T(args), where T is the type of result. This is a vector
+    // constructor, a type conversion, or a broadcast of a single scalar.
+    void emit_construct(SC_Value result, const SC_Value* args, unsigned n);
+    // result = op x, where op is "-", "!" or "~"
+    void emit_unop(SC_Value result, const char* op, SC_Value x);
+    // result = x op y, where op is a GLSL infix operator
+    void emit_binop(SC_Value result, SC_Value x, const char* op, SC_Value y);
+    // result = cond ? x : y
+    void emit_select(SC_Value result, SC_Value cond, SC_Value x, SC_Value y);
+    // result = vec[i]
+    void emit_element(SC_Value result, SC_Value vec, unsigned i);
+    // result = vec.xyz, where swizzle is 2 to 4 letters from "xyzw"
+    void emit_swizzle(SC_Value result, SC_Value vec, const char* swizzle);
+    // result = num
+    void emit_num(SC_Value result, double num);
+    // result = val, where val is a Value of type result.type
+    void emit_const(SC_Value result, Value val, const At_SC_Phrase& cx);
+    // Declare a mutable variable `var` with initial value `val`.
+    void emit_var(SC_Value var, SC_Value val);
+    // var = val
+    void emit_assign(SC_Value var, SC_Value val);
+    // var[i] = val
+    void emit_assign_element(SC_Value var, unsigned i, SC_Value val);
+
+    // Structured control flow. Each emit_if, emit_while and emit_for begins
+    // a block that is ended by emit_end.
+    void emit_if(SC_Value cond);
+    void emit_else();
+    void emit_while();
+    // for (i = first; i < last; i += step), or i <= last if !half_open
+    void emit_for(SC_Value i, SC_Value first, bool half_open,
+        SC_Value last, SC_Value step);
+    // Exit the innermost loop if cond is false.
+    void emit_break_unless(SC_Value cond);
+    void emit_end();
+
+    // TODO: Maybe the emit_* functions can later be virtual functions,
+    // so that this interface becomes generic for SPIR-V and LLVM code
+    // generation.
     //
     // Maybe SC_Compiler will track context for expressive exceptions?
     // There is no eval stack at this time, but there is a CSG tree,
@@ -138,7 +189,7 @@ SC_Value sc_eval_expr(SC_Frame&, const Operation& op, SC_Type);
 SC_Value sc_eval_num_or_vec(SC_Frame&, const Operation& op);
 SC_Value sc_eval_const(SC_Frame& f, Value val, const Phrase&);
 SC_Value sc_call_unary_numeric(SC_Frame&, const char*);
-void sc_put_as(SC_Frame& f, SC_Value val, const Context&, SC_Type type);
+SC_Value sc_convert(SC_Frame& f, SC_Value val, const Context&, SC_Type type);
 SC_Value sc_vec_element(SC_Frame&, SC_Value, int);
 void sc_struc_unify(SC_Frame& f, SC_Value& a, SC_Value& b, const Context& cx);
 bool sc_try_extend(SC_Frame& f, SC_Value& a, SC_Type b);
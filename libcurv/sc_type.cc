@@ -47,12 +47,17 @@ sc_type_of(Value v)
         return SC_Type::Num();
     else if (v.is_bool())
         return SC_Type::Bool();
-    else if (auto ls = v.dycast<List>()) {
-        auto n = ls->size();
+    else if (is_list(v)) {
+        size_t n = 0;
+        Value front;
+        visit_list(v.to_ref_unsafe(), [&](const auto& list) {
+            n = list.size();
+            if (n > 0) front = list[0];
+        });
         if (n == 0 || n > SC_Type::MAX_LIST)
             ;
         else {
-            auto ty = sc_type_of(ls->front());
+            auto ty = sc_type_of(front);
             if (ty.is_num_tensor()) {
                 // Try to upgrade to a larger numeric struc.
                 if (ty.is_num()) {
@@ -0,0 +1,659 @@
+// Copyright 2016-2019 Doug Moen
+// Licensed under the Apache License, version 2.0
+// See accompanying file LICENSE or https://www.apache.org/licenses/LICENSE-2.0
+
+#include <libcurv/sc_vm.h>
+
+#include <libcurv/context.h>
+#include <libcurv/exception.h>
+#include <libcurv/function.h>
+#include <libcurv/list.h>
+#include <libcurv/reactive.h>
+#include <libcurv/sc_compiler.h>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+
+namespace curv {
+
+enum class SC_VM::Opcode : unsigned char
+{
+    // data movement
+    konst,          // d[i] = consts_[k+i]
+    move,           // d = a
+    swizzle,        // d[i] = a[lane i of k], k holds 2 bits per lane
+    put,            // d[k..k+wa) = a, used to construct vectors
+
+    // elementwise operations; a scalar operand is broadcast over the lanes
+    neg, bnot, to_bool,
+    abs, sign, floor, ceil, trunc, round_even, fract, sqrt, inversesqrt,
+    exp, log, exp2, log2,
+    sin, cos, tan, asin, acos, atan, sinh, cosh, tanh, asinh, acosh, atanh,
+    add, sub, mul, div, mod, min, max, pow, atan2, step,
+    lt, le, gt, ge, eq, ne, band, bor,
+    clamp, mix, smoothstep,
+    select,         // d = a ? b : c
+
+    // operations on whole vectors
+    dot, length, distance, cross, normalize,
+    all_eq, any_ne, any, all,
+
+    // control flow: jump to instruction k
+    jump, jump_if_false, jump_if_true,
+};
+
+namespace {
+
+using Opcode = SC_VM::Opcode;
+
+inline float sc_min(float x, float y) { return y < x ? y : x; }
+inline float sc_max(float x, float y) { return x < y ? y : x; }
+
+} // namespace
+
+// An SSA variable, as seen by the VM: a register, the number of lanes,
+// and whether it is a number or boolean.
+struct SC_VM::Operand
+{
+    unsigned reg = 0;
+    unsigned width = 0;
+    bool is_bool = false;
+};
+
+void
+SC_VM::define_function(
+    SC_Type param_type, SC_Type result_type,
+    Shared<const Function> func, const Context& cx)
+{
+    if (!param_type.is_num_or_vec() || !result_type.is_num_or_vec())
+        throw Exception(cx,
+            "SubCurv VM: parameter and result must be numbers or vectors");
+    std::stringstream unused;
+    SC_Compiler sc(unused, *this, system_);
+    sc.define_function("f", param_type, result_type, func, cx);
+}
+
+void
+SC_VM::unsupported(const std::string& what)
+{
+    throw Exception(*cx_, stringify("SubCurv VM: unsupported: ", what));
+}
+
+// Numbers, booleans and vectors of these are stored in registers.
+// Other types are not supported.
+SC_VM::Operand
+SC_VM::operand(SC_Value val)
+{
+    SC_Type type = val.type;
+    if (!type.is_num_or_vec() && !type.is_bool_or_vec())
+        unsupported(stringify(type)->c_str());
+    if (val.index >= 0xFFFF)
+        unsupported("too many registers");
+    return Operand{val.index, type.count(), type.is_bool_or_vec()};
+}
+
+unsigned
+SC_VM::emit(Opcode op, unsigned width, unsigned dst,
+    Operand a, Operand b, Operand c, unsigned k)
+{
+    Instr in;
+    in.op = op;
+    in.width = width;
+    in.wa = a.width; in.wb = b.width; in.wc = c.width;
+    in.dst = dst;
+    in.a = a.reg; in.b = b.reg; in.c = c.reg;
+    in.k = k;
+    code().push_back(in);
+    return code().size() - 1;
+}
+
+void
+SC_VM::gen_begin(const std::vector<SC_Value>& params, const Context& cx)
+{
+    cx_ = &cx;
+    code_.clear();
+    init_code_.clear();
+    consts_.clear();
+    blocks_.clear();
+    in_constants_ = false;
+    if (params.size() != 1)
+        unsupported("function with more than one parameter");
+    Operand p = operand(params[0]);
+    param_reg_ = p.reg;
+    param_width_ = p.width;
+}
+
+void
+SC_VM::gen_end(SC_Value result, unsigned nvalues)
+{
+    Operand r = operand(result);
+    result_reg_ = r.reg;
+    result_width_ = r.width;
+    nregs_ = nvalues;
+
+    // The constants are computed first, so the jumps in the body move down.
+    unsigned offset = init_code_.size();
+    for (auto& in : code_) {
+        if (in.op == Opcode::jump || in.op == Opcode::jump_if_false
+            || in.op == Opcode::jump_if_true)
+        {
+            in.k += offset;
+        }
+    }
+    code_.insert(code_.begin(), init_code_.begin(), init_code_.end());
+    init_code_.clear();
+    cx_ = nullptr;
+}
+
+// Elementwise operation, broadcasting scalar operands.
+void
+SC_VM::elementwise(Opcode op, SC_Value result, const SC_Value* args, unsigned n)
+{
+    Operand r = operand(result);
+    Operand a[3];
+    for (unsigned i = 0; i < n; ++i) {
+        a[i] = operand(args[i]);
+        if (a[i].width != 1 && a[i].width != r.width)
+            unsupported("vector size mismatch");
+    }
+    emit(op, r.width, r.reg, a[0], a[1], a[2], 0);
+}
+
+void
+SC_VM::gen_call(SC_Value result, const char* fn,
+    const SC_Value* args, unsigned n)
+{
+    std::string name = fn;
+    struct Fun { const char* name; unsigned nargs; Opcode op; };
+    static const Fun elementwise_funs[] = {
+        {"abs", 1, Opcode::abs}, {"sign", 1, Opcode::sign},
+        {"floor", 1, Opcode::floor}, {"ceil", 1, Opcode::ceil},
+        {"trunc", 1, Opcode::trunc}, {"roundEven", 1, Opcode::round_even},
+        {"fract", 1, Opcode::fract}, {"sqrt", 1, Opcode::sqrt},
+        {"inversesqrt", 1, Opcode::inversesqrt},
+        {"exp", 1, Opcode::exp}, {"log", 1, Opcode::log},
+        {"exp2", 1, Opcode::exp2}, {"log2", 1, Opcode::log2},
+        {"sin", 1, Opcode::sin}, {"cos", 1, Opcode::cos},
+        {"tan", 1, Opcode::tan}, {"asin", 1, Opcode::asin},
+        {"acos", 1, Opcode::acos}, {"atan", 1, Opcode::atan},
+        {"sinh", 1, Opcode::sinh}, {"cosh", 1, Opcode::cosh},
+        {"tanh", 1, Opcode::tanh}, {"asinh", 1, Opcode::asinh},
+        {"acosh", 1, Opcode::acosh}, {"atanh", 1, Opcode::atanh},
+        {"atan", 2, Opcode::atan2},
+        {"min", 2, Opcode::min}, {"max", 2, Opcode::max},
+        {"pow", 2, Opcode::pow}, {"mod", 2, Opcode::mod},
+        {"step", 2, Opcode::step},
+        {"clamp", 3, Opcode::clamp}, {"smoothstep", 3, Opcode::smoothstep},
+        {"equal", 2, Opcode::eq}, {"notEqual", 2, Opcode::ne},
+        {"lessThan", 2, Opcode::lt}, {"lessThanEqual", 2, Opcode::le},
+        {"greaterThan", 2, Opcode::gt},
+        {"greaterThanEqual", 2, Opcode::ge},
+        {"not", 1, Opcode::bnot},
+    };
+    for (auto& f : elementwise_funs) {
+        if (name == f.name && n == f.nargs) {
+            elementwise(f.op, result, args, n);
+            return;
+        }
+    }
+    if (name == "mix" && n == 3) {
+        if (args[2].type.is_bool_or_vec()) {
+            // mix(x, y, bvec) selects y where the condition is true
+            SC_Value sargs[3] = {args[2], args[1], args[0]};
+            elementwise(Opcode::select, result, sargs, 3);
+        } else
+            elementwise(Opcode::mix, result, args, 3);
+        return;
+    }
+
+    // operations on whole vectors
+    Operand r = operand(result);
+    Operand a[2];
+    for (unsigned i = 0; i < n && i < 2; ++i)
+        a[i] = operand(args[i]);
+    Opcode op;
+    if ((name == "any" || name == "all") && n == 1)
+        op = name == "any" ? Opcode::any : Opcode::all;
+    else if (name == "length" && n == 1)
+        op = Opcode::length;
+    else if (name == "normalize" && n == 1)
+        op = Opcode::normalize;
+    else if (name == "dot" && n == 2 && a[0].width == a[1].width)
+        op = Opcode::dot;
+    else if (name == "distance" && n == 2 && a[0].width == a[1].width)
+        op = Opcode::distance;
+    else if (name == "cross" && n == 2 && a[0].width == 3 && a[1].width == 3)
+        op = Opcode::cross;
+    else
+        unsupported(stringify("function ", name)->c_str());
+    emit(op, r.width, r.reg, a[0], a[1], Operand{}, 0);
+}
+
+void
+SC_VM::gen_construct(SC_Value result, const SC_Value* args, unsigned n)
+{
+    Operand r = operand(result);
+    if (n == 1) {
+        Operand a = operand(args[0]);
+        if (a.width == r.width) {
+            // type conversion
+            if (r.is_bool && !a.is_bool)
+                emit(Opcode::to_bool, r.width, r.reg, a, {}, {}, 0);
+            else
+                emit(Opcode::move, r.width, r.reg, a, {}, {}, 0);
+            return;
+        }
+        if (a.width == 1 && a.is_bool == r.is_bool) {
+            // broadcast a scalar
+            emit(Opcode::swizzle, r.width, r.reg, a, {}, {}, 0);
+            return;
+        }
+        unsupported("type conversion");
+    }
+    unsigned lane = 0;
+    for (unsigned i = 0; i < n; ++i) {
+        Operand a = operand(args[i]);
+        if (a.is_bool != r.is_bool || lane + a.width > r.width)
+            unsupported("vector constructor");
+        emit(Opcode::put, r.width, r.reg, a, {}, {}, lane);
+        lane += a.width;
+    }
+    if (lane != r.width)
+        unsupported("vector constructor");
+}
+
+void
+SC_VM::gen_unop(SC_Value result, const char* op, SC_Value x)
+{
+    if (strcmp(op, "-") == 0)
+        elementwise(Opcode::neg, result, &x, 1);
+    else if (strcmp(op, "!") == 0)
+        elementwise(Opcode::bnot, result, &x, 1);
+    else
+        unsupported(stringify("operator ", op)->c_str());
+}
+
+void
+SC_VM::gen_binop(SC_Value result, SC_Value x, const char* op, SC_Value y)
+{
+    struct Binop { const char* name; Opcode op; };
+    static const Binop elementwise_ops[] = {
+        {"+", Opcode::add}, {"-", Opcode::sub},
+        {"*", Opcode::mul}, {"/", Opcode::div},
+        {"<", Opcode::lt}, {"<=", Opcode::le},
+        {">", Opcode::gt}, {">=", Opcode::ge},
+        {"&&", Opcode::band}, {"||", Opcode::bor},
+    };
+    SC_Value args[2] = {x, y};
+    for (auto& b : elementwise_ops) {
+        if (strcmp(op, b.name) == 0) {
+            elementwise(b.op, result, args, 2);
+            return;
+        }
+    }
+    bool eq = strcmp(op, "==") == 0;
+    if (eq || strcmp(op, "!=") == 0) {
+        // Comparing two vectors gives a single boolean.
+        Operand a = operand(x), b = operand(y);
+        if (a.width != b.width)
+            unsupported("vector size mismatch");
+        Opcode cmp = a.width == 1
+            ? (eq ? Opcode::eq : Opcode::ne)
+            : (eq ? Opcode::all_eq : Opcode::any_ne);
+        emit(cmp, 1, operand(result).reg, a, b, {}, 0);
+        return;
+    }
+    unsupported(stringify("operator ", op)->c_str());
+}
+
+void
+SC_VM::gen_select(SC_Value result, SC_Value cond, SC_Value x, SC_Value y)
+{
+    if (operand(cond).width != 1)
+        unsupported("vector condition");
+    SC_Value args[3] = {cond, x, y};
+    elementwise(Opcode::select, result, args, 3);
+}
+
+void
+SC_VM::gen_element(SC_Value result, SC_Value vec, unsigned i)
+{
+    Operand v = operand(vec);
+    if (i >= v.width)
+        unsupported("vector index out of range");
+    emit(Opcode::swizzle, 1, operand(result).reg, v, {}, {}, i);
+}
+
+void
+SC_VM::gen_swizzle(SC_Value result, SC_Value vec, const char* swizzle)
+{
+    Operand v = operand(vec);
+    Operand r = operand(result);
+    unsigned k = 0;
+    for (unsigned i = 0; i < r.width; ++i) {
+        unsigned lane = strchr("xyzw", swizzle[i]) - "xyzw";
+        if (lane >= v.width)
+            unsupported("swizzle out of range");
+        k |= lane << (2*i);
+    }
+    emit(Opcode::swizzle, r.width, r.reg, v, {}, {}, k);
+}
+
+void
+SC_VM::gen_num(SC_Value result, double num)
+{
+    Operand r = operand(result);
+    consts_.push_back(num);
+    emit(Opcode::konst, 1, r.reg, {}, {}, {}, consts_.size() - 1);
+}
+
+void
+SC_VM::gen_const(SC_Value result, Value val, const Context& cx)
+{
+    Operand r = operand(result);
+    if (val.dycast<Reactive_Value>())
+        unsupported("reactive values");
+    unsigned k = consts_.size();
+    if (r.width == 1) {
+        consts_.push_back(r.is_bool ? val.to_bool(cx) : val.to_num(cx));
+    } else {
+        auto list = val.to<const List>(cx);
+        list->assert_size(r.width, cx);
+        for (auto e : *list) {
+            if (e.dycast<Reactive_Value>())
+                unsupported("reactive values");
+            consts_.push_back(r.is_bool ? e.to_bool(cx) : e.to_num(cx));
+        }
+    }
+    emit(Opcode::konst, r.width, r.reg, {}, {}, {}, k);
+}
+
+void
+SC_VM::gen_assign(SC_Value var, SC_Value val)
+{
+    Operand v = operand(var);
+    Operand a = operand(val);
+    if (a.width != v.width)
+        unsupported("type mismatch in assignment");
+    if (a.reg != v.reg)
+        emit(Opcode::move, v.width, v.reg, a, {}, {}, 0);
+}
+
+void
+SC_VM::gen_assign_element(SC_Value var, unsigned i, SC_Value val)
+{
+    Operand v = operand(var);
+    Operand a = operand(val);
+    if (i >= v.width || a.width != 1)
+        unsupported("vector element assignment");
+    emit(Opcode::put, v.width, v.reg, a, {}, {}, i);
+}
+
+void
+SC_VM::gen_if(SC_Value cond)
+{
+    Block b{Block::if_block};
+    b.patch = emit(Opcode::jump_if_false, 0, 0, operand(cond), {}, {}, 0);
+    blocks_.push_back(b);
+}
+
+void
+SC_VM::gen_else()
+{
+    if (blocks_.empty() || blocks_.back().kind != Block::if_block)
+        unsupported("else without if");
+    Block& b = blocks_.back();
+    unsigned patch = emit(Opcode::jump, 0, 0, {}, {}, {}, 0);
+    code_[b.patch].k = code_.size();
+    b.kind = Block::else_block;
+    b.patch = patch;
+}
+
+void
+SC_VM::gen_while()
+{
+    Block b{Block::loop};
+    b.start = code_.size();
+    blocks_.push_back(b);
+}
+
+void
+SC_VM::gen_for(SC_Value i, SC_Value first, bool half_open,
+    SC_Value last, SC_Value step, SC_Value test)
+{
+    gen_assign(i, first);
+    Block b{Block::loop};
+    b.start = code_.size();
+    SC_Value args[2] = {i, last};
+    elementwise(half_open ? Opcode::lt : Opcode::le, test, args, 2);
+    b.breaks.push_back(
+        emit(Opcode::jump_if_false, 0, 0, operand(test), {}, {}, 0));
+    b.has_step = true;
+    b.var = i;
+    b.step = step;
+    blocks_.push_back(b);
+}
+
+void
+SC_VM::gen_break_unless(SC_Value cond)
+{
+    for (auto b = blocks_.rbegin(); b != blocks_.rend(); ++b) {
+        if (b->kind == Block::loop) {
+            b->breaks.push_back(
+                emit(Opcode::jump_if_false, 0, 0, operand(cond), {}, {}, 0));
+            return;
+        }
+    }
+    unsupported("break outside of loop");
+}
+
+void
+SC_VM::gen_end_block()
+{
+    if (blocks_.empty())
+        unsupported("unbalanced block");
+    Block b = blocks_.back();
+    blocks_.pop_back();
+    if (b.kind == Block::loop) {
+        if (b.has_step) {
+            SC_Value args[2] = {b.var, b.step};
+            elementwise(Opcode::add, b.var, args, 2);
+        }
+        emit(Opcode::jump, 0, 0, {}, {}, {}, b.start);
+        for (auto j : b.breaks)
+            code_[j].k = code_.size();
+    } else
+        code_[b.patch].k = code_.size();
+}
+
+void
+SC_VM::call(const float* arg, float* result) const
+{
+    struct Reg { float v[4]; };
+    // A grow-only register file per thread, so that calls don't allocate.
+    static thread_local std::vector<Reg> regfile;
+    if (regfile.size() < nregs_)
+        regfile.resize(nregs_);
+    Reg* r = regfile.data();
+    const float* konst = consts_.data();
+
+    memcpy(r[param_reg_].v, arg, param_width_ * sizeof(float));
+
+    const Instr* code = code_.data();
+    unsigned ncode = code_.size();
+    for (unsigned pc = 0; pc < ncode; ) {
+        const Instr& in = code[pc++];
+        float* d = r[in.dst].v;
+        const float* a = r[in.a].v;
+        const float* b = r[in.b].v;
+        const float* c = r[in.c].v;
+        // stride 0 broadcasts a scalar operand over all lanes
+        unsigned sa = in.wa > 1, sb = in.wb > 1, sc = in.wc > 1;
+        unsigned w = in.width;
+
+      #define UNARY(expr) \
+        for (unsigned i = 0; i < w; ++i) { \
+            float x = a[i*sa]; (void)x; d[i] = (expr); } \
+        break;
+      #define BINARY(expr) \
+        for (unsigned i = 0; i < w; ++i) { \
+            float x = a[i*sa], y = b[i*sb]; d[i] = (expr); } \
+        break;
+      #define TERNARY(expr) \
+        for (unsigned i = 0; i < w; ++i) { \
+            float x = a[i*sa], y = b[i*sb], z = c[i*sc]; d[i] = (expr); } \
+        break;
+
+        switch (in.op) {
+        case Opcode::konst:
+            memcpy(d, konst + in.k, w * sizeof(float));
+            break;
+        case Opcode::move: memmove(d, a, w * sizeof(float)); break;
+        case Opcode::swizzle:
+          {
+            float t[4];
+            for (unsigned i = 0; i < w; ++i)
+                t[i] = a[(in.k >> (2*i)) & 3];
+            memcpy(d, t, w * sizeof(float));
+            break;
+          }
+        case Opcode::put: memmove(d + in.k, a, in.wa * sizeof(float)); break;
+
+        case Opcode::neg: UNARY(-x)
+        case Opcode::bnot: UNARY(x == 0.0f ? 1.0f : 0.0f)
+        case Opcode::to_bool: UNARY(x != 0.0f ? 1.0f : 0.0f)
+        case Opcode::abs: UNARY(std::fabs(x))
+        case Opcode::sign: UNARY(x > 0.0f ? 1.0f : x < 0.0f ? -1.0f : 0.0f)
+        case Opcode::floor: UNARY(std::floor(x))
+        case Opcode::ceil: UNARY(std::ceil(x))
+        case Opcode::trunc: UNARY(std::trunc(x))
+        case Opcode::round_even: UNARY(std::nearbyint(x))
+        case Opcode::fract: UNARY(x - std::floor(x))
+        case Opcode::sqrt: UNARY(std::sqrt(x))
+        case Opcode::inversesqrt: UNARY(1.0f / std::sqrt(x))
+        case Opcode::exp: UNARY(std::exp(x))
+        case Opcode::log: UNARY(std::log(x))
+        case Opcode::exp2: UNARY(std::exp2(x))
+        case Opcode::log2: UNARY(std::log2(x))
+        case Opcode::sin: UNARY(std::sin(x))
+        case Opcode::cos: UNARY(std::cos(x))
+        case Opcode::tan: UNARY(std::tan(x))
+        case Opcode::asin: UNARY(std::asin(x))
+        case Opcode::acos: UNARY(std::acos(x))
+        case Opcode::atan: UNARY(std::atan(x))
+        case Opcode::sinh: UNARY(std::sinh(x))
+        case Opcode::cosh: UNARY(std::cosh(x))
+        case Opcode::tanh: UNARY(std::tanh(x))
+        case Opcode::asinh: UNARY(std::asinh(x))
+        case Opcode::acosh: UNARY(std::acosh(x))
+        case Opcode::atanh: UNARY(std::atanh(x))
+
+        case Opcode::add: BINARY(x + y)
+        case Opcode::sub: BINARY(x - y)
+        case Opcode::mul: BINARY(x * y)
+        case Opcode::div: BINARY(x / y)
+        case Opcode::mod: BINARY(x - y * std::floor(x / y))
+        case Opcode::min: BINARY(sc_min(x, y))
+        case Opcode::max: BINARY(sc_max(x, y))
+        case Opcode::pow: BINARY(std::pow(x, y))
+        case Opcode::atan2: BINARY(std::atan2(x, y))
+        case Opcode::step: BINARY(y < x ? 0.0f : 1.0f)
+        case Opcode::lt: BINARY(float(x < y))
+        case Opcode::le: BINARY(float(x <= y))
+        case Opcode::gt: BINARY(float(x > y))
+        case Opcode::ge: BINARY(float(x >= y))
+        case Opcode::eq: BINARY(float(x == y))
+        case Opcode::ne: BINARY(float(x != y))
+        case Opcode::band: BINARY(float(x != 0.0f && y != 0.0f))
+        case Opcode::bor: BINARY(float(x != 0.0f || y != 0.0f))
+
+        case Opcode::clamp: TERNARY(sc_min(sc_max(x, y), z))
+        case Opcode::mix: TERNARY(x * (1.0f - z) + y * z)
+        case Opcode::smoothstep:
+            TERNARY((z = sc_min(sc_max((z - x) / (y - x), 0.0f), 1.0f),
+                     z * z * (3.0f - 2.0f * z)))
+        case Opcode::select: TERNARY(x != 0.0f ? y : z)
+
+        case Opcode::dot:
+          {
+            float s = 0.0f;
+            for (unsigned i = 0; i < in.wa; ++i) s += a[i] * b[i];
+            d[0] = s;
+            break;
+          }
+        case Opcode::length:
+          {
+            float s = 0.0f;
+            for (unsigned i = 0; i < in.wa; ++i) s += a[i] * a[i];
+            d[0] = std::sqrt(s);
+            break;
+          }
+        case Opcode::distance:
+          {
+            float s = 0.0f;
+            for (unsigned i = 0; i < in.wa; ++i) {
+                float t = a[i] - b[i];
+                s += t * t;
+            }
+            d[0] = std::sqrt(s);
+            break;
+          }
+        case Opcode::cross:
+          {
+            float t[3] = {
+                a[1] * b[2] - b[1] * a[2],
+                a[2] * b[0] - b[2] * a[0],
+                a[0] * b[1] - b[0] * a[1] };
+            memcpy(d, t, sizeof(t));
+            break;
+          }
+        case Opcode::normalize:
+          {
+            float s = 0.0f;
+            for (unsigned i = 0; i < w; ++i) s += a[i] * a[i];
+            s = 1.0f / std::sqrt(s);
+            for (unsigned i = 0; i < w; ++i) d[i] = a[i] * s;
+            break;
+          }
+        case Opcode::all_eq:
+          {
+            bool t = true;
+            for (unsigned i = 0; i < in.wa; ++i) t = t && a[i] == b[i];
+            d[0] = t;
+            break;
+          }
+        case Opcode::any_ne:
+          {
+            bool t = false;
+            for (unsigned i = 0; i < in.wa; ++i) t = t || a[i] != b[i];
+            d[0] = t;
+            break;
+          }
+        case Opcode::any:
+          {
+            bool t = false;
+            for (unsigned i = 0; i < in.wa; ++i) t = t || a[i] != 0.0f;
+            d[0] = t;
+            break;
+          }
+        case Opcode::all:
+          {
+            bool t = true;
+            for (unsigned i = 0; i < in.wa; ++i) t = t && a[i] != 0.0f;
+            d[0] = t;
+            break;
+          }
+
+        case Opcode::jump: pc = in.k; break;
+        case Opcode::jump_if_false: if (a[0] == 0.0f) pc = in.k; break;
+        case Opcode::jump_if_true: if (a[0] != 0.0f) pc = in.k; break;
+        }
+      #undef UNARY
+      #undef BINARY
+      #undef TERNARY
+    }
+
+    memcpy(result, r[result_reg_].v, result_width_ * sizeof(float));
+}
+
+} // namespace curv
@@ -0,0 +1,117 @@
+// Copyright 2016-2019 Doug Moen
+// Licensed under the Apache License, version 2.0
+// See accompanying file LICENSE or https://www.apache.org/licenses/LICENSE-2.0
+
+#ifndef LIBCURV_SC_VM_H
+#define LIBCURV_SC_VM_H
+
+#include <libcurv/sc_frame.h>
+#include <string>
+#include <vector>
+
+namespace curv {
+
+struct Context;
+struct Function;
+struct System;
+
+/// The SubCurv virtual machine: an in-process alternative to compiling
+/// SubCurv to C++ and running the C++ compiler.
+///
+/// A function is compiled by SC_Compiler, using SC_Target::vm. Instead of
+/// printing GLSL or C++ code, the compiler calls the gen_* functions below
+/// for each SSA operation, and these generate a compact register bytecode.
+/// The SSA variable with index i is stored in register i, which holds an
+/// unboxed float, vec2, vec3 or vec4 (booleans are stored as 0 or 1).
+/// Compilation takes milliseconds, and evaluation does no memory allocation.
+///
+/// Matrices, arrays and Bool32 values are not supported: `define_function`
+/// throws an Exception, and the caller should fall back to the interpreter.
+///
+/// After compilation, `call` is thread safe.
+struct SC_VM
+{
+    enum class Opcode : unsigned char;
+    struct Instr
+    {
+        Opcode op;
+        unsigned char width;    // number of lanes in the result
+        unsigned char wa, wb, wc; // number of lanes in each operand
+        unsigned short dst, a, b, c;
+        unsigned k;             // lane selector, constant index or jump target
+    };
+
+    System& system_;
+    std::vector<Instr> code_{};
+    std::vector<float> consts_{};
+    unsigned nregs_ = 0;
+    unsigned param_reg_ = 0;
+    unsigned param_width_ = 0;
+    unsigned result_reg_ = 0;
+    unsigned result_width_ = 0;
+
+    SC_VM(System& sys) : system_(sys) {}
+
+    // Compile a function that maps a number or vector to a number or vector.
+    void define_function(
+        SC_Type param_type, SC_Type result_type,
+        Shared<const Function> func, const Context&);
+
+    // Call the function. `arg` and `result` are arrays of floats,
+    // one per vector component.
+    void call(const float* arg, float* result) const;
+
+    // Code generator interface, used by SC_Compiler. The arguments have
+    // the same meaning as for the corresponding SC_Compiler::emit_* function.
+    // Code for constants is generated into a separate block (if in_constants_
+    // is true), which is placed at the start of the function.
+    bool in_constants_ = false;
+    void gen_begin(const std::vector<SC_Value>& params, const Context&);
+    void gen_end(SC_Value result, unsigned nvalues);
+    void gen_call(SC_Value result, const char* fn,
+        const SC_Value* args, unsigned n);
+    void gen_construct(SC_Value result, const SC_Value* args, unsigned n);
+    void gen_unop(SC_Value result, const char* op, SC_Value x);
+    void gen_binop(SC_Value result, SC_Value x, const char* op, SC_Value y);
+    void gen_select(SC_Value result, SC_Value cond, SC_Value x, SC_Value y);
+    void gen_element(SC_Value result, SC_Value vec, unsigned i);
+    void gen_swizzle(SC_Value result, SC_Value vec, const char* swizzle);
+    void gen_num(SC_Value result, double num);
+    void gen_const(SC_Value result, Value val, const Context&);
+    void gen_assign(SC_Value var, SC_Value val);
+    void gen_assign_element(SC_Value var, unsigned i, SC_Value val);
+    void gen_if(SC_Value cond);
+    void gen_else();
+    void gen_while();
+    // `test` is a Bool temporary for the loop condition.
+    void gen_for(SC_Value i, SC_Value first, bool half_open,
+        SC_Value last, SC_Value step, SC_Value test);
+    void gen_break_unless(SC_Value cond);
+    void gen_end_block();
+
+private:
+    struct Operand;
+    struct Block
+    {
+        enum Kind { if_block, else_block, loop } kind;
+        unsigned patch;                 // jump to be patched at end of block
+        unsigned start;                 // start of loop
+        std::vector<unsigned> breaks{}; // jumps to end of loop
+        bool has_step = false;          // for loop increment
+        SC_Value var, step;
+    };
+    const Context* cx_ = nullptr;       // the function being compiled
+    std::vector<Instr> init_code_{};    // code for constants
+    std::vector<Block> blocks_{};
+
+    [[noreturn]] void unsupported(const std::string& what);
+    Operand operand(SC_Value);
+    std::vector<Instr>& code() { return in_constants_ ? init_code_ : code_; }
+    unsigned emit(Opcode op, unsigned width, unsigned dst,
+        Operand a, Operand b, Operand c, unsigned k);
+    void elementwise(Opcode op, SC_Value result,
+        const SC_Value* args, unsigned n);
+};
+
+} // namespace curv
+#endif // header guard
@@ -158,21 +158,98 @@ Shape_Program::Shape_Program(
             "bad parametric shape: call result has no 'colour' field: ", r)};
 }
 
+std::unique_ptr<Shape_Program>
+Shape_Program::clone_for_thread() const
+{
+    record_->publish();
+    dist_fun_->publish();
+    colour_fun_->publish();
+
+    auto s = std::make_unique<Shape_Program>(system_, nub_);
+    s->is_2d_ = is_2d_;
+    s->is_3d_ = is_3d_;
+    s->bbox_ = bbox_;
+    s->record_ = record_;
+    s->dist_fun_ = dist_fun_;
+    s->colour_fun_ = colour_fun_;
+    s->dist_frame_ = Frame::make(
+        dist_fun_->nslots_, system_, nullptr, nullptr, nullptr);
+    s->colour_frame_ = Frame::make(
+        colour_fun_->nslots_, system_, nullptr, nullptr, nullptr);
+    s->viewed_shape_ = viewed_shape_;
+    return s;
+}
+
+void
+Shape::dist_batch(unsigned n, const float* const* in, float* const* out)
+{
+    for (unsigned i = 0; i < n; ++i)
+        out[0][i] = dist(in[0][i], in[1][i], in[2][i], in[3][i]);
+}
+
+void
+Shape::colour_batch(unsigned n, const float* const* in, float* const* out)
+{
+    for (unsigned i = 0; i < n; ++i) {
+        Vec3 c = colour(in[0][i], in[1][i], in[2][i], in[3][i]);
+        out[0][i] = c.x;
+        out[1][i] = c.y;
+        out[2][i] = c.z;
+    }
+}
+
+// Store the point [x,y,z,t] in the argument list `arg`, allocating a new list
+// if the previous one is still referenced by something other than `arg`.
+static Value
+point_arg(Shared<List>& arg, double x, double y, double z, double t)
+{
+    if (arg == nullptr || !arg->is_unique())
+        arg = List::make(4);
+    (*arg)[0] = Value{x};
+    (*arg)[1] = Value{y};
+    (*arg)[2] = Value{z};
+    (*arg)[3] = Value{t};
+    return {arg};
+}
+
+// Drop the references held by the slots of a reused call frame,
+// including the reference to the argument list.
+static void
+clear_frame(Frame& f)
+{
+    for (slot_t i = 0; i < f.size_; ++i)
+        f[i] = missing;
+}
+
 double
 Shape_Program::dist(double x, double y, double z, double t)
 {
+    Value result = dist_fun_->call(point_arg(dist_arg_, x, y, z, t),
+        *dist_frame_);
+    clear_frame(*dist_frame_);
+    if (result.is_num())
+        return result.to_num_unsafe();
     At_Program cx(*this);
-    Shared<List> point = List::make({Value{x}, Value{y}, Value{z}, Value{t}});
-    Value result = dist_fun_->call({point}, *dist_frame_);
     return result.to_num(cx);
 }
 
 Vec3
 Shape_Program::colour(double x, double y, double z, double t)
 {
+    Value result = colour_fun_->call(point_arg(colour_arg_, x, y, z, t),
+        *colour_frame_);
+    clear_frame(*colour_frame_);
+    if (auto c = result.dycast<const List>()) {
+        if (c->size() == 3
+            && c->at(0).is_num() && c->at(1).is_num() && c->at(2).is_num())
+        {
+            return Vec3{ c->at(0).to_num_unsafe(),
+                         c->at(1).to_num_unsafe(),
+                         c->at(2).to_num_unsafe() };
+        }
+    }
+    // report the error
     At_Program cx(*this);
-    Shared<List> point = List::make({Value{x}, Value{y}, Value{z}, Value{t}});
-    Value result = colour_fun_->call({point}, *colour_frame_);
     Shared<List> cval = result.to<List>(cx);
     cval->assert_size(3, cx);
     return Vec3{ cval->at(0).to_num(cx),
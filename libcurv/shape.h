@@ -61,6 +61,16 @@ struct Shape
     BBox bbox_;
     virtual double dist(double x, double y, double z, double t) = 0;
     virtual Vec3 colour(double x, double y, double z, double t) = 0;
+
+    // Batched versions of `dist` and `colour`, which evaluate N points.
+    // Points and results use structure-of-arrays layout: `in` points to
+    // 4 arrays of N floats (x, y, z, t), and `out` points to 1 array
+    // (distance) or 3 arrays (red, green, blue) of N floats.
+    // The default implementations call `dist` and `colour` once per point.
+    virtual void dist_batch(
+        unsigned n, const float* const* in, float* const* out);
+    virtual void colour_batch(
+        unsigned n, const float* const* in, float* const* out);
 };
 
 struct Shape_Program final : public Shape
@@ -84,6 +94,11 @@ struct Shape_Program final : public Shape
     std::unique_ptr<Frame> dist_frame_;
     std::unique_ptr<Frame> colour_frame_;
 
+    // The [x,y,z,t] argument lists passed to dist and colour. Each list is
+    // updated in place by the next call, unless the function kept a reference.
+    Shared<List> dist_arg_;
+    Shared<List> colour_arg_;
+
     Viewed_Shape* viewed_shape_ = nullptr;
 
     Shape_Program(Program&);
@@ -103,6 +118,12 @@ struct Shape_Program final : public Shape
     // that describes a parametric shape.
     Shape_Program(const Shape_Program&, Shared<Record>, Viewed_Shape*);
 
+    // Make a copy of this shape with its own call frames, so that another
+    // thread can call `dist` and `colour` at the same time as this one.
+    // The shape's values are published: do this before the threads start.
+    // Evaluation must then happen inside a Parallel_Section.
+    std::unique_ptr<Shape_Program> clone_for_thread() const;
+
     // Invoke the shape's `dist` function.
     double dist(double x, double y, double z, double t);
 
@@ -0,0 +1,33 @@
+// Copyright 2016-2019 Doug Moen
+// Licensed under the Apache License, version 2.0
+// See accompanying file LICENSE or https://www.apache.org/licenses/LICENSE-2.0
+
+#include <libcurv/shared.h>
+
+namespace curv {
+
+int Shared_Base::parallel_sections = 0;
+
+void
+parallel_add_ref(const Shared_Base* p)
+{
+    if (p->is_published())
+        __atomic_add_fetch(&p->use_count, 1, __ATOMIC_RELAXED);
+    else
+        ++p->use_count;
+}
+
+void
+parallel_release(const Shared_Base* p)
+{
+    if (p->is_published()) {
+        if (__atomic_sub_fetch(&p->use_count, 1, __ATOMIC_ACQ_REL)
+            == Shared_Base::published_bit)
+        {
+            delete p;
+        }
+    } else if (--p->use_count == 0)
+        delete p;
+}
+
+} // namespace curv
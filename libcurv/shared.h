@@ -64,9 +64,20 @@ template<typename T, class... Args> Shared<T> make(Args&&... args)
 
 /// Common base class for cheap reference-counted objects.
 ///
-/// For performance reasons, the use_count is incremented and decremented
-/// non-atomically, which is not thread safe. That's what you typically
-/// need in cases where `std::shared_ptr` is too expensive.
+/// For performance reasons, the use_count is normally incremented and
+/// decremented non-atomically, which is not thread safe. That's what you
+/// typically need in cases where `std::shared_ptr` is too expensive.
+///
+/// When an object is first constructed, it's only accessible from one thread.
+/// Before it "escapes" and becomes visible to more than one thread, it must
+/// be published, using `publish()`. This sets the `published_bit` in the
+/// use_count of the object and of every object reachable from it.
+/// While a Parallel_Section is active, the use_counts of published objects
+/// are updated atomically; the rest of the time, the cost is one extra test.
+/// A published object has a use_count that is never 1, so code that updates
+/// an object in place if it is the only reference (`is_unique()`) leaves
+/// published objects alone.
+/// Objects derived from Shared_Published_Base are published when constructed.
 ///
 /// The memory overhead is one use_count, instead of two for `std::shared_ptr`.
 /// Plus I'm forcing the use of a vtable. I specifically want the vtable pointer
@@ -118,6 +129,36 @@ struct Shared_Base
     virtual ~Shared_Base() {}
     mutable std::uint32_t use_count;
 
+    /// If this bit is set in use_count, the object may be shared between
+    /// threads, and use_count is updated atomically during a Parallel_Section.
+    static constexpr std::uint32_t published_bit = 0x80000000;
+
+    /// The number of active Parallel_Sections.
+    static int parallel_sections;
+
+    /// True if the caller holds the only reference to this object, so it
+    /// may be updated in place. This is never true for a published object.
+    bool is_unique() const
+    {
+        return __atomic_load_n(&use_count, __ATOMIC_RELAXED) == 1;
+    }
+
+    bool is_published() const
+    {
+        return __atomic_load_n(&use_count, __ATOMIC_RELAXED) & published_bit;
+    }
+
+    /// Make this object, and all objects reachable from it, safe to share
+    /// between threads. This must be called by the thread that owns the
+    /// object graph, before other threads can access it.
+    void publish() const
+    {
+        if (!is_published()) {
+            use_count |= published_bit;
+            publish_children();
+        }
+    }
+
     // operator new and delete are defined to invoke malloc and free
     // because subclasses of Shared_Base that implement variable-length objects
     // must use malloc for their heap allocation, and we must therefore
@@ -137,31 +178,73 @@ struct Shared_Base
     {
         free(p);
     }
+protected:
+    /// Publish the objects that this object holds references to.
+    /// Called once, by publish(). Classes that contain references to
+    /// other Shared_Base objects (directly, or via Values) override this.
+    virtual void publish_children() const {}
 private:
     // Shared_Base is non-copyable.
     Shared_Base(const Shared_Base&) = delete;
     Shared_Base& operator=(const Shared_Base&) = delete;
 };
 
+/// Base class for reference-counted objects that are published when they
+/// are constructed. It is used for immutable objects created by the compiler
+/// (phrases, meanings, patterns and so on), which are shared by every thread
+/// that evaluates the code, and which are not worth traversing in publish().
+/// A subclass that holds references to Values must publish them.
+struct Shared_Published_Base : public Shared_Base
+{
+    Shared_Published_Base() { use_count = published_bit; }
+};
+
+/// While a Parallel_Section exists, published objects may be used by more
+/// than one thread. Create it before starting the threads that share the
+/// objects, and destroy it after they are joined. Sections may be nested.
+struct Parallel_Section
+{
+    Parallel_Section()
+    {
+        __atomic_add_fetch(&Shared_Base::parallel_sections, 1,
+            __ATOMIC_SEQ_CST);
+    }
+    ~Parallel_Section()
+    {
+        __atomic_sub_fetch(&Shared_Base::parallel_sections, 1,
+            __ATOMIC_SEQ_CST);
+    }
+    Parallel_Section(const Parallel_Section&) = delete;
+    Parallel_Section& operator=(const Parallel_Section&) = delete;
+};
+
+// Out of line reference counting, used during a Parallel_Section.
+void parallel_add_ref(const Shared_Base*);
+void parallel_release(const Shared_Base*);
+
+inline bool in_parallel_section()
+{
+    return __builtin_expect(
+        __atomic_load_n(&Shared_Base::parallel_sections, __ATOMIC_RELAXED),
+        0);
+}
+
 inline void intrusive_ptr_add_ref(const Shared_Base* p)
 {
-    ++p->use_count;
+    if (in_parallel_section())
+        parallel_add_ref(p);
+    else
+        ++p->use_count;
 }
 
 inline void intrusive_ptr_release(const Shared_Base* p)
 {
-    if (--p->use_count == 0)
+    if (in_parallel_section())
+        parallel_release(p);
+    else if ((--p->use_count & ~Shared_Base::published_bit) == 0)
         delete p;
 }
 
-// How to support atomic refcount update in the future.
-// * Add a Shared_Atomic_Base class, which always uses atomic updates.
-// * Add a Shared_Maybe_Atomic_Base class, which reserves a bit in the
-//   use_count to indicate whether the use_count should be updated atomically.
-//   When an object is first constructed, it's only accessible from one thread.
-//   Later, it might "escape" and become visible to more than thread.
-//   If and when this happens, we mark the object as atomic.
-
 template<class T, class U>
 inline Shared<T>
 cast(Shared<U> p)
@@ -180,7 +263,8 @@ template<class T>
 inline Shared<T>
 share(T& obj)
 {
-    assert(obj.use_count > 0);
+    assert((__atomic_load_n(&obj.use_count, __ATOMIC_RELAXED)
+            & ~Shared_Base::published_bit) > 0);
     return Shared<T>(&obj);
 }
 
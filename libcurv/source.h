@@ -24,7 +24,7 @@ struct Context;
 /// Subclasses provide storage management for the contents.
 /// The contents can be null (different from zero length),
 /// in which case error messages only report the file name.
-struct Source : public Shared_Base, public Range<const char*>
+struct Source : public Shared_Published_Base, public Range<const char*>
 {
     enum class Type { curv, gpu };
 
@@ -34,12 +34,16 @@ protected:
     Source(String_Ref name, const char*f, const char*l)
     :
         Range(f,l), name_(std::move(name))
-    {}
+    {
+        name_->publish();
+    }
 public:
     Source(String_Ref name)
     :
         Range(nullptr,nullptr), name_(std::move(name))
-    {}
+    {
+        name_->publish();
+    }
     bool no_name() const { return name_->empty(); }
     bool no_contents() const { return first == nullptr; }
     virtual ~Source() {}
@@ -54,7 +58,9 @@ struct String_Source : public Source
     :
         Source(std::move(name), text->data(), text->data() + text->size()),
         text_(std::move(text))
-    {}
+    {
+        text_->publish();
+    }
 };
 
 /// A Source subclass that represents a file.
@@ -3,6 +3,7 @@
 // See accompanying file LICENSE or https://www.apache.org/licenses/LICENSE-2.0
 
 #include <libcurv/string.h>
+#include <algorithm>
 
 namespace curv {
 
@@ -17,8 +18,93 @@ make_string(const char* str, size_t len)
 Shared<String>
 String_Builder::get_string()
 {
-    auto s = str(); // copies the data
-    return make_string(s.data(), s.size()); // copies the data again
+    return buf_.release();
+}
+
+void
+String_Builder::append_int(long long n)
+{
+    if (n < 0) {
+        append('-');
+        append_uint(0ULL - (unsigned long long)n);
+    } else
+        append_uint(n);
+}
+
+void
+String_Builder::append_uint(unsigned long long n)
+{
+    char buf[24];
+    char* p = buf + sizeof(buf);
+    do {
+        *--p = char('0' + n % 10);
+        n /= 10;
+    } while (n != 0);
+    append(p, buf + sizeof(buf) - p);
+}
+
+// Grow the character array of string_ to hold at least `n` characters,
+// plus the trailing nul. The first String is allocated here.
+void
+String_Builder::Buffer::reserve(size_t n)
+{
+    size_t len = size();
+    size_t cap = string_ ? epptr() - pbase() : 0;
+    if (n <= cap)
+        return;
+    cap = std::max(std::max(n, 2*cap), size_t(32));
+    // sizeof(String) includes one char of data_, for the trailing nul.
+    void* raw = realloc((void*)string_, sizeof(String) + cap);
+    if (raw == nullptr)
+        throw std::bad_alloc();
+    if (string_ == nullptr)
+        new(raw) String(Ref_Value::ty_string);
+    string_ = (String*)raw;
+    setp(string_->data_, string_->data_ + cap);
+    pbump(int(len));
+}
+
+Shared<String>
+String_Builder::Buffer::release()
+{
+    if (string_ == nullptr)
+        return make_string("", 0);
+    size_t len = size();
+    // Return unused capacity. Usually, realloc shrinks the block in place.
+    String* s = string_;
+    if (epptr() - pptr() > 64) {
+        void* raw = realloc((void*)s, sizeof(String) + len);
+        if (raw != nullptr)
+            s = (String*)raw;
+    }
+    s->size_ = len;
+    s->data_[len] = '\0';
+    string_ = nullptr;
+    setp(nullptr, nullptr);
+    return Shared<String>{s};
+}
+
+auto String_Builder::Buffer::overflow(int_type c)
+-> int_type
+{
+    if (traits_type::eq_int_type(c, traits_type::eof()))
+        return traits_type::not_eof(c);
+    reserve(size() + 1);
+    *pptr() = traits_type::to_char_type(c);
+    pbump(1);
+    return c;
+}
+
+std::streamsize
+String_Builder::Buffer::xsputn(const char* s, std::streamsize n)
+{
+    if (n <= 0)
+        return 0;
+    if (epptr() - pptr() < n)
+        reserve(size() + n);
+    memcpy(pptr(), s, n);
+    pbump(int(n));
+    return n;
 }
 
 void
@@ -31,21 +117,27 @@ void
 write_curv_string(const char* s, unsigned indent, std::ostream& out)
 {
     out << '"';
+    // Characters that don't need escaping are written in runs.
+    const char* run = s;
     for (; *s != '\0'; ++s) {
         char c = *s;
+        if (c != '$' && c != '"' && c != '\n')
+            continue;
+        out.write(run, s - run);
+        run = s + 1;
         if (c == '$')
             out << "$.";
         else if (c == '"')
             out << "$=";
-        else if (c == '\n') {
+        else {
             out << "\n";
             for (unsigned i = 0; i < indent; ++i)
                 out << " ";
             if (s[1] != '\0')
                 out << "|";
-        } else
-            out << c;
+        }
     }
+    out.write(run, s - run);
     out << '"';
 }
 
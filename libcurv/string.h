@@ -26,20 +26,24 @@ private:
     String_or_Symbol& operator=(const String_or_Symbol&) = delete;
 public:
     String_or_Symbol(int t) : Ref_Value(t) {}
+    // If `pad` > `len`, then the character array is zero filled to `pad`
+    // characters.
     template <class STRING>
     static Shared<STRING>
-    make(int ty, const char* str, size_t len)
+    make(int ty, const char* str, size_t len, size_t pad = 0)
     {
-        void* raw = malloc(sizeof(STRING) + len);
+        size_t alen = len < pad ? pad : len;
+        void* raw = malloc(sizeof(STRING) + alen);
         if (raw == nullptr)
             throw std::bad_alloc();
         STRING* s = new(raw) STRING(ty);
         memcpy(s->data_, str, len);
-        s->data_[len] = '\0';
+        memset(s->data_ + len, 0, alen - len + 1);
         s->size_ = len;
         return Shared<STRING>{s};
     }
 private:
+    friend struct String_Builder;
     size_t size_;
     char data_[1];
 public:
@@ -57,6 +61,7 @@ public:
     bool operator!=(const String_or_Symbol& s) const { return strcmp(data_,s.data_)!=0; }
     bool operator<(const String_or_Symbol& s) const { return strcmp(data_,s.data_)<0; }
 };
+REF_TAG(String_or_Symbol, ty_string, ty_symbol);
 
 struct String : public String_or_Symbol
 {
@@ -65,6 +70,7 @@ struct String : public String_or_Symbol
     virtual void print(std::ostream&) const;
     static const char name[];
 };
+REF_TAG(String, ty_string, ty_string);
 
 inline std::ostream&
 operator<<(std::ostream& out, const String_or_Symbol& str)
@@ -131,13 +137,31 @@ struct String_Ref : public Shared<const String>
 };
 
 /// Factory class for building a curv::String using ostream operations.
-struct String_Builder : public std::stringstream
+///
+/// The characters are written directly into the character array of a String,
+/// which is grown using realloc, and get_string() hands off that String
+/// without copying it. Numbers and strings written using the String_Builder
+/// overloads of operator<< bypass the ostream sentry and locale.
+struct String_Builder : public std::ostream
 {
-    // An optimized version of this class would use a curv::String
-    // as the internal string buffer.
+    String_Builder() : std::ostream(nullptr) { rdbuf(&buf_); }
+    String_Builder(const String_Builder&) = delete;
+    String_Builder& operator=(const String_Builder&) = delete;
 
+    /// Return the characters written so far as a String,
+    /// and reset the builder to empty.
     Shared<String> get_string();
 
+    /// Return a copy of the characters written so far.
+    std::string str() const { return std::string(buf_.data(), buf_.size()); }
+
+    size_t size() const { return buf_.size(); }
+
+    void append(const char* s, size_t n) { buf_.sputn(s, n); }
+    void append(char c) { buf_.sputc(c); }
+    void append_int(long long);
+    void append_uint(unsigned long long);
+
     // variadic function that appends each argument to the string buffer
     template<typename First, typename... Rest>
     void write_all(First&& first, Rest&&... rest)
@@ -148,62 +172,110 @@ struct String_Builder : public std::stringstream
 
     // base case for write_all, to terminate recursive call in variadic case
     void write_all() {}
+
+private:
+    // The put area of the stream buffer is the character array of string_.
+    struct Buffer : public std::streambuf
+    {
+        String* string_ = nullptr;
+
+        Buffer() {}
+        ~Buffer() { delete string_; }
+        const char* data() const { return string_ ? pbase() : ""; }
+        size_t size() const { return pptr() - pbase(); }
+        void reserve(size_t);
+        Shared<String> release();
+    protected:
+        int_type overflow(int_type) override;
+        std::streamsize xsputn(const char*, std::streamsize) override;
+    };
+    Buffer buf_;
 };
 
 /// Print floating point numbers accurately (to a String_Builder)
 inline String_Builder&
 operator<<(String_Builder& b, double n)
 {
-    b << dfmt(n);
+    char buf[DTOSTR_BUFSIZE];
+    dtostr(n, buf);
+    b.append(buf, strlen(buf));
+    return b;
+}
+
+inline String_Builder&
+operator<<(String_Builder& b, long long n)
+{
+    b.append_int(n);
+    return b;
+}
+
+inline String_Builder&
+operator<<(String_Builder& b, unsigned long long n)
+{
+    b.append_uint(n);
     return b;
 }
 
 inline String_Builder&
 operator<<(String_Builder& b, long n)
 {
-    (std::stringstream&)b << n;
+    b.append_int(n);
     return b;
 }
 
 inline String_Builder&
 operator<<(String_Builder& b, unsigned long n)
 {
-    (std::stringstream&)b << n;
+    b.append_uint(n);
     return b;
 }
 
 inline String_Builder&
 operator<<(String_Builder& b, int n)
 {
-    (std::stringstream&)b << n;
+    b.append_int(n);
     return b;
 }
 
 inline String_Builder&
 operator<<(String_Builder& b, unsigned n)
 {
-    (std::stringstream&)b << n;
+    b.append_uint(n);
     return b;
 }
 
 inline String_Builder&
 operator<<(String_Builder& b, short n)
 {
-    (std::stringstream&)b << n;
+    b.append_int(n);
     return b;
 }
 
 inline String_Builder&
 operator<<(String_Builder& b, unsigned short n)
 {
-    (std::stringstream&)b << n;
+    b.append_uint(n);
     return b;
 }
 
 inline String_Builder&
 operator<<(String_Builder& b, char c)
 {
-    (std::stringstream&)b << c;
+    b.append(c);
+    return b;
+}
+
+inline String_Builder&
+operator<<(String_Builder& b, const char* s)
+{
+    b.append(s, strlen(s));
+    return b;
+}
+
+inline String_Builder&
+operator<<(String_Builder& b, const String_or_Symbol& str)
+{
+    b.append(str.data(), str.size());
     return b;
 }
 
@@ -5,15 +5,72 @@
 #include <libcurv/symbol.h>
 #include <libcurv/exception.h>
 #include <cctype>
+#include <mutex>
+#include <unordered_map>
 
 namespace curv {
 
 const char Symbol::name[] = "symbol";
 
+namespace {
+
+// A key in the symbol table. The characters are owned by a Symbol.
+struct Symbol_Key
+{
+    const char* data;
+    size_t size;
+
+    bool operator==(const Symbol_Key& k) const
+    {
+        return size == k.size && memcmp(data, k.data, size) == 0;
+    }
+};
+struct Symbol_Key_Hash
+{
+    size_t operator()(const Symbol_Key& k) const noexcept
+    {
+        // FNV-1a
+        size_t h = 14695981039346656037ULL;
+        for (size_t i = 0; i < k.size; ++i) {
+            h ^= (unsigned char) k.data[i];
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+};
+
+// The global symbol table. Symbols are never deleted. The table is
+// allocated on first use and never destroyed, so that symbols may be
+// created and used during static initialization and destruction.
+struct Symbol_Table
+{
+    std::mutex mutex_;
+    std::unordered_map<Symbol_Key, Symbol_Ref, Symbol_Key_Hash> map_;
+};
+Symbol_Table&
+symbol_table()
+{
+    static Symbol_Table* table = new Symbol_Table();
+    return *table;
+}
+
+} // namespace
+
 Symbol_Ref
 make_symbol(const char* str, size_t len)
 {
-    return Symbol::make<Symbol>(Ref_Value::ty_symbol, str, len);
+    Symbol_Table& table = symbol_table();
+    std::lock_guard<std::mutex> lock(table.mutex_);
+    auto i = table.map_.find(Symbol_Key{str, len});
+    if (i != table.map_.end())
+        return i->second;
+    // The name is zero padded for Symbol::order_key().
+    auto s = Symbol::make<Symbol>(Ref_Value::ty_symbol, str, len, 8);
+    // Symbols are shared by all threads.
+    s->publish();
+    Symbol_Ref sym = std::move(s);
+    table.map_.emplace(Symbol_Key{sym.c_str(), len}, sym);
+    return sym;
 }
 
 bool is_C_identifier(const char* p)
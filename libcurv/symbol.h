@@ -6,6 +6,8 @@
 #define LIBCURV_SYMBOL_H
 
 #include <libcurv/string.h>
+#include <cstdint>
+#include <functional>
 #include <map>
 #include <vector>
 
@@ -20,22 +22,34 @@ struct Symbol : public String_or_Symbol
     friend Symbol_Ref make_symbol(const char*, size_t);
     virtual void print(std::ostream&) const;
     static const char name[];
+
+    // The first 8 characters, as a big-endian integer. The character array
+    // of a Symbol is zero padded to at least 8 characters. If two keys differ,
+    // then comparing the keys gives the same result as strcmp.
+    std::uint64_t order_key() const noexcept
+    {
+        std::uint64_t k;
+        memcpy(&k, data(), 8);
+      #if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        k = __builtin_bswap64(k);
+      #endif
+        return k;
+    }
 };
+REF_TAG(Symbol, ty_symbol, ty_symbol);
 
 /// A Symbol_Ref is a short immutable string with an efficient representation.
 ///
 /// A Symbol_Ref represents an identifier during semantic analysis and run time.
 /// For example, a symbol in a symbol map, or a field name in a record value.
 ///
-/// There is a guaranteed global ordering on symbols, which is relied on
-/// for efficiently merging two symbol maps.
+/// Symbols are interned in a global symbol table, so two symbols with the
+/// same name are the same object, and symbol equality and hashing use
+/// the pointer. The symbol table slowly grows, and never shrinks.
 ///
-/// Possible changes in future revisions:
-/// * Add a hash code, so that we can use hash trees for Symbol_Map.
-/// * Use a global symbol table stored in the curv::System object to ensure that
-///   symbols are unique, so we can use pointer equality as symbol equality.
-///   This will also eliminate refcount manipulation, at a cost: the symbol
-///   table slowly grows, never shrinks.
+/// There is a guaranteed global ordering on symbols, which is relied on
+/// for efficiently merging two symbol maps. It is alphabetical order, but
+/// most comparisons are done using Symbol::order_key(), without strcmp.
 struct Symbol_Ref : private Shared<const Symbol>
 {
 private:
@@ -62,25 +76,34 @@ public:
         return this->get() == nullptr;
     }
 
-    int cmp(Symbol_Ref a) const noexcept
+    int cmp(const Symbol_Ref& a) const noexcept
     {
+        if (this->get() == a.get())
+            return 0;
+        std::uint64_t k1 = (*this)->order_key(), k2 = a->order_key();
+        if (k1 != k2)
+            return k1 < k2 ? -1 : 1;
         return strcmp((*this)->c_str(), a->c_str());
     }
-    friend bool operator==(Symbol_Ref a1, Symbol_Ref a2) noexcept
+    friend bool operator==(const Symbol_Ref& a1, const Symbol_Ref& a2) noexcept
     {
-        return *a1 == *a2;
+        return a1.get() == a2.get();
     }
-    friend bool operator==(Symbol_Ref a1, const char* a2) noexcept
+    friend bool operator==(const Symbol_Ref& a1, const char* a2) noexcept
     {
         return strcmp(a1->c_str(), a2) == 0;
     }
-    friend bool operator!=(Symbol_Ref a1, Symbol_Ref a2) noexcept
+    friend bool operator!=(const Symbol_Ref& a1, const Symbol_Ref& a2) noexcept
+    {
+        return a1.get() != a2.get();
+    }
+    friend bool operator<(const Symbol_Ref& a1, const Symbol_Ref& a2) noexcept
     {
-        return !(*a1 == *a2);
+        return a1.cmp(a2) < 0;
     }
-    friend bool operator<(Symbol_Ref a1, Symbol_Ref a2) noexcept
+    size_t hash() const noexcept
     {
-        return *a1 < *a2;
+        return std::hash<const Symbol*>()(this->get());
     }
 
   #if 0
@@ -126,6 +149,10 @@ int value_to_enum(Value, const std::vector<const char*>&, const Context&);
 /// according to the global ordering on Symbols. This is used to efficiently
 /// merge two symbol maps.
 ///
+/// Lookups compare keys using Symbol_Ref::cmp, which is an integer
+/// comparison in the common case, and a pointer comparison for the key
+/// that is found.
+///
 /// Alternate design: https://en.wikipedia.org/wiki/Hash_array_mapped_trie,
 /// with the keys ordered by hash value instead of alphabetically.
 template<typename T>
@@ -135,4 +162,14 @@ struct Symbol_Map : public std::map<Symbol_Ref, T>
 };
 
 } // namespace curv
+
+namespace std {
+template<> struct hash<curv::Symbol_Ref>
+{
+    size_t operator()(curv::Symbol_Ref sym) const noexcept
+    {
+        return sym.hash();
+    }
+};
+} // namespace std
 #endif // header guard
@@ -9,6 +9,7 @@
 #include <libcurv/exception.h>
 #include <libcurv/import.h>
 #include <libcurv/json.h>
+#include <libcurv/library.h>
 #include <libcurv/program.h>
 #include <libcurv/source.h>
 
@@ -89,9 +90,24 @@ System_Impl::System_Impl(std::ostream& console)
     importers_[".curv"] = curv_import;
 }
 
+System_Impl::~System_Impl()
+{
+}
+
 void System_Impl::load_library(String_Ref path)
 {
     auto file = make<File_Source>(std::move(path), At_System{*this});
+    bool cached;
+    auto index = Library_Index::get(*file, *this, cached);
+    if (cached)
+        ++library_stats_.index_hits_;
+    else
+        ++library_stats_.index_misses_;
+    if (index->lazy_) {
+        libraries_.emplace_back(
+            new Library(file, *this, std::move(index), std_namespace_));
+        return;
+    }
     Program prog{std::move(file), *this};
     prog.compile();
     auto stdlib = prog.eval();
@@ -5,15 +5,116 @@
 #ifndef LIBCURV_SYSTEM_H
 #define LIBCURV_SYSTEM_H
 
+#include <cstdint>
+#include <ctime>
 #include <ostream>
+#include <unordered_map>
 #include <unordered_set>
 #include <map>
+#include <memory>
+#include <vector>
 #include <libcurv/filesystem.h>
 #include <libcurv/builtin.h>
+#include <libcurv/value.h>
 
 namespace curv {
 
 struct Context;
+struct Library;
+
+// The modification time (in nanoseconds, so that two edits in the same second
+// are distinguished) and size of a file or directory, as observed when it was
+// imported. Used to detect that a cached import is out of date.
+struct File_Stamp
+{
+    Filesystem::path path_;
+    std::int64_t mtime_ = -1;
+    uintmax_t size_ = 0;
+
+    static File_Stamp get(const Filesystem::path&);
+    bool is_current() const;
+};
+
+// The files and directories that an imported value depends on.
+//
+// A Dir_Record imports its member files on first reference, which may be long
+// after the import that created it has been cached. So a Dir_Record keeps
+// a reference to the Import_Deps of the import that created it, and adds
+// the Import_Deps of each member that it imports to `imports_`.
+struct Import_Deps
+{
+    std::vector<File_Stamp> files_;
+    // The dependencies of values imported while this one was being evaluated,
+    // or later by a Dir_Record. These are shared, not copied, so that a
+    // cached value sees the files that its Dir_Records import later.
+    std::vector<std::shared_ptr<Import_Deps>> imports_;
+
+    void add(const File_Stamp&);
+    void add(std::shared_ptr<Import_Deps>);
+    bool is_current() const;
+private:
+    bool is_current(std::vector<const Import_Deps*>& seen) const;
+};
+
+// A cache of the values of Curv source files imported by `file`,
+// keyed by canonical path. Curv values are immutable, so a file doesn't need
+// to be compiled and evaluated again unless it, or one of the files it
+// imported, has changed since the last time.
+struct Import_Cache
+{
+    struct Entry
+    {
+        Value value_;
+        // The file itself, and every file and directory that was imported
+        // (directly or indirectly) while it was being evaluated.
+        std::shared_ptr<Import_Deps> deps_;
+    };
+    std::unordered_map<Filesystem::path,Entry,Path_Hash> entries_{};
+
+    // The dependencies of each import that is currently being evaluated.
+    std::vector<std::shared_ptr<Import_Deps>> pending_{};
+
+    // Statistics, reported by `curv -v`.
+    unsigned hits_ = 0;
+    unsigned misses_ = 0;
+
+    // True in the copy of a cache used by each thread of a parallel `for`
+    // loop. The entries were checked before the loop, and `find` doesn't
+    // check them again, because their dependencies are shared. A file that
+    // isn't in the cache is not imported: `miss` throws, and the loop is run
+    // again sequentially, so that the file is evaluated once, in order.
+    bool parallel_ = false;
+
+    // Return the entry for a canonical path, or nullptr if there isn't one
+    // or if it is out of date.
+    const Entry* find(const Filesystem::path&);
+
+    // Remove the entries that are out of date.
+    void prune();
+
+    // Count a file that must be evaluated, because it isn't in the cache.
+    void miss(const Context&);
+
+    // Record that the import being evaluated depends on this file,
+    // or on these dependencies of another import.
+    void depend(const File_Stamp&);
+    void depend(std::shared_ptr<Import_Deps>);
+};
+
+// Statistics about the libraries loaded by System_Impl::load_library,
+// reported by `curv --startup-stats`.
+struct Library_Stats
+{
+    // Lookups of a library's index in the on-disk cache.
+    unsigned index_hits_ = 0;
+    unsigned index_misses_ = 0;
+
+    // Definition groups in lazily loaded libraries, and the number of groups
+    // compiled and evaluated so far, on first reference.
+    unsigned groups_ = 0;
+    unsigned groups_loaded_ = 0;
+    double load_seconds_ = 0.0;
+};
 
 /// An abstract interface to the client and operating system.
 ///
@@ -32,6 +133,10 @@ struct System
     // True if the json-api protocol is being used.
     bool use_json_api_ = false;
 
+    // The number of threads used to evaluate a large list comprehension,
+    // if its iterations are independent. Set by `curv --jobs N`.
+    unsigned jobs_ = 1;
+
     virtual std::ostream& console() = 0;
 
     // Write an exception object to an output stream, using the Curv colour
@@ -51,10 +156,15 @@ struct System
 
     // This is non-empty while a `file` operation is being evaluated.
     // It is used to detect recursive file references.
-    // Later, this may change to a file cache.
-    // Or, it could move into the Program structure.
     std::unordered_set<Filesystem::path,Path_Hash> active_files_{};
 
+    // Values of Curv source files previously imported by `file`.
+    // Entries remain valid across evaluations (eg, live mode reloads)
+    // until one of the files they depend on changes.
+    Import_Cache import_cache_{};
+
+    Library_Stats library_stats_{};
+
     // Used by `file` to import a file based on its extension.
     // The extension includes the leading '.', and "" means no extension.
     // The extension is converted to lowercase on all platforms.
@@ -87,7 +197,13 @@ struct System_Impl : public System
 {
     Namespace std_namespace_;
     std::ostream& console_;
+    std::vector<std::unique_ptr<Library>> libraries_;
     System_Impl(std::ostream&);
+    ~System_Impl();
+
+    // Add the definitions in a library source file to std_namespace_.
+    // If the file is a record literal containing only named definitions,
+    // then each definition is compiled on first reference.
     void load_library(String_Ref path);
     virtual const Namespace& std_namespace() override;
     virtual std::ostream& console() override;
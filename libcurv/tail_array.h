@@ -41,6 +41,25 @@ public: \
     value_type& back() { return array_[size_-1]; } \
     const value_type& back() const { return array_[size_-1]; } \
 
+// The storage allocator used by Tail_Array<Base>. By default, this is malloc
+// and free. If Base declares static member functions
+//   void* tail_alloc(size_t);
+//   void tail_free(void*) noexcept;
+// then those are used instead (eg, to allocate from a pool).
+template <class Base, class = void>
+struct Tail_Alloc
+{
+    static void* alloc(size_t n) noexcept { return malloc(n); }
+    static void free(void* p) noexcept { ::free(p); }
+    static void* realloc(void* p, size_t n) noexcept { return ::realloc(p, n); }
+};
+template <class Base>
+struct Tail_Alloc<Base, decltype((void)Base::tail_alloc(0))>
+{
+    static void* alloc(size_t n) noexcept { return Base::tail_alloc(n); }
+    static void free(void* p) noexcept { Base::tail_free(p); }
+};
+
 /// Construct a class whose last data member is an inline variable sized array.
 ///
 /// The performance benefits of putting an array inline with other data members
@@ -89,6 +108,7 @@ public: \
 /// This is because C++ allocators don't provide an appropriate interface:
 /// there's no way to allocate a Tail_Array object while requesting
 /// the correct number of bytes and the correct alignment.
+/// The `Base` class can substitute its own functions: see Tail_Alloc.
 ///
 /// Suppose `Base` is derived from a polymorphic base class `P`, such that
 /// you can delete a `P*`. A big clue is that `P` defines a virtual destructor.
@@ -112,7 +132,7 @@ public:
     static std::unique_ptr<Tail_Array> make(size_t size, Rest&&... rest)
     {
         // allocate the object
-        void* mem = malloc(sizeof(Tail_Array) + size*sizeof(_value_type));
+        void* mem = Tail_Alloc<Base>::alloc(sizeof(Tail_Array) + size*sizeof(_value_type));
         if (mem == nullptr)
             throw std::bad_alloc();
         Tail_Array* r = (Tail_Array*)mem;
@@ -134,7 +154,7 @@ public:
             r->Base::size_ = size;
         } catch(...) {
             r->destroy_array(size);
-            free(mem);
+            Tail_Alloc<Base>::free(mem);
             throw;
         }
         return std::unique_ptr<Tail_Array>(r);
@@ -146,7 +166,7 @@ public:
     {
         // allocate the object
         auto size = c.size();
-        void* mem = malloc(sizeof(Tail_Array) + size*sizeof(_value_type));
+        void* mem = Tail_Alloc<Base>::alloc(sizeof(Tail_Array) + size*sizeof(_value_type));
         if (mem == nullptr)
             throw std::bad_alloc();
         Tail_Array* r = (Tail_Array*)mem;
@@ -163,7 +183,7 @@ public:
             }
         } catch (...) {
             r->destroy_array(i);
-            free(mem);
+            Tail_Alloc<Base>::free(mem);
             throw;
         }
 
@@ -173,7 +193,7 @@ public:
             r->Base::size_ = size;
         } catch(...) {
             r->destroy_array(size);
-            free(mem);
+            Tail_Alloc<Base>::free(mem);
             throw;
         }
         return std::unique_ptr<Tail_Array>(r);
@@ -184,7 +204,7 @@ public:
     static std::unique_ptr<Tail_Array> make_copy(const _value_type* a, size_t size, Rest&&... rest)
     {
         // allocate the object
-        void* mem = malloc(sizeof(Tail_Array) + size*sizeof(_value_type));
+        void* mem = Tail_Alloc<Base>::alloc(sizeof(Tail_Array) + size*sizeof(_value_type));
         if (mem == nullptr)
             throw std::bad_alloc();
         Tail_Array* r = (Tail_Array*)mem;
@@ -206,7 +226,7 @@ public:
                 }
             } catch (...) {
                 r->destroy_array(i);
-                free(mem);
+                Tail_Alloc<Base>::free(mem);
                 throw;
             }
         }
@@ -217,7 +237,7 @@ public:
             r->Base::size_ = size;
         } catch(...) {
             r->destroy_array(size);
-            free(mem);
+            Tail_Alloc<Base>::free(mem);
             throw;
         }
         return std::unique_ptr<Tail_Array>(r);
@@ -230,7 +250,7 @@ public:
     {
         // TODO: much code duplication here.
         // allocate the object
-        void* mem = malloc(sizeof(Tail_Array) + il.size()*sizeof(_value_type));
+        void* mem = Tail_Alloc<Base>::alloc(sizeof(Tail_Array) + il.size()*sizeof(_value_type));
         if (mem == nullptr)
             throw std::bad_alloc();
         Tail_Array* r = (Tail_Array*)mem;
@@ -251,7 +271,7 @@ public:
                 }
             } catch (...) {
                 r->destroy_array(i);
-                free(mem);
+                Tail_Alloc<Base>::free(mem);
                 throw;
             }
         }
@@ -262,19 +282,62 @@ public:
             r->Base::size_ = il.size();
         } catch(...) {
             r->destroy_array(il.size());
-            free(mem);
+            Tail_Alloc<Base>::free(mem);
+            throw;
+        }
+        return std::unique_ptr<Tail_Array>(r);
+    }
+
+    /// Allocate an instance with an empty array, and storage for `capacity`
+    /// elements. Together with `regrow` and `push_back_unchecked`, this lets
+    /// a builder construct the array in place, then hand off the instance
+    /// without copying it. The builder keeps track of the capacity.
+    template<typename... Rest>
+    static std::unique_ptr<Tail_Array> make_empty(size_t capacity, Rest&&... rest)
+    {
+        void* mem = Tail_Alloc<Base>::alloc(sizeof(Tail_Array) + capacity*sizeof(_value_type));
+        if (mem == nullptr)
+            throw std::bad_alloc();
+        Tail_Array* r = (Tail_Array*)mem;
+        try {
+            new(mem) Tail_Array(std::forward<Rest>(rest)...);
+            r->Base::size_ = 0;
+        } catch(...) {
+            Tail_Alloc<Base>::free(mem);
             throw;
         }
         return std::unique_ptr<Tail_Array>(r);
     }
 
+    /// Resize the storage of an instance to hold `capacity` elements,
+    /// which must be at least size(). The instance may move, and its elements
+    /// are moved by realloc: value_type must be safe to relocate using memcpy.
+    /// Only available if the storage allocator is malloc.
+    static void regrow(std::unique_ptr<Tail_Array>& p, size_t capacity)
+    {
+        void* mem = Tail_Alloc<Base>::realloc((void*)p.get(),
+            sizeof(Tail_Array) + capacity*sizeof(_value_type));
+        if (mem == nullptr)
+            throw std::bad_alloc();
+        p.release();
+        p.reset((Tail_Array*)mem);
+    }
+
+    /// Append an element, in storage reserved by make_empty or regrow.
+    void push_back_unchecked(_value_type v)
+        noexcept(std::is_nothrow_move_constructible<_value_type>::value)
+    {
+        new((void*)&Base::array_[Base::size_]) _value_type(std::move(v));
+        ++Base::size_;
+    }
+
     ~Tail_Array()
     {
         destroy_array(Base::size_);
     }
     void operator delete(void* p) noexcept
     {
-        free(p);
+        Tail_Alloc<Base>::free(p);
     }
 
 private:
@@ -61,7 +61,7 @@ Value
 Value::at(Symbol_Ref field, const Context& cx) const
 {
     if (is_ref()) {
-        Record* s = dynamic_cast<Record*>(&to_ref_unsafe());
+        Record* s = ref_cast<Record>(to_ref_unsafe());
         if (s)
             return s->getfield(field, cx);
     }
@@ -114,11 +114,23 @@ bool Value::equal(Value v, const Context& cx) const
     // two reference values with the same type
     switch (r1.type_) {
     case Ref_Value::ty_symbol:
-        return (Symbol&)r1 == (Symbol&)r2;
+        // symbols are interned
+        return &r1 == &r2;
     case Ref_Value::ty_string:
         return (String&)r1 == (String&)r2;
     case Ref_Value::ty_list:
-        return ((List&)r1).equal((List&)r2, cx);
+        // Either list may be a Range_Value.
+        return visit_list(r1, [&](const auto& l1) {
+            return visit_list(r2, [&](const auto& l2) {
+                if (l1.size() != l2.size())
+                    return false;
+                for (size_t i = 0; i < l1.size(); ++i) {
+                    if (!Value{l1[i]}.equal(l2[i], cx))
+                        return false;
+                }
+                return true;
+            });
+        });
     case Ref_Value::ty_record:
         return ((Record&)r1).equal((Record&)r2, cx);
     default:
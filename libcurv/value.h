@@ -8,6 +8,7 @@
 #include <libcurv/shared.h>
 #include <cstdint>
 #include <ostream>
+#include <type_traits>
 
 namespace curv {
 
@@ -43,6 +44,8 @@ struct Ref_Value : public Shared_Base
         ty_string,
         ty_symbol,
         ty_list,
+            sty_range,
+            sty_packed_list,
         ty_record,
             sty_drecord,
             sty_module,
@@ -63,6 +66,55 @@ struct Ref_Value : public Shared_Base
     virtual void print(std::ostream&) const = 0;
 };
 
+/// Ref_Tag<T> identifies the Ref_Value subclass T by its type codes, so that
+/// `Value::dycast<T>` and `Value::to<T>` can test the type with a range check
+/// on `subtype_`, instead of a dynamic_cast.
+///
+/// This works because each subtype is listed in the Ref_Value enum right after
+/// its type, and `subtype_ == type_` for a type with no subtypes. Eg, a Record
+/// has subtype_ in [ty_record, sty_dir_record].
+///
+/// A class that has its own type code is tagged by specializing Ref_Tag after
+/// the class definition, using REF_TAG(class, lo, hi). Classes that share
+/// a type code with their base class (like Closure, which is a Function) are
+/// not tagged, and fall back to dynamic_cast.
+template <class T>
+struct Ref_Tag
+{
+    static constexpr bool tagged = false;
+};
+template <class T>
+struct Ref_Tag<const T> : public Ref_Tag<T> {};
+
+#define REF_TAG(T, LO, HI) \
+    template<> struct Ref_Tag<T> \
+    { \
+        static constexpr bool tagged = true; \
+        static constexpr unsigned lo = Ref_Value::LO; \
+        static constexpr unsigned hi = Ref_Value::HI; \
+    }
+
+/// Like dynamic_cast<T*>, but uses the Ref_Tag of T, if it has one.
+template <class T>
+inline T* ref_cast(Ref_Value& r, std::true_type /*tagged*/) noexcept
+{
+    unsigned sty = r.subtype_;
+    if (sty - Ref_Tag<T>::lo <= Ref_Tag<T>::hi - Ref_Tag<T>::lo)
+        return static_cast<T*>(&r);
+    return nullptr;
+}
+template <class T>
+inline T* ref_cast(Ref_Value& r, std::false_type /*tagged*/) noexcept
+{
+    return dynamic_cast<T*>(&r);
+}
+template <class T>
+inline T* ref_cast(Ref_Value& r) noexcept
+{
+    return ref_cast<T>(r,
+        std::integral_constant<bool, Ref_Tag<T>::tagged>{});
+}
+
 /// A boxed, dynamically typed value in the Curv runtime.
 ///
 /// A Value is 64 bits. 64 bit IEEE floats are represented as themselves
@@ -278,12 +330,12 @@ public:
         #endif
     }
 
-    /// Like dynamic_cast for a Value.
+    /// Like dynamic_cast for a Value. See Ref_Tag.
     template <class T>
     inline Shared<T> dycast() const noexcept
     {
         if (is_ref()) {
-            T* p = dynamic_cast<T*>(&to_ref_unsafe());
+            T* p = ref_cast<T>(to_ref_unsafe());
             if (p != nullptr)
                 return share(*p);
         }
@@ -293,7 +345,7 @@ public:
     inline Shared<T> to(const Context& cx) const
     {
         if (is_ref()) {
-            T* p = dynamic_cast<T*>(&to_ref_unsafe());
+            T* p = ref_cast<T>(to_ref_unsafe());
             if (p != nullptr)
                 return share(*p);
         }
@@ -349,6 +401,14 @@ public:
     /// Print a value like a Curv expression.
     void print(std::ostream&) const;
 
+    /// Make a ref value, and the values it references, safe to share
+    /// between threads. See Shared_Base::publish.
+    void publish() const
+    {
+        if (is_ref())
+            to_ref_unsafe().publish();
+    }
+
     // Deep equality, which traverses the value tree and forces thunks.
     // May throw an Exception if forcing a thunk fails.
     // Used to implement `a == b` in the Curv language.
@@ -92,3 +92,37 @@ TEST(curv, dtostr)
     double huge = nextafter(infinity, 0.);
     DTEST(huge, "1.7976931348623157e308");
 }
+
+void
+ftest(const char*file, int line, float n, const char*str)
+{
+    char buf[DTOSTR_BUFSIZE];
+    ftostr(n, buf);
+    if (strcmp(buf,str) != 0) {
+        cout << file << ":" << line << ":"
+             << " expected " << str << " got " << buf << "\n";
+        EXPECT_TRUE(false);
+    }
+    if (!eq(n, strtof(buf, NULL))) {
+        cout << file << ":" << line << ":"
+             << " at " << str << ", round trip failed\n";
+        EXPECT_TRUE(false);
+    }
+}
+
+#define FTEST(n,s) ftest(__FILE__,__LINE__,n,s)
+
+TEST(curv, ftostr)
+{
+    FTEST(0.f,"0");
+    FTEST(-0.f,"-0");
+    FTEST(0.1f,"0.1");
+    FTEST(0.00001f, "1e-5");
+    FTEST(1234.f,"1234");
+    FTEST(-123.456f, "-123.456");
+    FTEST(3.14159265358979323846264f, "3.1415927");
+    FTEST(sqrtf(2), "1.4142135");
+    FTEST(1.f/0.f,"inf");
+    FTEST(nextafterf(0.f, 1.f), "1e-45");
+    FTEST(nextafterf(1.f/0.f, 0.f), "3.4028235e38");
+}
@@ -1,4 +1,7 @@
 #include <cstdlib>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <gtest/gtest.h>
 
@@ -382,6 +385,71 @@ TEST(curv, eval)
     SUCCESS("3..1 by -1", "[3,2,1]");
     FAILMSG("1..inf", "1 .. inf: too many elements in range");
     FAILMSG("1..true", "1 .. #true: domain error");
+    // ranges are lazy, but they behave like lists
+    SUCCESS("(0..<4) == [0,1,2,3]", "#true");
+    SUCCESS("[0,1,2] == (0..2)", "#true");
+    SUCCESS("(0..<3) == (0..<4)", "#false");
+    SUCCESS("count(0..<100000000)", "1e8");
+    SUCCESS("(0..<100000000)[99999999]", "99999999");
+    SUCCESS("(1..9 by 2)[[0,2]]", "[1,5]");
+    SUCCESS("(0..2) + 1", "[1,2,3]");
+    SUCCESS("10 * (0..2) + [1,1,1]", "[1,11,21]");
+    SUCCESS("sum(1..100)", "5050");
+    SUCCESS("[...(1..3), 4]", "[1,2,3,4]");
+    SUCCESS("do local n = 0; for (i in 0..<1000000) n := n + i; in n",
+        "4.999995e11");
+    SUCCESS("do local a = 0..2; a[1] := 10; in a", "[0,10,2]");
+    SUCCESS("let [x,y] = 3..4 in x*y", "12");
+    SUCCESS("(0..9)[2..4]", "[2,3,4]");
+    SUCCESS("\"abcde\"[1..3]", "\"bcd\"");
+    SUCCESS("strcat(1..3)", "\"123\"");
+    SUCCESS("match [[x,y] -> x*y, x -> 0] (3..4)", "12");
+
+    // array operations reuse a temporary list, but not a shared one
+    SUCCESS("let a = [[1,2],[3,4]] in [(a + 1) * 2, a]",
+        "[[[4,6],[8,10]],[[1,2],[3,4]]]");
+    SUCCESS("let a = [[1,2],[3,4]] in [-(a + 1), a, -a]",
+        "[[[-2,-3],[-4,-5]],[[1,2],[3,4]],[[-1,-2],[-3,-4]]]");
+    SUCCESS("let p = [[1,2,3],[4,5,6],[7,8,9]] in [sum p, p]",
+        "[[12,15,18],[[1,2,3],[4,5,6],[7,8,9]]]");
+    SUCCESS("let p = [[1,2,3],[4,5,6]] in [max p, min p, p]",
+        "[[4,5,6],[1,2,3],[[1,2,3],[4,5,6]]]");
+    SUCCESS("([1,2] + [3,4]) < [5,5]", "[#true,#false]");
+    FAILMSG("([1,2] + [3,4]) + [1,2,3]",
+        "mismatched list sizes (2,3) in array operation");
+
+    // copy on write: an unshared list or record is updated in place
+    SUCCESS("do local a = [for (i in 0..<100000) 0];"
+            " for (i in 0..<100000) a[i] := i; in sum a",
+        "4.99995e9");
+    SUCCESS("do local a = [1,2,3]; local b = a; b[0] := 9; in [a,b]",
+        "[[1,2,3],[9,2,3]]");
+    SUCCESS("do local a = [1,2,3]; a[2] := a; in a", "[1,2,[1,2,3]]");
+    SUCCESS("do local r = {x:1, y:[1,2]}; local s = r; s.y[1] := 5; in [r,s]",
+        "[{x:1,y:[1,2]},{x:1,y:[1,5]}]");
+    SUCCESS("do local m = {x = 1}; local s = m; s.x := 2; in [m,s]",
+        "[{x:1},{x:2}]");
+
+    // a list of 16 or more numbers is packed, and behaves like any other list
+    SUCCESS("let a = [for (i in 0..<20) i] in [a, -a, a/2, a < 10]",
+        "[[0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19],"
+        "[-0,-1,-2,-3,-4,-5,-6,-7,-8,-9,-10,-11,-12,-13,-14,-15,-16,-17,-18,-19],"
+        "[0,0.5,1,1.5,2,2.5,3,3.5,4,4.5,5,5.5,6,6.5,7,7.5,8,8.5,9,9.5],"
+        "[#true,#true,#true,#true,#true,#true,#true,#true,#true,#true,"
+        "#false,#false,#false,#false,#false,#false,#false,#false,#false,#false]]");
+    SUCCESS("let a = [for (i in 0..<20) i] in"
+            " [count a, dot(a,a), mag a, a == [for (i in 0..<20) i], a[19]]",
+        "[20,2470,49.69909455915671,#true,19]");
+    SUCCESS("let a = [for (i in 0..<20) i] in sum(a * a - 1)", "2450");
+    SUCCESS("let a = [for (i in 0..<20) i] in [a[a[2..3]], select(a < 1, a, 0)]",
+        "[[2,3],[0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0]]");
+    FAILMSG("[for (i in 0..<20) i] + [1,2]",
+        "mismatched list sizes (20,2) in array operation");
+    FAILMSG("sqrt [for (i in 0..<20) 2-i]",
+        "argument #1 of sqrt: -1: domain error");
+    SUCCESS("do local a = [for (i in 0..<20) 0]; local b = a;"
+            " a[3] := 1; a[4] := \"x\"; in [a, sum b]",
+        "[[0,0,0,1,\"x\",0,0,0,0,0,0,0,0,0,0,0,0,0,0,0],0]");
 
     // for
     FAILMSG("for", "syntax error: expecting '(' after 'for'");
@@ -490,3 +558,53 @@ TEST(curv, eval)
         "Try 'local x = 1' if you want a local definition.");
   }
 }
+
+TEST(curv, parallel_for)
+{
+    make_system().jobs_ = 4;
+
+    SUCCESS("sum [for (i in 0..<1000) i*i]", "332833500");
+    SUCCESS("let c = [1,2]; f x = x + c in [for (i in 0..<1000) f i][999]",
+        "[1000,1001]");
+    SUCCESS("sum [for (i in 0..<1000 while i < 700) i]", "244650");
+    SUCCESS("[for (i in 0..<300) [for (j in 0..<300) j][i]][299]", "299");
+
+    // A loop that assigns a variable defined outside of it runs sequentially.
+    SUCCESS("[local n = 0; for (i in 0..<1000) (n := n + 1; n)][999]",
+        "1000");
+
+    // Output and errors are the same as for sequential evaluation.
+    SUCCESS("[for (i in 0..<1000) if (i == 0 || i == 500 || i == 999)"
+            " print \"$(i)\"]", "[]");
+    EXPECT_EQ(sconsole.str(), "0\n500\n999\n");
+    FAILMSG("[for (i in 0..<1000) if (i >= 400) error \"e$(i)\" else i]",
+        "e400");
+
+    // A file imported by the loop body is evaluated once, as it is by
+    // a sequential loop, and later loops find it in the import cache.
+    const char* pf = "do print \"imported\" in 7";
+    std::ofstream(",pf1.curv") << pf;
+    std::ofstream(",pf2.curv") << pf;
+    make_system().jobs_ = 1;
+    SUCCESS("sum [for (i in 0..<1000) file \",pf1.curv\"]", "7000");
+    std::string sequential = sconsole.str();
+    EXPECT_EQ(sequential, "imported\n");
+    make_system().jobs_ = 4;
+    SUCCESS("sum [for (i in 0..<1000) file \",pf2.curv\"]", "7000");
+    EXPECT_EQ(sconsole.str(), sequential);
+    SUCCESS("sum [for (i in 0..<1000) file \",pf2.curv\"]", "7000");
+    EXPECT_EQ(sconsole.str(), "");
+    remove(",pf1.curv");
+    remove(",pf2.curv");
+
+    // The same for a member of a directory record shared by the threads.
+    mkdir(",pfdir", 0777);
+    std::ofstream(",pfdir/m.curv") << pf;
+    SUCCESS("let d = file \",pfdir\" in sum [for (i in 0..<1000) d.m]",
+        "7000");
+    EXPECT_EQ(sconsole.str(), sequential);
+    remove(",pfdir/m.curv");
+    rmdir(",pfdir");
+
+    make_system().jobs_ = 1;
+}
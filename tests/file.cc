@@ -1,8 +1,12 @@
 #include <gtest/gtest.h>
+#include <libcurv/context.h>
+#include <libcurv/import.h>
 #include <libcurv/output_file.h>
 #include <sstream>
 #include <fstream>
+#include <chrono>
 #include <cstdio>
+#include <thread>
 #include "sys.h"
 
 using namespace std;
@@ -61,3 +65,47 @@ TEST(curv, output_file)
     ASSERT_EQ(readfile(p4), "foo");
     remove(",f4");
 }
+
+TEST(curv, import_cache)
+{
+    At_System cx{sys};
+    auto& cache = sys.import_cache_;
+    fs::path p1(",ic1.curv");
+    fs::path p2(",ic2.curv");
+    writefile(p1, "1+1");
+    writefile(p2, "file \",ic1.curv\" * 10");
+
+    unsigned hits = cache.hits_, misses = cache.misses_;
+    ASSERT_EQ(import(p2, cx).to_num(cx), 20.0);
+    ASSERT_EQ(cache.misses_, misses + 2);
+    ASSERT_EQ(import(p2, cx).to_num(cx), 20.0);
+    ASSERT_EQ(cache.hits_, hits + 1);
+    ASSERT_EQ(import(p1, cx).to_num(cx), 2.0);
+    ASSERT_EQ(cache.hits_, hits + 2);
+
+    // Changing a dependency invalidates the files that imported it.
+    writefile(p1, "30+3");
+    ASSERT_EQ(import(p2, cx).to_num(cx), 330.0);
+    ASSERT_EQ(cache.misses_, misses + 4);
+
+    // An edit that doesn't change the size is seen within the same second.
+    // (The sleep outlasts the kernel's coarse timestamp granularity.)
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    writefile(p1, "40+4");
+    ASSERT_EQ(import(p2, cx).to_num(cx), 440.0);
+
+    // A cached value containing a directory record sees changes to the files
+    // in the directory, which are imported after the value is cached.
+    fs::create_directory(",icdir");
+    writefile(",icdir/foo.curv", "1");
+    writefile(p2, "file \",icdir\"");
+    Symbol_Ref foo = make_symbol("foo");
+    ASSERT_EQ(import(p2, cx).at(foo, cx).to_num(cx), 1.0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    writefile(",icdir/foo.curv", "7");
+    ASSERT_EQ(import(p2, cx).at(foo, cx).to_num(cx), 7.0);
+
+    remove(",ic1.curv");
+    remove(",ic2.curv");
+    fs::remove_all(",icdir");
+}
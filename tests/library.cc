@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+#include <libcurv/library.h>
+#include <libcurv/program.h>
+#include <libcurv/system.h>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+using namespace curv;
+
+namespace {
+
+const char lib_text[] =
+    "// a library\n"
+    "{\n"
+    "even n = if (n == 0) true else odd(n-1);\n"
+    "a = b + 1;\n"
+    "b = 1;\n"
+    "odd n = if (n == 0) false else even(n-1);\n"
+    "msg = \"a is $(a)\";\n"
+    "}\n";
+
+unsigned
+group_of(const Library_Index& index, const char* name)
+{
+    for (auto& n : index.names_)
+        if (n.name_ == name)
+            return n.group_;
+    return ~0u;
+}
+
+} // namespace
+
+TEST(curv, library_index)
+{
+    System_Impl sys(std::cerr);
+    auto src = make<String_Source>("lib.curv", lib_text);
+    auto index = Library_Index::make(*src, sys);
+    ASSERT_TRUE(index->lazy_);
+    ASSERT_EQ(index->names_.size(), 5u);
+    ASSERT_EQ(index->groups_.size(), 4u);
+    ASSERT_EQ(group_of(*index, "even"), group_of(*index, "odd"));
+    ASSERT_NE(group_of(*index, "a"), group_of(*index, "b"));
+    ASSERT_EQ(index->groups_[group_of(*index, "even")].defs_.size(), 2u);
+
+    auto copy = Library_Index::deserialize(index->serialize());
+    ASSERT_TRUE(copy != nullptr);
+    ASSERT_EQ(copy->serialize(), index->serialize());
+    ASSERT_TRUE(Library_Index::deserialize("CurvLibX") == nullptr);
+
+    // Only named definitions can be loaded lazily.
+    auto expr = make<String_Source>("", "{a = 1; print \"hi\"}");
+    ASSERT_FALSE(Library_Index::make(*expr, sys)->lazy_);
+}
+
+TEST(curv, library)
+{
+    System_Impl sys(std::cerr);
+    auto src = make<String_Source>("lib.curv", lib_text);
+    Namespace names = builtin_namespace();
+    Library lib(src, sys, Library_Index::make(*src, sys), names);
+
+    Program prog{make<String_Source>("", "[even 10, odd 10]"), sys};
+    prog.compile(&names);
+    std::ostringstream out;
+    out << prog.eval();
+    ASSERT_EQ(out.str(), "[#true,#false]");
+    // Only the groups that are referenced are loaded.
+    ASSERT_EQ(sys.library_stats_.groups_, 4u);
+    ASSERT_EQ(sys.library_stats_.groups_loaded_, 1u);
+
+    Program prog2{make<String_Source>("", "msg"), sys};
+    prog2.compile(&names);
+    std::ostringstream out2;
+    out2 << prog2.eval();
+    ASSERT_EQ(out2.str(), "\"a is 2\"");
+    ASSERT_EQ(sys.library_stats_.groups_loaded_, 4u);
+}
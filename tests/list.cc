@@ -22,3 +22,29 @@ TEST(curv, list)
     x = nullptr;
     ASSERT_EQ(y->use_count, 1u);
 }
+
+TEST(curv, list_builder)
+{
+    List_Builder lb;
+    ASSERT_EQ(lb.get_list()->size(), 0u);
+
+    for (int i = 0; i < 1000; ++i)
+        lb.push_back(Value{double(i)});
+    ASSERT_EQ(lb.size(), 1000u);
+    auto list = lb.get_list();
+    ASSERT_EQ(list->size(), 1000u);
+    ASSERT_TRUE((*list)[999].eq(Value{999.0}));
+    ASSERT_EQ(list->use_count, 1u);
+
+    // get_list resets the builder
+    ASSERT_TRUE(lb.empty());
+    lb.reserve(2);
+    lb.push_back(Value{list});
+    lb.push_back(Value{list});
+    ASSERT_EQ(list->use_count, 3u);
+    auto list2 = lb.get_list();
+    ASSERT_EQ(list2->size(), 2u);
+    ASSERT_EQ(list->use_count, 3u);
+    list2 = nullptr;
+    ASSERT_EQ(list->use_count, 1u);
+}
@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include <libcurv/module.h>
 #include <libcurv/source.h>
 #include <libcurv/scanner.h>
 #include <libcurv/parser.h>
@@ -17,6 +18,15 @@ nub(const char* str)
     return nub_phrase(phrase);
 }
 
+Value
+eval(const char* src)
+{
+    auto source = make<String_Source>("", src);
+    Program prog{source, sys};
+    prog.compile();
+    return prog.eval();
+}
+
 Value
 skip_prefix(const char* src, unsigned len)
 {
@@ -52,3 +62,35 @@ TEST(curv, program)
     ASSERT_EQ(y->use_count, 1u);
 */
 }
+
+TEST(curv, field_cache)
+{
+    // Dot_Expr: m.a and m.b each miss once, then hit.
+    auto before = Field_Cache::stats();
+    ASSERT_EQ(eval("let m = {a = 1; b = 2} in "
+                   "sum [for (i in 0..<100) m.a + m.b]").to_num_or_nan(),
+              300.0);
+    auto after = Field_Cache::stats();
+    EXPECT_GE(after.hits_ - before.hits_, 198u);
+    EXPECT_LE(after.misses_ - before.misses_, 2u);
+
+    // A new module from the same literal shares the dictionary.
+    before = after;
+    ASSERT_EQ(eval("let f x = {a = x; b = 2} in "
+                   "sum [for (i in 0..<10) (f i).a]").to_num_or_nan(),
+              45.0);
+    EXPECT_GE(Field_Cache::stats().hits_ - before.hits_, 9u);
+
+    // Different dictionaries at the same site, and a dynamic field name.
+    ASSERT_EQ(eval("let ms = [for (i in 0..<10)"
+                   " if (i < 5) {a = 1} else {b = 0; a = 2}] in "
+                   "sum [for (m in ms) m.a]").to_num_or_nan(),
+              15.0);
+    ASSERT_EQ(eval("let m = {a = 1; b = 2} in m.\"b\"").to_num_or_nan(),
+              2.0);
+
+    // Dot_Locative
+    ASSERT_EQ(eval("do local m = {a = 0};"
+                   " for (i in 0..<10) m.a := m.a + i; in m.a").to_num_or_nan(),
+              45.0);
+}
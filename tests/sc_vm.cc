@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+#include <libcurv/context.h>
+#include <libcurv/exception.h>
+#include <libcurv/geom/vm_shape.h>
+#include <libcurv/function.h>
+#include <libcurv/program.h>
+#include <libcurv/sc_vm.h>
+#include <libcurv/source.h>
+#include "sys.h"
+#include <cmath>
+#include <memory>
+
+using namespace curv;
+
+// Compile a Curv function to VM code.
+void
+vm_compile(SC_VM& vm, const char* src, SC_Type param, SC_Type result)
+{
+    Program prog{make<String_Source>("", src), sys};
+    prog.compile();
+    At_Program cx(prog);
+    auto f = prog.eval().to<Function>(cx);
+    vm.define_function(param, result, f, cx);
+}
+
+float
+vm_num(const char* src, std::initializer_list<float> arg)
+{
+    SC_VM vm(sys);
+    vm_compile(vm, src, SC_Type::Vec(arg.size()), SC_Type::Num());
+    float result;
+    vm.call(arg.begin(), &result);
+    return result;
+}
+
+TEST(curv, sc_vm)
+{
+    EXPECT_EQ(vm_num("p->p[0]+p[1]*p[2]", {1,2,3}), 7.0f);
+    EXPECT_EQ(vm_num("p->mag(p)", {3,4}), 5.0f);
+    EXPECT_EQ(vm_num("p->max(p)", {1,5,3}), 5.0f);
+    EXPECT_EQ(vm_num("p->dot(p,[1,1,1])", {1,2,3}), 6.0f);
+    EXPECT_EQ(vm_num("p->if (p[0] < 0) -1 else 1", {-2,0}), -1.0f);
+    EXPECT_EQ(vm_num("p->if (p[0] < 0) -1 else 1", {2,0}), 1.0f);
+    EXPECT_EQ(vm_num("p->p[0] - 3*floor(p[0]/3)", {7,0}), 1.0f);
+    EXPECT_EQ(vm_num("p->do local s=0; for (i in 1..p[0]) s:=s+i; in s",
+        {4,0}), 10.0f);
+    EXPECT_EQ(vm_num(
+        "p->do local n=0; local x=p[0]; while (x > 1) (x:=x/2; n:=n+1); in n",
+        {64,0}), 6.0f);
+
+    {
+        SC_VM vm(sys);
+        vm_compile(vm, "p->[p[1],p[0],p[0]+p[1]]",
+            SC_Type::Vec(2), SC_Type::Vec(3));
+        float arg[2] = {1,2}, result[3];
+        vm.call(arg, result);
+        EXPECT_EQ(result[0], 2.0f);
+        EXPECT_EQ(result[1], 1.0f);
+        EXPECT_EQ(result[2], 3.0f);
+    }
+
+    // Unsupported code is reported, so the caller can fall back.
+    SC_VM vm(sys);
+    EXPECT_THROW(
+        vm_compile(vm, "p->bool32_to_float(float_to_bool32 p[0])",
+            SC_Type::Vec(2), SC_Type::Num()),
+        Exception);
+}
+
+curv::System& make_system();
+
+// Standard shapes must compile to VM code. If the VM rejects a shape, mesh
+// export quietly falls back to the interpreter, so a test is needed to
+// catch a VM that no longer handles them.
+TEST(curv, sc_vm_shapes)
+{
+    const char* shapes[] = {
+        "sphere 2",
+        "cube 2",
+        "box.exact[1,2,3]",
+        "cylinder{d:2, h:3}",
+        "cone{d:2, h:3}",
+        "torus{major:3, minor:1}",
+        "tetrahedron 2",
+        "octahedron 2",
+        "dodecahedron 2",
+        "icosahedron 2",
+        "union[sphere 1, cube 1 >> move[1,0,0]]",
+        "smooth .5 .union[sphere 1, cube 1 >> move[1,0,0]]",
+        "intersection[sphere 2, cube 2]",
+        "difference[cube 2, sphere 2.5]",
+        "cube 2 >> rotate{angle: 30*deg, axis: Z_axis}",
+        "cube 2 >> twist 1",
+        "cube 2 >> shell .1",
+        "sphere 1 >> repeat_x 3",
+        "circle 1 >> extrude 2",
+        "intersection[gyroid >> shell .2, cube 3]",
+        "cube 2 >> bend{}",
+        "square 2 >> rotate(45*deg) >> extrude 1",
+        "sphere 2 >> colour red",
+    };
+    for (auto src : shapes) {
+        SCOPED_TRACE(src);
+        Program prog{make<String_Source>("", src), make_system()};
+        prog.compile();
+        Value val = prog.eval();
+        Shape_Program shape{prog};
+        ASSERT_TRUE(shape.recognize(val, nullptr));
+        std::unique_ptr<geom::VM_Shape> vshape;
+        try {
+            vshape = std::make_unique<geom::VM_Shape>(shape);
+        } catch (Exception& e) {
+            ADD_FAILURE() << "not compiled to VM code: " << e.what();
+            continue;
+        }
+        for (double x = -2; x <= 2; x += 0.75) {
+            double d = shape.dist(x, x/2, -x/3, 0);
+            EXPECT_NEAR(vshape->dist(x, x/2, -x/3, 0), d, 1e-4*(1+abs(d)));
+            Vec3 c = shape.colour(x, x/2, -x/3, 0);
+            Vec3 vc = vshape->colour(x, x/2, -x/3, 0);
+            EXPECT_NEAR(vc.x, c.x, 1e-4);
+            EXPECT_NEAR(vc.y, c.y, 1e-4);
+            EXPECT_NEAR(vc.z, c.z, 1e-4);
+        }
+    }
+}
@@ -6,6 +6,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <cmath>
+#include <climits>
 
 using namespace std;
 using namespace curv;
@@ -28,6 +29,14 @@ TEST(curv, string)
     ASSERT_TRUE(a2 < a0);
     ASSERT_FALSE(a0 < a2);
     ASSERT_FALSE(a0 < a0);
+    ASSERT_EQ(a0.hash(), a1.hash());
+    ASSERT_EQ(a0.c_str(), a1.c_str()); // symbols are interned
+
+    // alphabetical order, with a common prefix longer than the order key
+    ASSERT_TRUE(make_symbol("field_001") < make_symbol("field_002"));
+    ASSERT_TRUE(make_symbol("field_00") < make_symbol("field_001"));
+    ASSERT_TRUE(make_symbol("") < make_symbol("a"));
+    ASSERT_TRUE(make_symbol("Z") < make_symbol("a"));
 
     Symbol_Ref anull;
     ASSERT_TRUE(anull.empty());
@@ -45,3 +54,32 @@ TEST(curv, string)
     //ASSERT_TRUE(m["3"] == 3);
     //ASSERT_TRUE(m["4"] == 4);
 }
+
+TEST(curv, string_builder)
+{
+    String_Builder sb;
+    ASSERT_EQ(sb.get_string()->size(), 0u);
+
+    sb << "x=" << 42 << ',' << -7 << ',' << 0u << ',' << LLONG_MIN
+       << ',' << ULLONG_MAX << ',' << 0.5;
+    ASSERT_EQ(sb.str(),
+        "x=42,-7,0,-9223372036854775808,18446744073709551615,0.5");
+    auto s = sb.get_string();
+    ASSERT_STREQ(s->c_str(),
+        "x=42,-7,0,-9223372036854775808,18446744073709551615,0.5");
+
+    // get_string resets the builder
+    ASSERT_EQ(sb.size(), 0u);
+    sb << make_symbol("foo") << *make_string("bar");
+    ASSERT_STREQ(sb.get_string()->c_str(), "foobar");
+
+    // grow the buffer many times
+    std::string expected;
+    for (int i = 0; i < 10000; ++i) {
+        sb << i << ' ';
+        expected += std::to_string(i) + ' ';
+    }
+    auto big = sb.get_string();
+    ASSERT_EQ(big->size(), expected.size());
+    ASSERT_STREQ(big->c_str(), expected.c_str());
+}